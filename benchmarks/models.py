@@ -0,0 +1,154 @@
+"""
+Reference models of the benchmark suite.
+
+Every function returns a new gillespy2.Model. Three of them are the
+classic examples of the notebooks and examples/: Michaelis-Menten
+enzyme kinetics, the genetic toggle switch of Gardner et al. (2000), and
+the two-state oscillator of Novak and Tyson (2008). The synthetic family
+scales the number of reactions from 10 to 10^4 at a steady workload per
+reaction, so that its results show how each solver's cost per event
+grows with the size of the network.
+"""
+import random
+import numpy as np
+import gillespy2
+
+
+def michaelis_menten():
+    model = gillespy2.Model(name="Michaelis_Menten")
+    rate1 = gillespy2.Parameter(name='rate1', expression=0.0017)
+    rate2 = gillespy2.Parameter(name='rate2', expression=0.0001)
+    rate3 = gillespy2.Parameter(name='rate3', expression=0.1)
+    model.add_parameter([rate1, rate2, rate3])
+    A = gillespy2.Species(name='A', initial_value=301)
+    B = gillespy2.Species(name='B', initial_value=120)
+    C = gillespy2.Species(name='C', initial_value=0)
+    D = gillespy2.Species(name='D', initial_value=0)
+    model.add_species([A, B, C, D])
+    model.add_reaction([
+        gillespy2.Reaction(name="r1", reactants={A: 1, B: 1},
+                           products={C: 1}, rate=rate1),
+        gillespy2.Reaction(name="r2", reactants={C: 1},
+                           products={A: 1, B: 1}, rate=rate2),
+        gillespy2.Reaction(name="r3", reactants={C: 1},
+                           products={B: 1, D: 1}, rate=rate3)])
+    model.timespan(np.linspace(0, 100, 101))
+    return model
+
+
+def toggle_switch():
+    model = gillespy2.Model(name="toggle_switch")
+    alpha1 = gillespy2.Parameter(name='alpha1', expression=1)
+    alpha2 = gillespy2.Parameter(name='alpha2', expression=1)
+    beta = gillespy2.Parameter(name='beta', expression=2.0)
+    gamma = gillespy2.Parameter(name='gamma', expression=2.0)
+    mu = gillespy2.Parameter(name='mu', expression=1.0)
+    model.add_parameter([alpha1, alpha2, beta, gamma, mu])
+    U = gillespy2.Species(name='U', initial_value=10)
+    V = gillespy2.Species(name='V', initial_value=10)
+    model.add_species([U, V])
+    model.add_reaction([
+        gillespy2.Reaction(name="r1", reactants={}, products={U: 1},
+                           propensity_function="alpha1/(1+pow(V,beta))"),
+        gillespy2.Reaction(name="r2", reactants={}, products={V: 1},
+                           propensity_function="alpha2/(1+pow(U,gamma))"),
+        gillespy2.Reaction(name="r3", reactants={U: 1}, products={},
+                           rate=mu),
+        gillespy2.Reaction(name="r4", reactants={V: 1}, products={},
+                           rate=mu)])
+    model.timespan(np.linspace(0, 100, 101))
+    return model
+
+
+def tyson_oscillator():
+    volume = 300
+    model = gillespy2.Model(name="tyson-2-state", volume=volume)
+    P = gillespy2.Parameter(name='P', expression=2.0)
+    kt = gillespy2.Parameter(name='kt', expression=20.0)
+    kd = gillespy2.Parameter(name='kd', expression=1.0)
+    a0 = gillespy2.Parameter(name='a0', expression=0.005)
+    a1 = gillespy2.Parameter(name='a1', expression=0.05)
+    a2 = gillespy2.Parameter(name='a2', expression=0.1)
+    kdx = gillespy2.Parameter(name='kdx', expression=1.0)
+    model.add_parameter([P, kt, kd, a0, a1, a2, kdx])
+    X = gillespy2.Species(name='X', initial_value=int(0.65609071 * volume))
+    Y = gillespy2.Species(name='Y', initial_value=int(0.85088331 * volume))
+    model.add_species([X, Y])
+    model.add_reaction([
+        gillespy2.Reaction(name='X production', reactants={},
+                           products={X: 1},
+                           propensity_function='vol*1/(1+(Y*Y/((vol*vol))))'),
+        gillespy2.Reaction(name='X degradation', reactants={X: 1},
+                           products={}, rate=kdx),
+        gillespy2.Reaction(name='Y production', reactants={X: 1},
+                           products={X: 1, Y: 1}, rate=kt),
+        gillespy2.Reaction(name='Y degradation', reactants={Y: 1},
+                           products={}, rate=kd),
+        gillespy2.Reaction(name='Y nonlin', reactants={Y: 1}, products={},
+                           propensity_function='Y/(a0 + a1*(Y/vol)+'
+                                               'a2*Y*Y/(vol*vol))')])
+    model.timespan(np.linspace(0, 100, 101))
+    return model
+
+
+def synthetic(num_reactions, seed=0):
+    """
+    Returns a mass-action network of num_reactions reactions on
+    num_reactions // 5 species (at least 3). Every species is produced and
+    degraded, which holds it near 100 molecules, and the other reactions
+    convert one species into another or bind two into a third, between
+    species drawn at random from seed. Each species takes part in about
+    the same number of reactions whatever the size, so the events per
+    unit time grow linearly with num_reactions.
+    """
+    num_species = max(3, num_reactions // 5)
+    if num_reactions < 2 * num_species:
+        raise ValueError("synthetic needs at least 10 reactions.")
+    draw = random.Random(seed)
+    model = gillespy2.Model(name="synthetic_{0}".format(num_reactions))
+    produce = gillespy2.Parameter(name='produce', expression=10.0)
+    degrade = gillespy2.Parameter(name='degrade', expression=0.1)
+    convert = gillespy2.Parameter(name='convert', expression=0.01)
+    bind = gillespy2.Parameter(name='bind', expression=0.0001)
+    model.add_parameter([produce, degrade, convert, bind])
+    species = [gillespy2.Species(name='S{0}'.format(i), initial_value=100)
+               for i in range(num_species)]
+    model.add_species(species)
+
+    reactions = []
+    for i, s in enumerate(species):
+        reactions.append(gillespy2.Reaction(
+            name='produce{0}'.format(i), reactants={}, products={s: 1},
+            rate=produce))
+        reactions.append(gillespy2.Reaction(
+            name='degrade{0}'.format(i), reactants={s: 1}, products={},
+            rate=degrade))
+    for r in range(num_reactions - len(reactions)):
+        a, b, c = draw.sample(species, 3)
+        if r % 2:
+            reactions.append(gillespy2.Reaction(
+                name='convert{0}'.format(r), reactants={a: 1},
+                products={b: 1}, rate=convert))
+        else:
+            reactions.append(gillespy2.Reaction(
+                name='bind{0}'.format(r), reactants={a: 1, b: 1},
+                products={c: 1}, rate=bind))
+    model.add_reaction(reactions)
+    model.timespan(np.linspace(0, 10, 101))
+    return model
+
+
+# The reference models by name; synthetic_N is synthetic(N).
+SYNTHETIC_SIZES = (10, 100, 1000, 10000)
+MODELS = dict([('michaelis_menten', michaelis_menten),
+               ('toggle_switch', toggle_switch),
+               ('tyson_oscillator', tyson_oscillator)] +
+              [('synthetic_{0}'.format(n),
+                (lambda n: lambda: synthetic(n))(n))
+               for n in SYNTHETIC_SIZES])
+
+
+def num_reactions(name):
+    if name.startswith('synthetic_'):
+        return int(name[len('synthetic_'):])
+    return len(MODELS[name]().listOfReactions)
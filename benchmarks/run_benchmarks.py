@@ -0,0 +1,394 @@
+"""
+Benchmark suite of the gillespy2 solvers on the reference models of
+benchmarks/models.py.
+
+Every case, one solver on one model with a number of threads, runs in a
+fresh Python process, so that its memory high-water mark is its own and
+nothing is cached from the cases before it. A case simulates its ensemble
+once to warm up and then repeat times, and reports the fastest run as
+
+  - trajectories_per_second;
+  - events_per_second: reaction firings per second, the firings taken
+    from the SolverProfile of one more, profiled run of the native solvers
+    (none for the others, which do not count them); the timed runs are
+    not profiled;
+  - peak_memory_mb: the maximum resident set size of the process, and
+    import_memory_mb, that after importing gillespy2 and building the
+    model;
+  - speedup: trajectories_per_second relative to the same case on one
+    thread.
+
+The cold import time of gillespy2 is measured on its own, as the fastest
+of a few fresh processes. Solvers that cannot run here, such as
+StochKitSolver without StochKit or NativeGPUSSASolver without a device,
+are reported as skipped.
+
+    python benchmarks/run_benchmarks.py --output results.json
+    python benchmarks/run_benchmarks.py --baseline benchmarks/baselines/x.json
+
+With --output, the results are written as JSON: the machine, the import
+time and every case. With --baseline, they are compared with such a file,
+and the script exits with status 1 if any case is slower, or uses more
+memory, than the baseline by more than the tolerance. The suite benchmarks
+the tree it is in; build the native extension in place first, with
+python setup.py build_ext --inplace.
+"""
+import argparse
+import json
+import os
+import platform
+import subprocess
+import sys
+import time
+
+BENCHMARKS_DIR = os.path.dirname(os.path.abspath(__file__))
+REPO_DIR = os.path.dirname(BENCHMARKS_DIR)
+
+# Format version of the JSON results.
+FORMAT = 1
+
+# End time and output increment of every model of models.MODELS.
+WORKLOADS = {
+    'michaelis_menten': (100, 1.0),
+    'toggle_switch': (100, 1.0),
+    'tyson_oscillator': (20, 0.2),
+    'synthetic_10': (1, 0.01),
+    'synthetic_100': (1, 0.01),
+    'synthetic_1000': (1, 0.01),
+    'synthetic_10000': (1, 0.01),
+}
+
+# The solvers by name: their module, the number of trajectories of a run,
+# the largest model they are given, whether they take cores and lockstep,
+# and whether they return a SolverProfile.
+SOLVERS = [
+    ('NativeSSASolver', dict(module='gillespy2', trajectories=200,
+                             threads=True, profile=True)),
+    ('NativeNextReactionSolver', dict(module='gillespy2', trajectories=200,
+                                      threads=True, profile=True)),
+    ('NativeTauLeapingSolver', dict(module='gillespy2', trajectories=200,
+                                    threads=True, lockstep=True,
+                                    profile=True)),
+    ('NativeHybridSolver', dict(module='gillespy2', trajectories=200,
+                                max_reactions=1000, threads=True,
+                                profile=True)),
+    ('NativeCLESolver', dict(module='gillespy2', trajectories=200,
+                             threads=True, lockstep=True, profile=True)),
+    ('NativeGPUSSASolver', dict(module='gillespy2', trajectories=2000)),
+    ('StochKitSolver', dict(module='gillespy2', trajectories=20,
+                            threads=True)),
+    ('BasicSSASolver', dict(module='gillespy2', trajectories=2,
+                            max_reactions=100, threads=True)),
+    ('BasicTauSolver', dict(module='gillespy2.basic_tau_leaping_solver',
+                            trajectories=2, max_reactions=100,
+                            threads=True)),
+    ('TauLeapingSolver', dict(module='gillespy2.tau_leaping_solver',
+                              trajectories=2, max_reactions=100,
+                              threads=True)),
+    ('BasicODESolver', dict(module='gillespy2', trajectories=1,
+                            max_reactions=1000)),
+]
+
+
+def default_threads():
+    """ Returns 1, 2, 4, ... up to the number of processors, and it. """
+    processors = os.cpu_count() or 1
+    threads = []
+    n = 1
+    while n < processors:
+        threads.append(n)
+        n *= 2
+    return threads + [processors]
+
+
+def case_key(case):
+    return (case['model'], case['solver'], case['cores'], case['lockstep'])
+
+
+def plan(models, solvers, threads, lockstep, quick):
+    """ Returns the specifications of the cases to run, in order. """
+    from models import num_reactions
+    cases = []
+    for name, solver in SOLVERS:
+        if name not in solvers:
+            continue
+        for model in models:
+            if num_reactions(model) > solver.get('max_reactions', 10 ** 9):
+                continue
+            t, increment = WORKLOADS[model]
+            trajectories = solver['trajectories']
+            if quick:
+                trajectories = max(1, trajectories // 10)
+            modes = [None]
+            if solver.get('lockstep'):
+                modes = {'on': [True], 'off': [False],
+                         'both': [True, False]}[lockstep]
+            for mode in modes:
+                for cores in (threads if solver.get('threads') else [None]):
+                    cases.append(dict(model=model, solver=name,
+                                      module=solver['module'],
+                                      profile=solver.get('profile', False),
+                                      trajectories=trajectories, t=t,
+                                      increment=increment, cores=cores,
+                                      lockstep=mode))
+    return cases
+
+
+def peak_memory_mb():
+    """ Maximum resident set size of this process in MB, or None. """
+    try:
+        import resource
+    except ImportError:
+        return None
+    peak = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    # Bytes on macOS, kilobytes elsewhere.
+    return peak / float(1 << 20 if sys.platform == 'darwin' else 1 << 10)
+
+
+def run_case(case, repeat):
+    """
+    Runs one case in this process and returns its measurements; called in
+    the child process.
+    """
+    import importlib
+    import gillespy2
+    from models import MODELS
+    solver = getattr(importlib.import_module(case['module']), case['solver'])
+    model = MODELS[case['model']]()
+    args = dict(t=case['t'], increment=case['increment'], seed=1)
+    if case['cores'] is not None:
+        args['cores'] = case['cores']
+    if case['lockstep'] is not None:
+        args['lockstep'] = case['lockstep']
+    import_memory = peak_memory_mb()
+
+    try:
+        solver.run(model, number_of_trajectories=1, **args)
+        best = None
+        for _ in range(repeat):
+            start = time.time()
+            results = solver.run(model,
+                                 number_of_trajectories=case['trajectories'],
+                                 **args)
+            seconds = time.time() - start
+            if best is None or seconds < best[0]:
+                best = (seconds, results)
+    except (gillespy2.SimulationError, OSError) as e:
+        return dict(status='skipped', reason=' '.join(str(e).split()))
+
+    seconds, results = best
+    peak_memory = peak_memory_mb()
+    # The timed runs are not profiled, so that they measure what users
+    # run; the firings come from one more, profiled run of the ensemble.
+    firings = None
+    if case['profile']:
+        _, profile = solver.run(model,
+                                number_of_trajectories=case['trajectories'],
+                                profile=True, **args)
+        firings = sum(profile.firings.values())
+    return dict(status='ok', seconds=seconds,
+                trajectories_per_second=case['trajectories'] / seconds,
+                events_per_second=(firings / seconds
+                                   if firings is not None else None),
+                import_memory_mb=import_memory,
+                peak_memory_mb=peak_memory)
+
+
+def child(arguments):
+    """ Runs a child process of the suite and prints its result. """
+    return subprocess.Popen([sys.executable, os.path.abspath(__file__)] +
+                            arguments, stdout=subprocess.PIPE,
+                            stderr=subprocess.PIPE, cwd=REPO_DIR,
+                            universal_newlines=True)
+
+
+def measure(arguments, timeout):
+    """
+    Runs a child with arguments and returns the dict it printed, or the
+    reason it failed.
+    """
+    process = child(arguments)
+    try:
+        out, err = process.communicate(timeout=timeout)
+    except subprocess.TimeoutExpired:
+        process.kill()
+        process.communicate()
+        return dict(status='timeout', reason='over {0} s'.format(timeout))
+    if process.returncode != 0:
+        lines = err.strip().splitlines()
+        return dict(status='failed', reason=lines[-1] if lines else
+                    'exit status {0}'.format(process.returncode))
+    return json.loads(out.strip().splitlines()[-1])
+
+
+def import_time(runs, timeout):
+    """
+    Returns the fastest cold import of gillespy2 over runs fresh processes
+    as a dict with the status, and the seconds if it succeeded or the
+    reason it failed, like a case.
+    """
+    best = None
+    for _ in range(runs):
+        result = measure(['--import-only'], timeout)
+        if result['status'] != 'ok':
+            return result
+        if best is None or result['seconds'] < best['seconds']:
+            best = result
+    return best
+
+
+def git_revision():
+    try:
+        return subprocess.check_output(
+            ['git', 'rev-parse', 'HEAD'], cwd=REPO_DIR,
+            stderr=subprocess.STDOUT, universal_newlines=True).strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+
+def machine():
+    return dict(platform=platform.platform(), python=platform.python_version(),
+                processor=platform.processor(), processors=os.cpu_count(),
+                node=platform.node(), revision=git_revision())
+
+
+def add_speedups(cases):
+    """ Sets the speedup of every case over the same case on one thread. """
+    single = dict((case_key(case)[:2] + (case['lockstep'],), case)
+                  for case in cases
+                  if case['cores'] == 1 and case['status'] == 'ok')
+    for case in cases:
+        base = single.get(case_key(case)[:2] + (case['lockstep'],))
+        case['speedup'] = None
+        if case['status'] == 'ok' and base is not None:
+            case['speedup'] = (case['trajectories_per_second'] /
+                               base['trajectories_per_second'])
+
+
+def compare(results, baseline, tolerance):
+    """
+    Returns the regressions of results against baseline: cases slower, or
+    using more memory, than in the baseline by more than tolerance.
+    """
+    regressions = []
+    current, base = results['import'], baseline['import']
+    if current['status'] == 'ok' and base['status'] == 'ok' and \
+            current['seconds'] > base['seconds'] * (1 + tolerance):
+        regressions.append("import: {0:.3f} s, baseline {1:.3f} s".format(
+            current['seconds'], base['seconds']))
+    previous = dict((case_key(case), case) for case in baseline['cases']
+                    if case['status'] == 'ok')
+    for case in results['cases']:
+        base = previous.get(case_key(case))
+        if base is None or case['status'] != 'ok':
+            continue
+        name = describe(case)
+        if case['trajectories_per_second'] < \
+                base['trajectories_per_second'] * (1 - tolerance):
+            regressions.append("{0}: {1:.4g} trajectories/s, baseline "
+                               "{2:.4g}".format(
+                                   name, case['trajectories_per_second'],
+                                   base['trajectories_per_second']))
+        if base['peak_memory_mb'] and case['peak_memory_mb'] > \
+                base['peak_memory_mb'] * (1 + tolerance):
+            regressions.append("{0}: {1:.1f} MB, baseline {2:.1f} MB".format(
+                name, case['peak_memory_mb'], base['peak_memory_mb']))
+    return regressions
+
+
+def describe(case):
+    name = "{0} {1}".format(case['solver'], case['model'])
+    if case['cores'] is not None:
+        name += " cores={0}".format(case['cores'])
+    if case['lockstep'] is not None:
+        name += " lockstep={0}".format('on' if case['lockstep'] else 'off')
+    return name
+
+
+def report(case):
+    if case['status'] != 'ok':
+        return "{0:<60} {1}: {2}".format(describe(case), case['status'],
+                                         case['reason'])
+    events = case['events_per_second']
+    return "{0:<60} {1:>10.4g} traj/s {2:>10} events/s {3:>8.1f} MB".format(
+        describe(case), case['trajectories_per_second'],
+        '{0:.4g}'.format(events) if events is not None else '-',
+        case['peak_memory_mb'] or 0.0) + (
+            " x{0:.2f}".format(case['speedup'])
+            if case.get('speedup') is not None and case['cores'] != 1 else "")
+
+
+def main():
+    sys.path[:0] = [REPO_DIR, BENCHMARKS_DIR]
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    parser.add_argument('--models', nargs='+', metavar='MODEL',
+                        default=sorted(WORKLOADS),
+                        choices=sorted(WORKLOADS))
+    parser.add_argument('--solvers', nargs='+', metavar='SOLVER',
+                        default=[name for name, _ in SOLVERS],
+                        choices=[name for name, _ in SOLVERS])
+    parser.add_argument('--threads', type=int, nargs='+',
+                        default=default_threads(),
+                        help="thread counts of the solvers that take cores")
+    parser.add_argument('--lockstep', choices=('on', 'off', 'both'),
+                        default='on',
+                        help="lockstep setting of the solvers that have one")
+    parser.add_argument('--repeat', type=int, default=3,
+                        help="timed runs per case, the fastest is kept")
+    parser.add_argument('--import-runs', type=int, default=5)
+    parser.add_argument('--quick', action='store_true',
+                        help="a tenth of the trajectories")
+    parser.add_argument('--timeout', type=float, default=900,
+                        help="seconds before a case is abandoned")
+    parser.add_argument('--output', help="write the results to this file")
+    parser.add_argument('--baseline', help="compare with these results")
+    parser.add_argument('--tolerance', type=float, default=0.2,
+                        help="allowed slowdown and memory growth relative "
+                             "to the baseline")
+    parser.add_argument('--case', help=argparse.SUPPRESS)
+    parser.add_argument('--import-only', action='store_true',
+                        help=argparse.SUPPRESS)
+    args = parser.parse_args()
+
+    if args.import_only:
+        start = time.time()
+        import gillespy2
+        print(json.dumps(dict(status='ok', seconds=time.time() - start)))
+        return 0
+    if args.case:
+        print(json.dumps(run_case(json.loads(args.case), args.repeat)))
+        return 0
+
+    results = dict(format=FORMAT, machine=machine(), cases=[])
+    results['import'] = import_time(args.import_runs, args.timeout)
+    if results['import']['status'] == 'ok':
+        print("import gillespy2: {0:.3f} s".format(
+            results['import']['seconds']))
+    else:
+        print("import gillespy2: {0}: {1}".format(
+            results['import']['status'], results['import']['reason']))
+    for case in plan(args.models, args.solvers, args.threads, args.lockstep,
+                     args.quick):
+        case.update(measure(['--case', json.dumps(case),
+                             '--repeat', str(args.repeat)], args.timeout))
+        results['cases'].append(case)
+        add_speedups(results['cases'])
+        print(report(case))
+        sys.stdout.flush()
+
+    if args.output:
+        with open(args.output, 'w') as f:
+            json.dump(results, f, indent=2, sort_keys=True)
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        regressions = compare(results, baseline, args.tolerance)
+        for regression in regressions:
+            print("regression: " + regression)
+        if regressions:
+            return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
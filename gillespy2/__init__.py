@@ -1,4 +1,10 @@
 from .gillespy2 import *
 from .gillespyError import *
 from .gillespySolver import *
+from .compiled_model import CompiledModel
+from .results_store import ResultsStore
 from .basic_ssa_solver import BasicSSASolver
+from .basic_ode_solver import BasicODESolver
+from .native_ssa_solver import (NativeSSASolver, NativeNextReactionSolver,
+                                NativeTauLeapingSolver, NativeHybridSolver,
+                                NativeCLESolver, NativeGPUSSASolver)
@@ -1,54 +1,169 @@
 import gillespy2
-from gillespySolver import GillesPySolver
-from scipy.integrate import odeint
 import numpy as np
+from .gillespySolver import GillesPySolver
+from .gillespyError import *
+from .compiled_model import CompiledModel
+from .results import (timeline, output_species, allocate_trajectories,
+                      format_trajectories)
+
+try:
+    from . import _native
+    isNATIVE = True
+except ImportError:
+    isNATIVE = False
+
+
 class BasicODESolver(GillesPySolver):
+    """
+    Deterministic simulation of the reaction rate equations
+    dx/dt = sum_r v_r a_r(x), with the propensity functions a_r of the
+    model evaluated at the system volume. The equations are integrated by
+    the stiff Rosenbrock method of the gillespy2._native extension, with
+    the analytic Jacobian of the mass-action propensities. Without the
+    extension, or for propensities it cannot compile, scipy's BDF method
+    is used with the vectorized right-hand side and sparse Jacobian of
+    RateEquations.
+
+    The solution is deterministic, so a single trajectory is returned
+    whatever number_of_trajectories is, in the format of the stochastic
+    solvers.
+
+    Attributes
+    ----------
+    rtol : float (1e-6)
+        Relative error tolerance.
+    atol : float (1e-8)
+        Absolute error tolerance.
+    """
+
+    @classmethod
+    def run(self, model, t=20, number_of_trajectories=1,
+            increment=0.05, seed=None, debug=False, show_labels=False,
+            stochkit_home=None, rtol=1e-6, atol=1e-8, timepoints=None,
+            species=None):
+        compiled_model = CompiledModel(model)
+        times = timeline(t, increment, timepoints)
+        names, indices = output_species(compiled_model.species, species)
+        trajectories = allocate_trajectories(1, times, len(names))
+
+        if isNATIVE and not compiled_model.propensities.unsupported:
+            try:
+                _native.ode(compiled_model, times, trajectories[0],
+                            rtol=rtol, atol=atol, species=indices)
+            except RuntimeError as e:
+                raise SimulationError("ODE integration failed: {0}".format(e))
+        else:
+            self.integrate(self.rate_equations(compiled_model),
+                           compiled_model.initial_state, times,
+                           trajectories[0], rtol, atol, indices)
+
+        if debug:
+            print("{0}: {1} species, {2} reactions".format(
+                self.__name__, compiled_model.num_species,
+                compiled_model.num_reactions))
+
+        return format_trajectories(trajectories, names, show_labels)
+
+    @classmethod
+    def run_iter(self, model, t=20, number_of_trajectories=1,
+                 increment=0.05, seed=None, batch_size=None, **solver_args):
+        """ Yields the solution of run(). """
+        for trajectory in self.run(model, t=t, increment=increment,
+                                   **solver_args):
+            yield trajectory
+
+    @classmethod
+    def run_batch(self, model, parameters, parameter_names=None, t=20,
+                  increment=0.05, rtol=1e-6, atol=1e-8, cores=None,
+                  timepoints=None, species=None):
+        """
+        Integrates the rate equations of model for K parameter sets at
+        once, with the model compiled a single time, and returns the
+        populations in a (K x timepoints x species) array. The output times
+        are 0, increment, ..., t, or timepoints if given, and the species
+        are those listed in species, all of them in model order by default.
+        The native engine spreads the systems over cores threads, one per
+        hardware thread by default. A system whose integration fails is
+        NaN from the failure on.
+
+        Attributes
+        ----------
+        parameters : array_like
+            (K x P) parameter values, one set per row.
+        parameter_names : list of str
+            Names of the P parameters in the columns of parameters.
+            Optional, defaults to all parameters in model order. The other
+            parameters keep their values; parameter expressions are not
+            re-evaluated.
+        """
+        compiled_model = CompiledModel(model)
+        if parameter_names is None:
+            parameter_names = compiled_model.parameters
+        for name in parameter_names:
+            if name not in compiled_model.parameter_index:
+                raise ParameterError("Unknown parameter '{0}'.".format(name))
+        columns = [compiled_model.parameter_index[name]
+                   for name in parameter_names]
+        sets = np.asarray(parameters, dtype=np.float64)
+        if sets.ndim != 2 or sets.shape[1] != len(columns):
+            raise ParameterError("parameters must be a (K x {0}) "
+                                 "array.".format(len(columns)))
+        if cores is not None and cores < 1:
+            raise SimulationError("cores must be at least 1.")
+
+        values = np.empty((len(sets), len(compiled_model.parameters)))
+        values[:] = compiled_model.parameter_values
+        values[:, columns] = sets
+        coefficients = compiled_model.rate_coefficient_matrix(values)
+        times = timeline(t, increment, timepoints)
+        names, indices = output_species(compiled_model.species, species)
+        trajectories = allocate_trajectories(len(sets), times, len(names))
+
+        if isNATIVE and not compiled_model.propensities.unsupported:
+            _native.ode(compiled_model, times, trajectories, rtol=rtol,
+                        atol=atol, parameters=values,
+                        rate_coefficients=coefficients, cores=cores or 0,
+                        species=indices)
+        else:
+            equations = self.rate_equations(compiled_model)
+            for k in range(len(sets)):
+                equations.bind(values[k], coefficients[k])
+                try:
+                    self.integrate(equations, compiled_model.initial_state,
+                                   times, trajectories[k], rtol, atol,
+                                   indices)
+                except SimulationError:
+                    # integrate() has set the system NaN from the failure on.
+                    pass
+        return trajectories[:, :, 1:]
 
+    @classmethod
+    def rate_equations(self, compiled_model):
+        """ Returns the RateEquations of compiled_model; requires scipy. """
+        try:
+            from .rate_equations import RateEquations
+            return RateEquations(compiled_model)
+        except ImportError:
+            raise SimulationError("{0} needs the gillespy2._native extension "
+                                  "or scipy.".format(self.__name__))
 
-	@staticmethod
-	def rhs(y0,t,species,parameters,reactions):
-		curr_state = {}
-   	  	state_change = {}
-  		curr_state['vol'] = 1
-		propensity = {}
-		results = []
-
-    		for i,s in enumerate(species):  
-        		curr_state[s] = y0[i]
-        		state_change[s] = 0
-    		for p in parameters: 
-        		curr_state[p] = parameters[p].value
-        
-    		for r in reactions:
-        		propensity[r] = eval(reactions[r].propensity_function,curr_state)  #assumption that prop is massAction
-        		print(reactions[r].propensity_function)
-			for react in reactions[r].reactants:
-            			state_change[react] -= reactions[r].reactants[react]*propensity[r]
-        		for prod in reactions[r].products:
-            			state_change[prod] += reactions[r].products[prod]*propensity[r]
-		
-		for s in species:
-			results.append(state_change[s])
-
-        
-		return (results)
-
-
-	@classmethod
-	def run(self, model,  t=20, number_of_trajectories=1,
-		increment=0.05, seed=None, debug=False, show_labels=False,stochkit_home=None):
-		for traj_num_ in range(number_of_trajectories):
-			y0 = []
-			for s in model.listOfSpecies:
-				y0.append(model.listOfSpecies[s].initial_value)
-			time = np.arange(0,t,increment)
-		results = odeint(y0=y0,func=BasicODESolver.rhs,t=time, args=(model.listOfSpecies,model.listOfParameters,model.listOfReactions))
-		#return results
-		#return[results, time]
-		return np.append(results, time.reshape(len(time), 1), axis=1)
-		
-
-
-
-
-		
+    @classmethod
+    def integrate(self, equations, initial_state, times, trajectory, rtol,
+                  atol, species=None):
+        """
+        Integrates equations, a RateEquations, with scipy into trajectory,
+        the (timepoints x 1 + species) output array of the species with the
+        given indices, all by default. If the integration fails, the
+        timepoints from the failure on are NaN and SimulationError is raised.
+        """
+        from scipy.integrate import solve_ivp
+        solution = solve_ivp(equations.rhs, (0, times[-1]),
+                             initial_state, method='BDF', t_eval=times,
+                             jac=equations.jacobian, rtol=rtol, atol=atol)
+        populations = solution.y if species is None else solution.y[species]
+        reached = populations.shape[1]
+        trajectory[:reached, 1:] = populations.T
+        if not solution.success:
+            trajectory[reached:, 1:] = np.nan
+            raise SimulationError("ODE integration failed: {0}".format(
+                solution.message))
@@ -1,6 +1,10 @@
 import gillespy2
 from .gillespySolver import GillesPySolver
-import random
+from .parallel import run_trajectories
+from .random_streams import TrajectoryRandom, random_seed
+from .results import (timeline, output_species, allocate_trajectories,
+                      format_trajectories)
+from .compiled_model import CompiledModel
 import math
 
 class BasicSSASolver(GillesPySolver):
@@ -9,36 +13,54 @@ class BasicSSASolver(GillesPySolver):
     
     @classmethod
     def run(self, model, t=20, number_of_trajectories=1,
-            increment=0.05, seed=None, debug=False, show_labels=False,stochkit_home=None):
+            increment=0.05, seed=None, debug=False, show_labels=False,stochkit_home=None,
+            cores=1, first_trajectory=0, timepoints=None, species=None):
+        compiled_model = CompiledModel(model)
+        output_names, _ = output_species(compiled_model.species, species)
+        if seed is None:
+            seed = random_seed()
+        if cores != 1 and number_of_trajectories > 1:
+            trajectories = run_trajectories(self, model, number_of_trajectories,
+                                            cores=cores, seed=seed,
+                                            first_trajectory=first_trajectory,
+                                            t=t, increment=increment,
+                                            debug=debug, timepoints=timepoints,
+                                            species=output_names)
+            return format_trajectories(trajectories, output_names, show_labels)
+
         self.simulation_data = []
- 
         curr_state = {}
         propensity = {}
-        results = {}
+        propensity_code = compiled_model.propensities.python_code
+        net_changes = compiled_model.net_changes()
+        times = timeline(t, increment, timepoints)
+        num_times = len(times)
+        trajectories = allocate_trajectories(number_of_trajectories, times,
+                                             len(output_names))
     
         for traj_num in range(number_of_trajectories):
+            rng = TrajectoryRandom(seed, first_trajectory + traj_num)
+            trajectory = trajectories[traj_num]
             for s in model.listOfSpecies:   #Initialize Species population
                 curr_state[s] = model.listOfSpecies[s].initial_value    
-                results[s]=[]
 
             curr_state['vol'] = model.volume
-            results['time'] = []
             curr_time = 0
-            save_time = 0      
+            entry_count = 0
 
             for p in model.listOfParameters:
                 curr_state[p] = model.listOfParameters[p].value        
         
          
-            while(curr_time < t):
+            while(entry_count < num_times):
                 prop_sum = 0
                 cumil_sum = 0
                 reaction = None
                 reaction_num = None
                 for r in model.listOfReactions: 
-                    propensity[r] = eval(model.listOfReactions[r].propensity_function, curr_state)
+                    propensity[r] = eval(propensity_code[r], curr_state)
                     prop_sum += propensity[r]    
-                reaction_num = random.uniform(0,prop_sum)
+                reaction_num = rng.uniform(0,prop_sum)
                 for r in model.listOfReactions:
                     cumil_sum += propensity[r]
     
@@ -46,27 +68,24 @@ class BasicSSASolver(GillesPySolver):
                         reaction = r
                         break
                 if(prop_sum <= 0):
-                    while(save_time <= t):
-                        results['time'].append(save_time)
-                        for s in model.listOfSpecies:
-                            results[s].append(curr_state[s])
-                        save_time += increment
-                    return results
+                    break
 
-                tau = -1*math.log(random.random())/prop_sum
+                tau = -1*math.log(rng.random())/prop_sum
                 curr_time += tau
-                while(curr_time > save_time and curr_time <= t):
-                    results['time'].append(save_time)
-                    for s in model.listOfSpecies:
-                        results[s].append(curr_state[s])
-                    save_time += increment
+                # the current state holds until the next firing time
+                while(entry_count < num_times and times[entry_count] < curr_time):
+                    trajectory[entry_count, 1:] = [curr_state[s] for s in output_names]
+                    entry_count += 1
+
+                for species_name, change in net_changes[reaction]:
+                    curr_state[species_name] += change
 
-                for react in model.listOfReactions[reaction].reactants:
-                    curr_state[str(react)] -=  model.listOfReactions[reaction].reactants[react]
-                for prod in model.listOfReactions[reaction].products:
-                    curr_state[str(prod)] += model.listOfReactions[reaction].products[prod]
+            # nothing can fire anymore, the state is final
+            while(entry_count < num_times):
+                trajectory[entry_count, 1:] = [curr_state[s] for s in output_names]
+                entry_count += 1
 
-            return results
+        return format_trajectories(trajectories, output_names, show_labels)
 
     def get_trajectories(self, outdir, debug=False, show_labels=False):
         if show_labels:
@@ -1,8 +1,11 @@
 import gillespy2
 from .gillespySolver import GillesPySolver
-import random
+from .parallel import run_trajectories
+from .random_streams import TrajectoryRandom, random_seed
+from .results import (timeline, output_species, allocate_trajectories,
+                      format_trajectories)
+from .compiled_model import CompiledModel
 import math
-import numpy as np
 
 class BasicTauSolver(GillesPySolver):
     """ TODO
@@ -10,39 +13,58 @@ class BasicTauSolver(GillesPySolver):
     
     @classmethod
     def run(self, model, t=20, number_of_trajectories=1,
-            increment=0.05, seed=None, debug=False, show_labels=False,stochkit_home=None):
+            increment=0.05, seed=None, debug=False, show_labels=False,stochkit_home=None,
+            cores=1, first_trajectory=0, timepoints=None, species=None):
+        compiled_model = CompiledModel(model)
+        output_names, _ = output_species(compiled_model.species, species)
+        if seed is None:
+            seed = random_seed()
+        if cores != 1 and number_of_trajectories > 1:
+            trajectories = run_trajectories(self, model, number_of_trajectories,
+                                            cores=cores, seed=seed,
+                                            first_trajectory=first_trajectory,
+                                            t=t, increment=increment,
+                                            debug=debug, timepoints=timepoints,
+                                            species=output_names)
+            return format_trajectories(trajectories, output_names, show_labels)
+
         self.simulation_data = []
- 
         curr_state = {}
         propensities = {}
-        results = {}
         poissonValues = {}
+        propensity_code = compiled_model.propensities.python_code
+        net_changes = compiled_model.net_changes()
+        times = timeline(t, increment, timepoints)
+        num_times = len(times)
+        trajectories = allocate_trajectories(number_of_trajectories, times,
+                                             len(output_names))
 
         for traj_num in range(number_of_trajectories):
+            rng = TrajectoryRandom(seed, first_trajectory + traj_num)
+            trajectory = trajectories[traj_num]
             for species in model.listOfSpecies:   #Initialize Species population
                 curr_state[species] = model.listOfSpecies[species].initial_value    
-                results[species]=[]
 
             curr_state['vol'] = model.volume
-            results['time'] = []
             currentTime = 0
-            outputTime = 0      
+            entry_count = 0
             nextTime = 0
 
             for parameter in model.listOfParameters:
                 curr_state[parameter] = model.listOfParameters[parameter].value        
        
             # run the algorithm
-            while(currentTime < t):
-                while (currentTime >= outputTime) and (outputTime < t):
-                    results['time'].append(outputTime)
-                    for species in model.listOfSpecies:
-                        results[species].append(curr_state[species])
-                    outputTime += increment
+            while True:
+                while entry_count < num_times and currentTime >= times[entry_count]:
+                    trajectory[entry_count, 1:] = [curr_state[s] for s in output_names]
+                    entry_count += 1
+                if entry_count == num_times:
+                    break
+                outputTime = times[entry_count]
 
                 # evaluate propensities
                 for reaction in model.listOfReactions: 
-                    propensities[reaction] = eval(model.listOfReactions[reaction].propensity_function, curr_state)
+                    propensities[reaction] = eval(propensity_code[reaction], curr_state)
    
                 # select tau
                 tau = 0.05
@@ -55,19 +77,17 @@ class BasicTauSolver(GillesPySolver):
 
                 # calculate poisson distribution
                 for reaction in model.listOfReactions:
-                    poissonValues[reaction] = np.random.poisson(propensities[reaction]*tau) 
+                    poissonValues[reaction] = rng.poisson(propensities[reaction]*tau) 
 
                 # append changes to curr_state
                 for reaction in model.listOfReactions:
-                    for reactant in model.listOfReactions[reaction].reactants:
-                        curr_state[str(reactant)] -= model.listOfReactions[reaction].reactants[reactant]*poissonValues[reaction]
-                    for product in model.listOfReactions[reaction].products:
-                        curr_state[str(product)] += model.listOfReactions[reaction].products[product]*poissonValues[reaction]
+                    for species, change in net_changes[reaction]:
+                        curr_state[species] += change*poissonValues[reaction]
 
                 # update the time
                 currentTime = nextTime
 
-            return results
+        return format_trajectories(trajectories, output_names, show_labels)
 
     def get_trajectories(self, outdir, debug=False, show_labels=False):
         if show_labels:
@@ -0,0 +1,190 @@
+"""
+Checkpoints of native solver ensembles, so that a run interrupted by the
+loss of its node resumes where it stopped.
+
+Trajectory i of an ensemble is determined by the seed and i alone (see
+random_streams), so the state of a run is its progress: how many
+trajectories have finished, and their output or their running statistics.
+The solvers run the ensemble in batches and checkpoint after each of them;
+a run started with the checkpoint of an earlier one skips the finished
+trajectories. A checkpoint file holds a header of
+
+    magic b'GPY2CKPT', format version (uint32), SHA-256 key of the run
+    arguments (32 bytes), seed (uint64), finished trajectories (uint64)
+
+in little-endian byte order, followed by
+
+  - for run(): the finished trajectories as (timepoints x columns) raw
+    float64 values each, appended batch by batch. The count in the header
+    is rewritten only once the batch is on disk, so it never covers a
+    partly written trajectory;
+  - for run_statistics(): the mean, variance, minimum and maximum as
+    (timepoints x species) float64 values, the histogram counts as int64
+    values if there is a histogram, and the kept trajectories. The whole
+    file is replaced atomically.
+"""
+import hashlib
+import os
+import struct
+import numpy as np
+from .gillespyError import *
+
+_MAGIC = b'GPY2CKPT'
+_VERSION = 1
+_HEADER = struct.Struct('<8sI32sQQ')
+# Offset of the number of finished trajectories in the header.
+_DONE_OFFSET = _HEADER.size - 8
+
+# Atomic on POSIX either way; os.replace is Python 3 only.
+_rename = getattr(os, 'replace', os.rename)
+
+
+def run_key(*arguments):
+    """
+    Returns the digest identifying a run by its arguments, anything with
+    a stable repr().
+    """
+    return hashlib.sha256(repr(arguments).encode('utf-8')).digest()
+
+
+def _read(path, key, size):
+    """
+    Returns the seed, the number of finished trajectories and the first
+    size bytes after the header of the checkpoint at path, or None if
+    there is no file. Raises a SimulationError unless the file is a
+    complete checkpoint of the run with the given key.
+    """
+    if not os.path.exists(path):
+        return None
+    with open(path, 'rb') as f:
+        header = f.read(_HEADER.size)
+        if len(header) < _HEADER.size:
+            raise SimulationError("'{0}' is not a gillespy2 "
+                                  "checkpoint.".format(path))
+        magic, version, file_key, seed, done = _HEADER.unpack(header)
+        if magic != _MAGIC or version != _VERSION:
+            raise SimulationError("'{0}' is not a gillespy2 "
+                                  "checkpoint.".format(path))
+        if file_key != key:
+            raise SimulationError("The checkpoint '{0}' belongs to another "
+                                  "run; remove it to start over.".format(
+                                      path))
+        data = f.read(size(done))
+    if len(data) != size(done):
+        raise SimulationError("The checkpoint '{0}' is truncated.".format(
+            path))
+    return seed, done, data
+
+
+def _replace(path, data):
+    """ Replaces path by a file holding data, atomically. """
+    temporary = path + '.tmp'
+    with open(temporary, 'wb') as f:
+        f.write(data)
+        f.flush()
+        os.fsync(f.fileno())
+    _rename(temporary, path)
+
+
+def _header(key, seed, done):
+    return _HEADER.pack(_MAGIC, _VERSION, key, seed, done)
+
+
+def _values(array, dtype):
+    return np.ascontiguousarray(array, dtype=dtype).tobytes()
+
+
+def resume_trajectories(path, key, seed, trajectories):
+    """
+    Copies the finished trajectories of the checkpoint of run() at path
+    into the output buffer trajectories and returns the seed of the run
+    and their number. Creates the checkpoint, of a run with the given
+    seed and none finished, if there is none.
+    """
+    row_bytes = 8 * trajectories[0].size if len(trajectories) else 0
+    checkpoint = _read(path, key, lambda done: done * row_bytes)
+    if checkpoint is None:
+        _replace(path, _header(key, seed, 0))
+        return seed, 0
+    seed, done, data = checkpoint
+    if done:
+        trajectories[:done] = np.frombuffer(data, dtype='<f8').reshape(
+            (done,) + tuple(trajectories.shape[1:]))
+    return seed, done
+
+
+def append_trajectories(path, trajectories, done):
+    """
+    Appends trajectories, the batch that brings the run to done finished
+    trajectories, to its checkpoint at path.
+    """
+    row_bytes = 8 * trajectories[0].size
+    with open(path, 'r+b') as f:
+        # Drops anything written after the last complete checkpoint.
+        f.seek(_HEADER.size + (done - len(trajectories)) * row_bytes)
+        f.write(_values(trajectories, '<f8'))
+        f.truncate()
+        f.flush()
+        os.fsync(f.fileno())
+        f.seek(_DONE_OFFSET)
+        f.write(struct.pack('<Q', done))
+        f.flush()
+        os.fsync(f.fileno())
+
+
+def resume_statistics(path, key, seed, statistics_shape, histogram_shape,
+                      kept):
+    """
+    Reads the checkpoint of run_statistics() at path. Returns the seed of
+    the run, its number of finished trajectories, its (4, timepoints,
+    species) statistics and its histogram, or None for both if it has none
+    finished yet, after copying the finished kept trajectories into kept.
+    Creates the checkpoint, of a run with the given seed, if there is
+    none. histogram_shape is None without a histogram.
+    """
+    num_values = int(np.prod(statistics_shape))
+    num_counts = int(np.prod(histogram_shape)) if histogram_shape else 0
+    row_bytes = 8 * kept[0].size if len(kept) else 0
+
+    def size(done):
+        if not done:
+            return 0
+        return 8 * (num_values + num_counts) + min(done, len(kept)) * \
+            row_bytes
+
+    checkpoint = _read(path, key, size)
+    if checkpoint is None:
+        _replace(path, _header(key, seed, 0))
+        return seed, 0, None, None
+    seed, done, data = checkpoint
+    if not done:
+        return seed, 0, None, None
+    statistics = np.frombuffer(data[:8 * num_values], dtype='<f8').reshape(
+        statistics_shape)
+    histogram = None
+    if histogram_shape:
+        histogram = np.frombuffer(
+            data[8 * num_values:8 * (num_values + num_counts)],
+            dtype='<i8').reshape(histogram_shape)
+    num_kept = min(done, len(kept))
+    if num_kept:
+        kept[:num_kept] = np.frombuffer(
+            data[8 * (num_values + num_counts):], dtype='<f8').reshape(
+                (num_kept,) + tuple(kept.shape[1:]))
+    return seed, done, statistics, histogram
+
+
+def save_statistics(path, key, seed, done, statistics, histogram, kept):
+    """
+    Replaces the checkpoint of run_statistics() at path by one of done
+    finished trajectories with the given statistics, the (timepoints x
+    species) mean, variance, minimum and maximum, histogram (or None) and
+    finished kept trajectories.
+    """
+    parts = [_header(key, seed, done)]
+    parts.extend(_values(values, '<f8') for values in statistics)
+    if histogram is not None:
+        parts.append(_values(histogram, '<i8'))
+    if len(kept):
+        parts.append(_values(kept, '<f8'))
+    _replace(path, b''.join(parts))
@@ -0,0 +1,240 @@
+"""
+Dense, index-based representation of a Model shared by all solvers.
+
+A CompiledModel numbers species, parameters and reactions in the order of
+the model's OrderedDicts and stores the reaction network in CSR form:
+
+  - the stoichiometry matrix (net change of each species per reaction),
+  - the reactant matrix (amount of each species consumed per reaction),
+  - the reaction dependency graph (the reactions whose propensity has to
+    be recomputed after a reaction fires).
+
+All arrays are contiguous and read-only, so the native engines use them in
+place through the buffer protocol. The topology part depends only on
+model_fingerprint() and is built once per topology; parameter values,
+initial populations and the volume are bound each time a CompiledModel is
+created.
+"""
+from collections import OrderedDict
+import numpy as np
+from .gillespyError import *
+from .propensity_compiler import compile_propensities, OP_SPECIES
+
+# Species modes, numbered as in native/model.h.
+SPECIES_MODES = ('dynamic', 'discrete', 'continuous')
+
+# Number of model topologies kept in the cache.
+CACHE_SIZE = 64
+_cache = OrderedDict()
+
+
+def _frozen(values, dtype):
+    array = np.ascontiguousarray(values, dtype=dtype)
+    array.flags.writeable = False
+    return array
+
+
+def _csr(rows, dtype):
+    """ Returns (indptr, indices, values) of a list of {column: value}. """
+    indptr = [0]
+    indices = []
+    values = []
+    for row in rows:
+        for column in sorted(row):
+            indices.append(column)
+            values.append(row[column])
+        indptr.append(len(indices))
+    return (_frozen(indptr, np.int64), _frozen(indices, np.int64),
+            _frozen(values, dtype))
+
+
+class _Topology(object):
+    """ The parameter-independent part of a CompiledModel. """
+
+    def __init__(self, model, propensities):
+        self.species = tuple(model.listOfSpecies.keys())
+        self.parameters = tuple(model.listOfParameters.keys())
+        self.reactions = tuple(model.listOfReactions.keys())
+        self.species_index = dict((s, i) for i, s in enumerate(self.species))
+        self.parameter_index = dict(
+            (p, i) for i, p in enumerate(self.parameters))
+        self.reaction_index = dict(
+            (r, i) for i, r in enumerate(self.reactions))
+
+        reactants = []
+        changes = []
+        for rname in self.reactions:
+            reaction = model.listOfReactions[rname]
+            consumed = {}
+            change = {}
+            for s, n in reaction.reactants.items():
+                i = self.species_index[str(s)]
+                consumed[i] = consumed.get(i, 0) + n
+                change[i] = change.get(i, 0) - n
+            for s, n in reaction.products.items():
+                i = self.species_index[str(s)]
+                change[i] = change.get(i, 0) + n
+            reactants.append(consumed)
+            changes.append(dict((i, n) for i, n in change.items() if n != 0))
+
+        (self.reactant_indptr, self.reactant_indices,
+         self.reactant_values) = _csr(reactants, np.int64)
+        (self.stoich_indptr, self.stoich_indices,
+         self.stoich_values) = _csr(changes, np.float64)
+
+        # Species read by each propensity function.
+        program_species = [set() for _ in self.reactions]
+        code = propensities.program_code.reshape(-1, 2)
+        for r in range(len(self.reactions)):
+            begin = propensities.program_indptr[r]
+            end = propensities.program_indptr[r + 1]
+            for k in range(begin, end):
+                if code[k][0] == OP_SPECIES:
+                    program_species[r].add(int(code[k][1]))
+            begin = propensities.kernel_indptr[r]
+            end = propensities.kernel_indptr[r + 1]
+            for k in range(begin, end):
+                program_species[r].add(int(propensities.kernel_species[k]))
+
+        readers = [[] for _ in self.species]
+        for r, used in enumerate(program_species):
+            for i in used:
+                readers[i].append(r)
+        dependencies = []
+        for change in changes:
+            affected = set()
+            for i in change:
+                affected.update(readers[i])
+            dependencies.append(dict((r, 1) for r in affected))
+        self.dependency_indptr, self.dependency_indices, _ = _csr(
+            dependencies, np.int64)
+
+
+class CompiledModel(object):
+    """
+    Frozen, index-based representation of a Model. Create it with
+    CompiledModel(model); the structural arrays are shared between all
+    CompiledModels of the same model topology. CompiledModels can be
+    pickled, to be simulated in other processes.
+
+    Attributes
+    ----------
+    species, parameters, reactions : tuple of str
+        Names, by index.
+    species_index, parameter_index, reaction_index : dict
+        Index, by name.
+    num_species, num_reactions : int
+        Dimensions of the model.
+    initial_state : numpy ndarray
+        Initial population of each species.
+    species_modes : numpy ndarray
+        Index in Species.MODES of the mode of each species.
+    parameter_values : numpy ndarray
+        Value of each parameter.
+    volume : float
+        The system volume.
+    units : str
+        The units of the model, 'population' or 'concentration'.
+    stoich_indptr, stoich_indices, stoich_values : numpy ndarray
+        Stoichiometry matrix (reactions x species) in CSR form.
+    reactant_indptr, reactant_indices, reactant_values : numpy ndarray
+        Reactant matrix (reactions x species) in CSR form.
+    dependency_indptr, dependency_indices : numpy ndarray
+        For every reaction, the reactions whose propensity changes when it
+        fires, in CSR form.
+    rate_coefficients, kernel_*, program_*, max_stack_depth
+        The bound and compiled propensities, see CompiledPropensities.
+    propensities : CompiledPropensities
+        The compiled propensity functions.
+    """
+
+    def __init__(self, model):
+        model.resolve_parameters()
+        propensities = compile_propensities(model)
+        topology = _cache.pop(propensities.fingerprint, None)
+        if topology is None:
+            topology = _Topology(model, propensities)
+        _cache[propensities.fingerprint] = topology
+        while len(_cache) > CACHE_SIZE:
+            _cache.popitem(last=False)
+
+        fields = self.__dict__
+        fields.update(topology.__dict__)
+        fields['fingerprint'] = propensities.fingerprint
+        fields['propensities'] = propensities
+        fields['num_species'] = len(topology.species)
+        fields['num_reactions'] = len(topology.reactions)
+
+        for pname in topology.parameters:
+            if model.listOfParameters[pname].value is None:
+                raise ParameterError("Could not resolve Parameter expression "
+                                     + pname + " to a scalar value.")
+        fields['initial_state'] = _frozen(
+            [model.listOfSpecies[s].initial_value for s in topology.species],
+            np.float64)
+        fields['species_modes'] = _frozen(
+            [SPECIES_MODES.index(getattr(model.listOfSpecies[s], 'mode',
+                                         'dynamic'))
+             for s in topology.species], np.int64)
+        fields['parameter_values'] = _frozen(
+            [model.listOfParameters[p].value for p in topology.parameters],
+            np.float64)
+        fields['volume'] = float(model.volume)
+        fields['units'] = model.units
+        fields['rate_coefficients'] = _frozen(
+            propensities.rate_coefficients(self.parameter_values, self.volume),
+            np.float64)
+
+        for name in ('kernel_indptr', 'kernel_species', 'kernel_orders',
+                     'program_indptr', 'program_code', 'program_constants',
+                     'max_stack_depth'):
+            fields[name] = getattr(propensities, name)
+
+    def __setattr__(self, name, value):
+        raise AttributeError("CompiledModel is read-only")
+
+    def check_native(self):
+        """
+        Raises a SimulationError if a propensity function cannot be run by
+        the native engines.
+        """
+        if self.propensities.unsupported:
+            rname = sorted(self.propensities.unsupported)[0]
+            raise SimulationError("Cannot compile the propensity function of "
+                "reaction '{0}' for the native solvers: {1}".format(
+                    rname, self.propensities.unsupported[rname]))
+
+    def rate_coefficient_matrix(self, parameter_sets, volumes=None):
+        """
+        Returns the (K x reactions) rate coefficients of the mass-action
+        kernels for a (K x parameters) array of parameter values, one set
+        per row, at the K volumes, or at the model volume if not given.
+        """
+        if volumes is None:
+            volumes = [self.volume] * len(parameter_sets)
+        return np.array([self.propensities.rate_coefficients(values, volume)
+                         for values, volume in zip(parameter_sets, volumes)],
+                        dtype=np.float64)
+
+    def net_changes(self):
+        """
+        Returns the stoichiometry by name, for the Python solvers: an
+        OrderedDict mapping each reaction name to a list of
+        (species name, net change) pairs.
+        """
+        changes = OrderedDict()
+        for r, rname in enumerate(self.reactions):
+            begin = self.stoich_indptr[r]
+            end = self.stoich_indptr[r + 1]
+            changes[rname] = [(self.species[self.stoich_indices[k]],
+                               int(self.stoich_values[k]))
+                              for k in range(begin, end)]
+        return changes
+
+    def stoichiometry_matrix(self):
+        """ Returns the dense (reactions x species) stoichiometry matrix. """
+        dense = np.zeros((self.num_reactions, self.num_species))
+        for r in range(self.num_reactions):
+            for k in range(self.stoich_indptr[r], self.stoich_indptr[r + 1]):
+                dense[r, self.stoich_indices[k]] = self.stoich_values[k]
+        return dense
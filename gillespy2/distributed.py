@@ -0,0 +1,224 @@
+"""
+Ensemble execution across the nodes of a cluster, for the native solvers.
+
+run(), run_statistics() and run_sweep() split an ensemble into shards and
+hand them to an executor: any object with the submit() method of
+concurrent.futures, such as an mpi4py.futures.MPIPoolExecutor, a
+dask.distributed Client, or a concurrent.futures.ProcessPoolExecutor on a
+single machine. The model is compiled once, on the calling node, and every
+shard carries the CompiledModel, so with one shard per worker each worker
+receives the model once and runs its shard on all of its cores.
+
+Shards are ranges of trajectory indices, or of sweep points. Trajectory i
+draws from the random stream (seed, i) wherever it runs, so the
+trajectories are those of one call of the solver with the same seed.
+Statistics are merged in ensemble order by EnsembleStatistics.merge(),
+histograms by adding their counts, and equal those of a single node up to
+rounding. With profile set, the SolverProfiles of the shards are merged
+too, their trajectory_times in shard order.
+"""
+import itertools
+import numpy as np
+from .gillespyError import *
+from .random_streams import random_seed
+
+# Trajectory shards start at multiples of this many trajectories, the
+# STATISTICS_BLOCK of native/statistics.h, so their statistics are
+# accumulated in the same blocks as on a single node.
+SHARD_ALIGNMENT = 64
+
+
+def _run_shard(solver, method, model, kwargs):
+    return getattr(solver, method)(model, **kwargs)
+
+
+def shard_ranges(number_of_trajectories, shards):
+    """
+    Returns the (first trajectory, number of trajectories) pairs of the
+    shards of an ensemble: at most shards of them, starting at multiples
+    of SHARD_ALIGNMENT and as even as that allows.
+    """
+    if shards < 1:
+        raise SimulationError("shards must be at least 1.")
+    blocks = -(-number_of_trajectories // SHARD_ALIGNMENT)
+    shards = max(1, min(shards, blocks))
+    bounds = [min(blocks * k // shards * SHARD_ALIGNMENT,
+                  number_of_trajectories) for k in range(shards + 1)]
+    return [(begin, end - begin) for begin, end in zip(bounds, bounds[1:])]
+
+
+def _compile(solver, model):
+    if not hasattr(solver, 'compile_model'):
+        raise SimulationError("{0} is not a native solver; gillespy2."
+                              "distributed runs NativeSSASolver and its "
+                              "subclasses.".format(solver.__name__))
+    solver.check_engine()
+    return solver.compile_model(model)
+
+
+def _map(executor, solver, method, compiled_model, tasks):
+    futures = [executor.submit(_run_shard, solver, method, compiled_model,
+                               kwargs) for kwargs in tasks]
+    return [future.result() for future in futures]
+
+
+def _trajectory_tasks(number_of_trajectories, shards, first_trajectory,
+                      keep_trajectories, solver_args):
+    """
+    Returns the keyword arguments of every trajectory shard, the first
+    keep_trajectories trajectories of the ensemble kept across them if
+    keep_trajectories is not None.
+    """
+    tasks = []
+    for begin, count in shard_ranges(number_of_trajectories, shards):
+        kwargs = dict(solver_args, number_of_trajectories=count,
+                      first_trajectory=first_trajectory + begin)
+        if keep_trajectories is not None:
+            kwargs['keep_trajectories'] = min(
+                max(keep_trajectories - begin, 0), count)
+        tasks.append(kwargs)
+    return tasks
+
+
+def _merged(shard_statistics):
+    statistics = shard_statistics[0]
+    for other in shard_statistics[1:]:
+        statistics.merge(other)
+    return statistics
+
+
+def _profiled(shard_results, profile):
+    """
+    Splits the results of the shards of a run with profile from their
+    SolverProfiles, and returns them with the merged profile, or as they
+    are with None without profile.
+    """
+    if not profile:
+        return shard_results, None
+    return ([result[:-1] if len(result) > 2 else result[0]
+             for result in shard_results],
+            _merged([result[-1] for result in shard_results]))
+
+
+def run(solver, model, executor, shards, number_of_trajectories=1,
+        seed=None, first_trajectory=0, **run_args):
+    """
+    Returns what solver.run(model, number_of_trajectories=
+    number_of_trajectories, seed=seed, first_trajectory=first_trajectory,
+    **run_args) does, running the ensemble in shards through executor.
+
+    Attributes
+    ----------
+    solver : NativeSSASolver or a subclass
+        The solver class.
+    executor : object
+        Runs the shards, see the module documentation.
+    shards : int
+        Number of shards, usually the number of workers of executor.
+    seed : int
+        The ensemble seed. Optional, defaults to a random seed.
+    """
+    compiled_model = _compile(solver, model)
+    if seed is None:
+        seed = random_seed()
+    tasks = _trajectory_tasks(number_of_trajectories, shards,
+                              first_trajectory, None,
+                              dict(run_args, seed=seed))
+    shard_results, profile = _profiled(
+        _map(executor, solver, 'run', compiled_model, tasks),
+        run_args.get('profile'))
+    results = list(itertools.chain.from_iterable(shard_results))
+    if profile is not None:
+        return results, profile
+    return results
+
+
+def run_statistics(solver, model, executor, shards, number_of_trajectories=1,
+                   seed=None, first_trajectory=0, keep_trajectories=0,
+                   **statistics_args):
+    """
+    Returns what solver.run_statistics() does with these arguments, as
+    EnsembleStatistics of the shards run through executor, merged. See
+    run() for solver, executor, shards and seed.
+    """
+    compiled_model = _compile(solver, model)
+    if not 0 <= keep_trajectories <= number_of_trajectories:
+        raise SimulationError("keep_trajectories must be between 0 and "
+                              "number_of_trajectories.")
+    if seed is None:
+        seed = random_seed()
+    tasks = _trajectory_tasks(number_of_trajectories, shards,
+                              first_trajectory, keep_trajectories,
+                              dict(statistics_args, seed=seed))
+    shard_results, profile = _profiled(
+        _map(executor, solver, 'run_statistics', compiled_model, tasks),
+        statistics_args.get('profile'))
+    if profile is not None:
+        return _merged(shard_results), profile
+    return _merged(shard_results)
+
+
+def run_sweep(solver, model, parameters, executor, shards,
+              parameter_names=None, number_of_trajectories=1, seed=None,
+              first_trajectory=0, statistics=False, keep_trajectories=0,
+              **sweep_args):
+    """
+    Returns what solver.run_sweep() does with these arguments, splitting
+    the sweep points over the shards if there are at least as many points
+    as shards, and the trajectories of every point otherwise. See run()
+    for solver, executor, shards and seed.
+    """
+    compiled_model = _compile(solver, model)
+    if shards < 1:
+        raise SimulationError("shards must be at least 1.")
+    if seed is None:
+        seed = random_seed()
+    if isinstance(parameters, dict):
+        parameter_names = list(parameters)
+        parameters = np.array(list(itertools.product(
+            *[parameters[name] for name in parameter_names])),
+            dtype=np.float64)
+    else:
+        parameters = np.asarray(parameters, dtype=np.float64)
+    sweep_args = dict(sweep_args, parameter_names=parameter_names,
+                      seed=seed, statistics=statistics)
+
+    num_points = len(parameters)
+    if num_points >= shards:
+        bounds = [num_points * k // shards for k in range(shards + 1)]
+        tasks = [dict(sweep_args, parameters=parameters[begin:end],
+                      number_of_trajectories=number_of_trajectories,
+                      first_trajectory=first_trajectory,
+                      keep_trajectories=keep_trajectories)
+                 for begin, end in zip(bounds, bounds[1:])]
+        shard_results, profile = _profiled(
+            _map(executor, solver, 'run_sweep', compiled_model, tasks),
+            sweep_args.get('profile'))
+        points = list(itertools.chain.from_iterable(
+            points for points, _ in shard_results))
+        results = list(itertools.chain.from_iterable(
+            results for _, results in shard_results))
+        if profile is not None:
+            return points, results, profile
+        return points, results
+
+    if not 0 <= keep_trajectories <= number_of_trajectories:
+        raise SimulationError("keep_trajectories must be between 0 and "
+                              "number_of_trajectories.")
+    tasks = _trajectory_tasks(number_of_trajectories, shards,
+                              first_trajectory, keep_trajectories,
+                              dict(sweep_args, parameters=parameters))
+    shard_results, profile = _profiled(
+        _map(executor, solver, 'run_sweep', compiled_model, tasks),
+        sweep_args.get('profile'))
+    points = shard_results[0][0]
+    if statistics:
+        results = [_merged([results[k] for _, results in shard_results])
+                   for k in range(len(points))]
+    else:
+        results = [list(itertools.chain.from_iterable(
+                       results[k] for _, results in shard_results))
+                   for k in range(len(points))]
+    if profile is not None:
+        return points, results, profile
+    return points, results
@@ -14,40 +14,31 @@ improvement over the original.
 from __future__ import division
 
 from collections import OrderedDict
-import scipy as sp
 import numpy as np
-import matplotlib.pyplot as plt
-import tempfile
-import uuid
-import subprocess
 import types
-import random
 from .gillespyError import *
 from .gillespySolver import *
-try:
-    import lxml.etree as etree
-    no_pretty_print = False
-except:
-    import xml.etree.ElementTree as etree
-    import xml.dom.minidom
-    import re
-    no_pretty_print = True
-
-try:
-    import scipy.io as spio
-    isSCIPY = True
-except:
-    pass
-
-import os
-import sys
-try:
-    import shutil
-    import numpy
-except:
-    pass
-
-import pdb
+
+import numpy
+
+# The ElementTree implementation for StochML, see xml_etree().
+_etree = None
+
+
+def xml_etree():
+    """
+    Returns the ElementTree implementation used to read and write StochML,
+    lxml's if it is installed. It is imported on first use only, building
+    and simulating models does not need it.
+    """
+    global _etree
+    if _etree is None:
+        try:
+            import lxml.etree as implementation
+        except ImportError:
+            import xml.etree.ElementTree as implementation
+        _etree = implementation
+    return _etree
 
 
 def import_SBML(filename, name=None, gillespy_model=None):
@@ -127,6 +118,9 @@ class Model(object):
         # Dict that holds flattended parameters and species for
         # evaluation of expressions in the scope of the model.
         self.namespace = OrderedDict([])
+
+        # (structure, StochMLDocument) of the last serialize() call.
+        self.stochml_cache = None
         
         if tspan is None:
             self.timespan(numpy.linspace(0,20,401))
@@ -134,11 +128,30 @@ class Model(object):
         
     
     def serialize(self):
-        """ Serializes the Model object to valid StochML. """
+        """
+        Serializes the Model object to valid StochML. The document is
+        built once per model structure (see StochMLDocument.structure());
+        later calls only rewrite its parameter values and initial
+        populations, so sweeps over parameters do not rebuild the reaction
+        network.
+        """
         self.resolve_parameters()
-        doc = StochMLDocument().from_model(self)
-        return doc.to_string()
+        structure = StochMLDocument.structure(self)
+        cached = getattr(self, 'stochml_cache', None)
+        if cached is not None and cached[0] == structure:
+            doc = cached[1]
+        else:
+            doc = StochMLDocument.from_model(self)
+            self.stochml_cache = (structure, doc)
+        return doc.values_to_string(self)
     
+    def __getstate__(self):
+        # The cached StochML is rebuilt on demand; lxml trees cannot be
+        # pickled, e.g. to send the model to worker processes.
+        state = self.__dict__.copy()
+        state['stochml_cache'] = None
+        return state
+
     def update_namespace(self):
         """ Create a dict with flattened parameter and species objects. """
         self.namespace = OrderedDict([])
@@ -335,21 +348,33 @@ class Model(object):
     def timespan(self, tspan):
         """ 
         Set the time span of simulation. StochKit does not support non-uniform 
-        timespans.
+        timespans, the gillespy2 solvers record at any times.
         
         tspan : numpy ndarray
-            Evenly-spaced list of times at which to sample the species 
-            populations during the simulation.
+            Non-negative, non-decreasing list of times at which to sample the
+            species populations during the simulation.
         """
         
-        items = numpy.diff(tspan)
+        if (len(tspan) == 0 or tspan[0] < 0
+                or any(b < a for a, b in zip(tspan, tspan[1:]))):
+            raise InvalidModelError("The timespan must be non-empty, "
+                                    "non-negative and non-decreasing")
+        self.tspan = tspan
+
+    def solver_times(self):
+        """
+        Returns the t and increment arguments of the solvers for tspan, and
+        timepoints=tspan unless tspan is 0, increment, ..., t.
+        """
+        t = self.tspan[-1]
+        increment = self.tspan[-1] - self.tspan[-2] if len(self.tspan) > 1 \
+            else t
+        items = numpy.diff(self.tspan)
         items = map(lambda x: round(x, 10),items)
         isuniform = (len(set(items)) == 1)
-        
-        if isuniform:
-            self.tspan = tspan
-        else:
-            raise InvalidModelError("StochKit only supports uniform timespans")
+        if isuniform and self.tspan[0] == 0:
+            return {'t': t, 'increment': increment}
+        return {'t': t, 'increment': increment, 'timepoints': self.tspan}
 
     def get_reaction(self, rname):
         return self.listOfReactions[rname]
@@ -364,7 +389,8 @@ class Model(object):
         self.listOfReactions.clear()
 
     def run(self, number_of_trajectories=1, seed=None, 
-                  solver=None, stochkit_home=None, debug=False, show_labels=True):
+                  solver=None, stochkit_home=None, debug=False, show_labels=True,
+                  **solver_args):
         """
         Function calling simulation of the model. There are a number of       
         parameters to be set here.
@@ -389,17 +415,21 @@ class Model(object):
             simulation.
         show_labels : bool (True)
             Use names of species as index of result object rather than position numbers.
+        solver_args
+            Any other keyword arguments are passed on to the solver, e.g.
+            cores=N to spread the trajectories over N processors, or
+            species=[...] to record only some species. A tspan that is not
+            0, increment, ..., t is passed on as timepoints.
         """
+        solver_args = dict(self.solver_times(), **solver_args)
         if solver is not None:
             try:
                 if (isinstance(solver, (type, types.ClassType)) 
                                     and  issubclass(solver, GillesPySolver)):
-                    return solver.run(self, t=self.tspan[-1], 
-                                increment=self.tspan[-1]-self.tspan[-2],
-                                seed=seed, 
+                    return solver.run(self, seed=seed,
                                 number_of_trajectories=number_of_trajectories,
                                 stochkit_home=stochkit_home, debug=debug,
-                                show_labels=show_labels)
+                                show_labels=show_labels, **solver_args)
                 else:
                     raise SimuliationError(
                             "argument 'solver' to run() must be"+
@@ -408,24 +438,50 @@ class Model(object):
                 # for python3 
                 if (isinstance(solver, type) 
                                     and  issubclass(solver, GillesPySolver)):
-                    return solver.run(self, t=self.tspan[-1], 
-                                increment=self.tspan[-1]-self.tspan[-2],
-                                seed=seed, 
+                    return solver.run(self, seed=seed,
                                 number_of_trajectories=number_of_trajectories,
                                 stochkit_home=stochkit_home, debug=debug,
-                                show_labels=show_labels)
+                                show_labels=show_labels, **solver_args)
                 else:
                     raise SimuliationError(
                             "argument 'solver' to run() must be"+
                                         " a subclass of GillesPySolver")
         else:
-            return StochKitSolver.run(self,t=self.tspan[-1],
-                    increment=self.tspan[-1]-self.tspan[-2], seed=seed,
+            return StochKitSolver.run(self, seed=seed,
                     number_of_trajectories=number_of_trajectories,
                     stochkit_home=stochkit_home, debug=debug,
-                    show_labels=show_labels)
+                    show_labels=show_labels, **solver_args)
 
 
+    def run_iter(self, number_of_trajectories=1, seed=None, solver=None,
+                 stochkit_home=None, debug=False, show_labels=True,
+                 **solver_args):
+        """
+        Like run(), but returns a generator that yields the trajectories
+        one at a time, as soon as each is simulated, instead of a list at
+        the end. Analysis or storage can then proceed while the simulation
+        continues, and stopping the iteration, e.g. once an estimate has
+        converged, stops the simulation. The native and Python solvers
+        simulate batch_size trajectories at a time (a solver_args entry,
+        one per core by default) and yield the same trajectories as run();
+        StochKitSolver yields them from its output directory as they are
+        written. See GillesPySolver.run_iter().
+        """
+        if solver is None:
+            solver = StochKitSolver
+        try:
+            valid = issubclass(solver, GillesPySolver)
+        except TypeError:
+            valid = False
+        if not valid:
+            raise SimuliationError("argument 'solver' to run_iter() must be"
+                                   " a subclass of GillesPySolver")
+        solver_args = dict(self.solver_times(), **solver_args)
+        return solver.run_iter(self, seed=seed,
+                               number_of_trajectories=number_of_trajectories,
+                               stochkit_home=stochkit_home, debug=debug,
+                               show_labels=show_labels, **solver_args)
+
 class Species():
     """ 
     Chemical species. Can be added to Model object to interact with other     
@@ -439,14 +495,26 @@ class Species():
     initial_value : int >= 0
         Initial population of this species. If this is not provided as an int,
         the type will be changed when it is added by numpy.int
+    mode : str ('dynamic')
+        How hybrid solvers simulate this species: 'discrete' (molecule by
+        molecule), 'continuous' (as a real-valued concentration), or
+        'dynamic' to switch between the two as its population changes.
+        Other solvers ignore it.
     """
-    
-    def __init__(self, name="", initial_value=0):
+
+    # Allowed values of mode.
+    MODES = ('dynamic', 'discrete', 'continuous')
+
+    def __init__(self, name="", initial_value=0, mode='dynamic'):
         # A species has a name (string) and an initial value (positive integer)
         self.name = name
         self.initial_value = np.int(initial_value)
         assert self.initial_value >= 0, "A species initial value has to \
                                         be a positive number."
+        if mode not in Species.MODES:
+            raise SpeciesError("Species mode must be one of " +
+                               ", ".join(Species.MODES) + ".")
+        self.mode = mode
 
     def __str__(self):
         return self.name
@@ -639,7 +707,7 @@ class Reaction():
             # Case 1: 2X -> Y
             if self.reactants[r] == 2:
                 propensity_function = ("0.5*" +propensity_function+ 
-                                            "*"+r+"*("+r+"-1)/vol")
+                                            "*"+str(r)+"*("+str(r)+"-1)/vol")
             else:
             # Case 3: X1, X2 -> Y;
                 propensity_function += "*"+str(r)
@@ -714,9 +782,78 @@ class StochMLDocument():
         the native StochKit2 XML format. """
     
     def __init__(self):
+        etree = xml_etree()
         # The root element
         self.document = etree.Element("Model")
         self.annotation = None
+        # The Expression and InitialPopulation elements of a document made
+        # by from_model(), by parameter and species name, and the
+        # Expression of the volume.
+        self.parameter_values = {}
+        self.initial_populations = {}
+        self.volume_value = None
+        # to_string() split at those elements' values, see values_to_string().
+        self.template = None
+
+    @classmethod
+    def structure(cls, model):
+        """
+        Returns what the StochML of model depends on besides its parameter
+        values, initial populations and volume: its fingerprint (see
+        propensity_compiler.model_fingerprint()), units, annotation,
+        species descriptions and reaction types, and whether the volume is
+        1.
+        """
+        from .propensity_compiler import model_fingerprint
+        descriptions = [getattr(S, 'description', None)
+                        for S in model.listOfSpecies.values()]
+        reactions = [(R.massaction, R.marate.name if R.massaction else None)
+                     for R in model.listOfReactions.values()]
+        return (model_fingerprint(model), model.units, model.annotation,
+                model.volume == 1.0, tuple(descriptions), tuple(reactions))
+
+    def update_values(self, model):
+        """
+        Rewrites the parameter values, initial populations and volume of a
+        document made by from_model() from model, which must have the same
+        structure and resolved parameters.
+        """
+        for pname, element in self.parameter_values.items():
+            element.text = str(model.listOfParameters[pname].value)
+        for sname, element in self.initial_populations.items():
+            element.text = str(model.listOfSpecies[sname].initial_value)
+        self.volume_value.text = str(float(model.volume))
+
+    def values_to_string(self, model):
+        """
+        Returns to_string() after update_values(model). The document is
+        serialized once, with markers in place of the values, and later
+        calls only fill in the values between the fixed pieces, so their
+        cost does not grow with the reaction network.
+        """
+        self.update_values(model)
+        elements = (list(self.parameter_values.values()) +
+                    list(self.initial_populations.values()) +
+                    [self.volume_value])
+        if self.template is None:
+            import re
+            texts = [element.text for element in elements]
+            for i, element in enumerate(elements):
+                element.text = '@@gillespy2-value-{0}@@'.format(i)
+            text = self.to_string()
+            if not isinstance(text, str):
+                # lxml returns bytes on Python 3.
+                text = text.decode('utf-8')
+            pieces = re.split(r'@@gillespy2-value-(\d+)@@', text)
+            for element, text in zip(elements, texts):
+                element.text = text
+            self.template = (pieces[0::2], [int(i) for i in pieces[1::2]])
+        chunks, order = self.template
+        parts = [chunks[0]]
+        for i, chunk in zip(order, chunks[1:]):
+            parts.append(elements[i].text)
+            parts.append(chunk)
+        return ''.join(parts)
     
     @classmethod
     def from_model(cls,model):
@@ -739,6 +876,7 @@ class StochMLDocument():
             
         """
         
+        etree = xml_etree()
         # Description
         md = cls()
         
@@ -764,16 +902,21 @@ class StochMLDocument():
         # Species
         spec = etree.Element('SpeciesList')
         for sname in model.listOfSpecies:
-            spec.append(md.species_to_element(model.listOfSpecies[sname]))
+            element = md.species_to_element(model.listOfSpecies[sname])
+            md.initial_populations[sname] = element.find('InitialPopulation')
+            spec.append(element)
         md.document.append(spec)
                 
         # Parameters
         params = etree.Element('ParametersList')
         for pname in model.listOfParameters:
-            params.append(md.parameter_to_element(
-                                        model.listOfParameters[pname]))
+            element = md.parameter_to_element(model.listOfParameters[pname])
+            md.parameter_values[pname] = element.find('Expression')
+            params.append(element)
 
-        params.append(md.parameter_to_element(Parameter(name='vol', expression=model.volume)))
+        element = md.parameter_to_element(Parameter(name='vol', expression=model.volume))
+        md.volume_value = element.find('Expression')
+        params.append(element)
 
         md.document.append(params)
         
@@ -790,7 +933,7 @@ class StochMLDocument():
     def from_file(cls,filepath):
         """ Intializes the document from an exisiting native StochKit XML 
         file read from disk. """
-        tree = etree.parse(filepath)
+        tree = xml_etree().parse(filepath)
         root = tree.getroot()
         md = cls()
         md.document = root
@@ -800,7 +943,7 @@ class StochMLDocument():
     def from_string(cls,string):
         """ Intializes the document from an exisiting native StochKit XML 
         file read from disk. """
-        root = etree.fromString(string)
+        root = xml_etree().fromstring(string)
         
         md = cls()
         md.document = root
@@ -980,11 +1123,21 @@ class StochMLDocument():
     
     def to_string(self):
         """ Returns  the document as a string. """
+        etree = xml_etree()
         try:
             return etree.tostring(self.document, pretty_print=True)
         except:
+            if hasattr(etree, 'indent'):
+                # ElementTree indents in place since Python 3.9, far faster
+                # than the minidom round trip below.
+                etree.indent(self.document, space='  ')
+                return ('<?xml version="1.0" ?>\n' +
+                        etree.tostring(self.document, encoding='unicode') +
+                        '\n')
             # Hack to print pretty xml without pretty-print 
             # (requires the lxml module).
+            import re
+            import xml.dom.minidom
             doc = etree.tostring(self.document)
             xmldoc = xml.dom.minidom.parseString(doc)
             uglyXml = xmldoc.toprettyxml(indent='  ')
@@ -993,6 +1146,7 @@ class StochMLDocument():
             return prettyXml
     
     def species_to_element(self,S):
+        etree = xml_etree()
         e = etree.Element('Species')
         idElement = etree.Element('Id')
         idElement.text = S.name
@@ -1010,6 +1164,7 @@ class StochMLDocument():
         return e
     
     def parameter_to_element(self,P):
+        etree = xml_etree()
         e = etree.Element('Parameter')
         idElement = etree.Element('Id')
         idElement.text = P.name
@@ -1020,6 +1175,7 @@ class StochMLDocument():
         return e
     
     def reaction_to_element(self,R, model_volume):
+        etree = xml_etree()
         e = etree.Element('Reaction')
         
         idElement = etree.Element('Id')
@@ -1053,7 +1209,7 @@ class StochMLDocument():
 
         for reactant, stoichiometry in R.reactants.items():
             srElement = etree.Element('SpeciesReference')
-            srElement.set('id', reactant)
+            srElement.set('id', str(reactant))
             srElement.set('stoichiometry', str(stoichiometry))
             reactants.append(srElement)
 
@@ -1062,7 +1218,7 @@ class StochMLDocument():
         products = etree.Element('Products')
         for product, stoichiometry in R.products.items():
             srElement = etree.Element('SpeciesReference')
-            srElement.set('id', product)
+            srElement.set('id', str(product))
             srElement.set('stoichiometry', str(stoichiometry))
             products.append(srElement)
         e.append(products)
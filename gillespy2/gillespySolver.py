@@ -1,4 +1,13 @@
 from .gillespyError import *
+from .trajectory_files import TrajectoryFiles, load_trajectory
+from .random_streams import random_seed
+import numpy
+import os
+import random
+import shutil
+import tempfile
+import time
+import uuid
 class GillesPySolver():
     """ 
     Abstract class for a solver. This is generally called from within a
@@ -37,12 +46,17 @@ class GillesPySolver():
         Use names of species as index of result object rather than position numbers.
     """
 
-    def run(self, model, t=20, number_of_trajectories=1,
-            increment=0.05, seed=None, stochkit_home=None, algorithm=None,
-            job_id=None, extra_args='', debug=False, show_labels=False):
-        """ 
-        Call out and run the solver. Collect the results.
+    def prepare_command(self, model, t, increment, stochkit_home, algorithm,
+                        job_id, extra_args, debug):
+        """
+        Writes the StochKit input files of model to a new temporary folder
+        and returns (cmd, prefix_basedir, prefix_outdir, outdir,
+        ensemblename): the shell command running the solver, the folder,
+        its output folder, the ensemble output directory and the ensemble
+        name.
         """
+        # Imported here, gillespy2.gillespy2 imports this module.
+        from .gillespy2 import Model
         
         if algorithm is None:
             raise SimuliationError("No algorithm selected")
@@ -128,6 +142,21 @@ class GillesPySolver():
         cmd = executable+' '+args+' '+extra_args
         if debug:
             print("cmd: {0}".format(cmd))
+        return cmd, prefix_basedir, prefix_outdir, outdir, ensemblename
+
+    def run(self, model, t=20, number_of_trajectories=1,
+            increment=0.05, seed=None, stochkit_home=None, algorithm=None,
+            job_id=None, extra_args='', debug=False, show_labels=False,
+            lazy=False):
+        """ 
+        Call out and run the solver. Collect the results.
+        """
+        cmd, prefix_basedir, prefix_outdir, outdir, ensemblename = \
+            self.prepare_command(model, t, increment, stochkit_home,
+                                 algorithm, job_id, extra_args, debug)
+
+        # Imported here, only the StochKit solvers start processes.
+        import subprocess
 
         # Execute
         try:
@@ -155,7 +184,11 @@ class GillesPySolver():
 
         # Get data using solver specific function
         try:
-            if show_labels:
+            if lazy:
+                trajectories = self.get_trajectories(outdir, debug=debug,
+                                                     show_labels=show_labels,
+                                                     lazy=True)
+            elif show_labels:
                 labels, trajectories = self.get_trajectories(outdir, debug=debug, show_labels=True)
             else:
                 trajectories = self.get_trajectories(outdir, debug=debug, show_labels=False)
@@ -185,9 +218,14 @@ class GillesPySolver():
             print("prefix_basedir={0}".format(prefix_basedir))
             print("STDOUT: {0}".format(stdout))
             print("STDERR: {0}".format(stderr))
+        elif lazy:
+            # The files are read on access, the ensemble removes them.
+            trajectories.cleanup_directory = prefix_basedir
         else:
             shutil.rmtree(prefix_basedir)
         # Return data
+        if lazy:
+            return trajectories
         if show_labels:
             results2 = []
             for r in trajectories:
@@ -199,6 +237,42 @@ class GillesPySolver():
         else:
             return trajectories
 
+    @classmethod
+    def run_iter(cls, model, t=20, number_of_trajectories=1,
+                 increment=0.05, seed=None, batch_size=None,
+                 first_trajectory=0, **solver_args):
+        """
+        Generator yielding the trajectories of run() one at a time, each as
+        soon as its batch is simulated, so that analysis or storage can
+        proceed while the simulation continues. Batches of batch_size
+        trajectories (cores, or the number of processors, by default) are
+        run by run() with the given seed and consecutive first_trajectory,
+        so the trajectories are those of a single run() call. Stopping the
+        iteration stops the simulation after the current batch. The other
+        arguments are passed on to run().
+        """
+        if seed is None:
+            seed = random_seed()
+        if batch_size is None:
+            batch_size = solver_args.get('cores')
+            if not batch_size:
+                # os.cpu_count() is Python 3 only.
+                import multiprocessing
+                batch_size = multiprocessing.cpu_count()
+        if batch_size < 1:
+            raise SimulationError("batch_size must be at least 1.")
+        done = 0
+        while done < number_of_trajectories:
+            size = min(batch_size, number_of_trajectories - done)
+            for trajectory in cls.run(model, t=t,
+                                      number_of_trajectories=size,
+                                      increment=increment, seed=seed,
+                                      first_trajectory=first_trajectory + done,
+                                      **solver_args):
+                yield trajectory
+            done += size
+
+
 class StochKitSolver(GillesPySolver):
     """ 
     Abstract class for StochKit solver derived from the GillesPySolver class.
@@ -231,12 +305,34 @@ class StochKitSolver(GillesPySolver):
     debug : bool (False)
         Set to True to provide additional debug information about the     
         simulation.
+    cores : int
+        Number of processors StochKit may use. Defaults to 1.
+    lazy : bool (False)
+        Set to True to return a TrajectoryFiles ensemble that reads each
+        trajectory from StochKit's output only when it is first accessed.
+        The output is removed when the ensemble is closed or garbage
+        collected.
+    in_process : bool (False)
+        Set to True to simulate in memory with the equivalent engine of the
+        gillespy2._native extension instead of running the StochKit
+        executable: no model file, subprocess or output files are involved.
+        For 'ssa', method='NRM' selects the next reaction method, any other
+        method the direct method; 'tau_leaping' runs the native
+        tau-leaping engine. Results have the same format.
+    timepoints : array_like
+        Non-decreasing output times, instead of 0, increment, ..., t.
+        Requires in_process; StochKit only writes evenly spaced output.
+    species : list
+        Species or names of the species to record, instead of all of
+        them. Requires in_process.
     """
     
     @classmethod
     def run(cls, model, t=20, number_of_trajectories=1,
             increment=0.05, seed=None, stochkit_home=None, algorithm='ssa',
-            job_id=None, method=None,debug=False, show_labels=False):
+            job_id=None, method=None,debug=False, show_labels=False,
+            cores=1, in_process=False, lazy=False, timepoints=None,
+            species=None):
     
         # all this is specific to StochKit
         if model.units == "concentration":
@@ -245,6 +341,113 @@ class StochKitSolver(GillesPySolver):
                 "stochastic simulation. Use solver = StochKitODESolver "+
                 "instead to simulate a concentration model deterministically.")
 
+        if in_process:
+            return cls.run_in_process(model, t, number_of_trajectories,
+                                      increment, seed, algorithm, method,
+                                      debug, show_labels, cores, timepoints,
+                                      species)
+        cls.check_output_selection(timepoints, species)
+
+        args = cls.stochkit_args(seed, number_of_trajectories, method, cores)
+
+        self = StochKitSolver()
+        return GillesPySolver.run(self, model,t, number_of_trajectories, 
+                                  increment, seed, stochkit_home,
+                                  algorithm, 
+                                  job_id, extra_args=args, debug=debug,
+                                  show_labels=show_labels, lazy=lazy)
+
+    @classmethod
+    def run_iter(cls, model, t=20, number_of_trajectories=1,
+                 increment=0.05, seed=None, stochkit_home=None,
+                 algorithm='ssa', job_id=None, method=None, debug=False,
+                 show_labels=False, cores=1, in_process=False,
+                 batch_size=None, poll_interval=0.1, timepoints=None,
+                 species=None):
+        """
+        Generator yielding the trajectories of run() one at a time. StochKit
+        is started in the background and each trajectory is read from its
+        output directory as soon as StochKit has completely written it,
+        i.e. once the next one exists or StochKit has exited; closing the
+        generator early terminates StochKit, and the temporary files are
+        always removed. With cores other than 1, StochKit splits the
+        realizations over several processes, which write their files in
+        no particular order, so the trajectories are only yielded once it
+        has exited. With in_process, the trajectories come in batches
+        from the native solver, see GillesPySolver.run_iter().
+        """
+        if model.units == "concentration":
+            raise SimuliationError("StochKit can only simulate population "
+                                   "models.")
+        if in_process:
+            solver = cls.native_solver(algorithm, method)
+            for trajectory in solver.run_iter(
+                    model, t=t, number_of_trajectories=number_of_trajectories,
+                    increment=increment, seed=seed, batch_size=batch_size,
+                    debug=debug, show_labels=show_labels, cores=cores,
+                    timepoints=timepoints, species=species):
+                yield trajectory
+            return
+        cls.check_output_selection(timepoints, species)
+
+        args = cls.stochkit_args(seed, number_of_trajectories, method, cores)
+        self = StochKitSolver()
+        cmd, prefix_basedir, prefix_outdir, outdir, ensemblename = \
+            self.prepare_command(model, t, increment, stochkit_home,
+                                 algorithm, job_id, args, debug)
+        import subprocess
+        directory = os.path.join(outdir, 'trajectories')
+        # StochKit writes to a file, a full pipe would block it while the
+        # trajectories are consumed.
+        log = open(os.path.join(prefix_basedir, 'stochkit_log.txt'), 'w+')
+        try:
+            handle = subprocess.Popen(cmd, stdout=log,
+                                      stderr=subprocess.STDOUT, shell=True)
+        except OSError as e:
+            log.close()
+            shutil.rmtree(prefix_basedir, ignore_errors=True)
+            raise SimuliationError("Solver execution failed: "
+                                   "{0}\n{1}".format(cmd, e))
+
+        def path(i):
+            return os.path.join(directory, 'trajectory{0}.txt'.format(i))
+
+        try:
+            i = 0
+            while i < number_of_trajectories:
+                finished = handle.poll() is not None
+                # With a single process, StochKit starts trajectory i + 1 only
+                # once trajectory i is written.
+                if os.path.isfile(path(i)) and (finished or (
+                        cores == 1 and os.path.isfile(path(i + 1)))):
+                    trajectory = load_trajectory(path(i), 0)
+                    if show_labels:
+                        with open(path(i)) as f:
+                            labels = f.readline().split()
+                        trajectory = dict((l, trajectory[:, n])
+                                          for n, l in enumerate(labels))
+                    yield trajectory
+                    i += 1
+                elif finished:
+                    log.seek(0)
+                    raise SimuliationError("Solver execution failed: '{0}' "
+                                           "output: {1}".format(cmd,
+                                                                log.read()))
+                else:
+                    time.sleep(poll_interval)
+        finally:
+            if handle.poll() is None:
+                handle.kill()
+                handle.wait()
+            log.close()
+            if debug:
+                print("prefix_basedir={0}".format(prefix_basedir))
+            else:
+                shutil.rmtree(prefix_basedir, ignore_errors=True)
+
+    @classmethod
+    def stochkit_args(cls, seed, number_of_trajectories, method, cores):
+        """ Returns the StochKit arguments of an ensemble run. """
         if seed is None:
             seed = random.randint(0, 2147483647)
         # StochKit breaks for long ints
@@ -253,8 +456,9 @@ class StochKitSolver(GillesPySolver):
             if seed > (1 << 31) -1:
                 seed -= 1 << 32
 
-        # Only use on processor per StochKit job.
-        args = ' -p 1'
+        # StochKit splits the realizations over this many processors, and
+        # its results depend on the split, so one is used unless asked.
+        args = ' -p ' + str(cores)
       
         # We keep all the trajectories by default.
         args += ' --keep-trajectories'
@@ -269,37 +473,67 @@ class StochKitSolver(GillesPySolver):
 
         if method is not None:  #This only works for StochKit 2.1
             args += ' --method ' + str(method)
+        return args
 
-        
-        self = StochKitSolver()
-        return GillesPySolver.run(self, model,t, number_of_trajectories, 
-                                  increment, seed, stochkit_home,
-                                  algorithm, 
-                                  job_id, extra_args=args, debug=debug,
-                                  show_labels=show_labels)
+    @classmethod
+    def check_output_selection(cls, timepoints, species):
+        """
+        Raises SimulationError if output times or species were selected,
+        which the StochKit executables do not support.
+        """
+        if timepoints is not None or species is not None:
+            raise SimulationError("StochKit records all species at evenly "
+                                  "spaced times; use in_process=True or "
+                                  "another solver for timepoints or "
+                                  "species.")
 
+    @classmethod
+    def run_in_process(cls, model, t, number_of_trajectories, increment,
+                       seed, algorithm, method, debug, show_labels, cores,
+                       timepoints=None, species=None):
+        """
+        Runs the native engine matching a StochKit algorithm and method.
+        """
+        solver = cls.native_solver(algorithm, method)
+        return solver.run(model, t=t,
+                          number_of_trajectories=number_of_trajectories,
+                          increment=increment, seed=seed, debug=debug,
+                          show_labels=show_labels, cores=cores,
+                          timepoints=timepoints, species=species)
 
-    def get_trajectories(self, outdir, debug=False, show_labels=False):
-        # Collect all the output data
-        files = os.listdir(outdir + '/stats')
-        trajectories = []
-        files = os.listdir(outdir + '/trajectories')
-        labels = []
-        if show_labels:
-            with open(outdir + '/trajectories/trajectory0.txt', 'r') as f:
-                first_line= f.readline()
-                labels = first_line.split()
-        for filename in files:
-            if 'trajectory' in filename:
-                trajectories.append(numpy.loadtxt(outdir + '/trajectories/' + 
-                                        filename, skiprows=1))
+    @classmethod
+    def native_solver(cls, algorithm, method):
+        """
+        Returns the native solver matching a StochKit algorithm and method.
+        """
+        # Imported here, the native solvers are built on this module.
+        from .native_ssa_solver import (NativeSSASolver,
+                                        NativeNextReactionSolver,
+                                        NativeTauLeapingSolver)
+        if algorithm == 'ssa':
+            if method == 'NRM':
+                solver = NativeNextReactionSolver
             else:
-                raise SimuliationError("Couldn't identify file '{0}' found in \
-                                        output folder".format(filename))
-        if show_labels:
-            return (labels, trajectories)
+                solver = NativeSSASolver
+        elif algorithm == 'tau_leaping':
+            solver = NativeTauLeapingSolver
         else:
+            raise SimulationError("StochKit algorithm '{0}' cannot be run "
+                                  "in process.".format(algorithm))
+        return solver
+
+
+    def get_trajectories(self, outdir, debug=False, show_labels=False,
+                         lazy=False):
+        # Collect all the output data, in trajectory order
+        trajectories = TrajectoryFiles(os.path.join(outdir, 'trajectories'),
+                                       show_labels=lazy and show_labels)
+        if lazy:
             return trajectories
+        if show_labels:
+            return (trajectories.labels, list(trajectories))
+        else:
+            return list(trajectories)
 
 
 class StochKitODESolver(GillesPySolver):
@@ -336,7 +570,9 @@ class StochKitODESolver(GillesPySolver):
     def run(cls, model, t=20, number_of_trajectories=1,
                 increment=0.05, seed=None, stochkit_home=None, 
                 algorithm='stochkit_ode.py',
-                job_id=None, debug=False, show_labels=False):
+                job_id=None, debug=False, show_labels=False,
+                timepoints=None, species=None):
+        StochKitSolver.check_output_selection(timepoints, species)
         self = StochKitODESolver()
         return GillesPySolver.run(self,model,t, number_of_trajectories, 
                                   increment, seed, stochkit_home,
@@ -344,21 +580,26 @@ class StochKitODESolver(GillesPySolver):
                                   job_id, debug=debug,
                                   show_labels=show_labels)
 
+    @classmethod
+    def run_iter(cls, model, t=20, number_of_trajectories=1,
+                 increment=0.05, seed=None, batch_size=None, **solver_args):
+        """ Yields the solution of run(). """
+        for trajectory in cls.run(model, t=t, increment=increment,
+                                  seed=seed, **solver_args):
+            yield trajectory
+
     def get_trajectories(self, outdir, debug=False, show_labels=False):
         if debug:
             print("StochKitODESolver.get_trajectories(outdir={0}".format(outdir))
         # Collect all the output data
-        trajectories = []
         with open(outdir + '/output.txt') as fd:
-            fd.readline()
-            headers = fd.readline()
-            fd.readline()
-            data = []
-            data.append([float(x) for x in fd.readline().split()])
-            fd.readline()
-            for line in fd:
-                data.append([float(x) for x in line.split()])
-        trajectories.append(numpy.array(data))
+            # Lines 1, 3 and 5 are not data, line 2 holds the labels. A
+            # single timepoint has no line 6.
+            lines = fd.read().split('\n', 5)
+        headers = lines[1]
+        rest = lines[5] if len(lines) > 5 else ''
+        data = numpy.fromstring(lines[3] + ' ' + rest, sep=' ')
+        trajectories = [data.reshape(-1, len(headers.split()))]
         if show_labels:
             return (headers.split(), trajectories)
         else:
@@ -0,0 +1,14 @@
+/*
+ * Annotations for code shared by the host engines and the CUDA backend
+ * (gpu.h). Without nvcc they expand to nothing.
+ */
+#ifndef GILLESPY2_NATIVE_DEVICE_H
+#define GILLESPY2_NATIVE_DEVICE_H
+
+#ifdef __CUDACC__
+#define GILLESPY2_HOST_DEVICE __host__ __device__
+#else
+#define GILLESPY2_HOST_DEVICE
+#endif
+
+#endif
@@ -0,0 +1,93 @@
+/*
+ * Parallel execution of independent trajectories.
+ */
+#ifndef GILLESPY2_NATIVE_ENSEMBLE_H
+#define GILLESPY2_NATIVE_ENSEMBLE_H
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace gillespy2 {
+
+// Number of threads to use for num_tasks tasks when cores are requested;
+// cores <= 0 selects all hardware threads.
+inline int64_t ensemble_threads(int64_t cores, int64_t num_tasks)
+{
+    if (cores <= 0) {
+        cores = std::thread::hardware_concurrency();
+    }
+    if (cores > num_tasks) {
+        cores = num_tasks;
+    }
+    return cores > 1 ? cores : 1;
+}
+
+// Calls task(i) once for every i in [0, num_tasks) on num_threads threads.
+//
+// Tasks are claimed one at a time from a shared counter rather than split
+// into fixed blocks up front, so a thread that draws short trajectories
+// simply takes more of them and no thread idles while work remains. Each
+// task must write only its own output, which makes the results
+// independent of the number of threads and of scheduling order. The first
+// exception thrown by a task stops the remaining work and is rethrown
+// here.
+template <class Task>
+void run_ensemble(int64_t num_tasks, int64_t num_threads, const Task &task)
+{
+    if (num_threads <= 1) {
+        for (int64_t i = 0; i < num_tasks; ++i) {
+            task(i);
+        }
+        return;
+    }
+
+    std::atomic<int64_t> next_task(0);
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto worker = [&]() {
+        for (;;) {
+            const int64_t i = next_task.fetch_add(1);
+            if (i >= num_tasks) {
+                return;
+            }
+            try {
+                task(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                next_task.store(num_tasks);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads - 1);
+    for (int64_t k = 1; k < num_threads; ++k) {
+        try {
+            threads.push_back(std::thread(worker));
+        } catch (const std::system_error &) {
+            // Out of threads, carry on with those already running.
+            break;
+        }
+    }
+    worker();
+    for (size_t k = 0; k < threads.size(); ++k) {
+        threads[k].join();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+} // namespace gillespy2
+
+#endif
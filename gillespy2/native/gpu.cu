@@ -0,0 +1,300 @@
+#include "gpu.h"
+
+#include <cuda_runtime.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "gpu_ssa.h"
+#include "random.h"
+#include "statistics.h"
+
+namespace gillespy2 {
+
+namespace {
+
+// Threads per CUDA block of the kernels below.
+const int THREADS_PER_BLOCK = 128;
+
+// Device memory for the values and the scratch space of one wave of
+// trajectories. Waves are a multiple of STATISTICS_BLOCK trajectories
+// long, so the blocks of the statistics are those of the CPU engines.
+const int64_t WAVE_BYTES = int64_t(512) << 20;
+const int64_t MAX_WAVE = int64_t(1) << 20;
+
+#define GILLESPY2_CUDA_CHECK(call)                                          \
+    do {                                                                    \
+        const cudaError_t status = (call);                                  \
+        if (status != cudaSuccess) {                                        \
+            return cudaGetErrorString(status);                              \
+        }                                                                   \
+    } while (0)
+
+// Device array of count elements, freed on destruction.
+template <class T> class DeviceArray {
+public:
+    DeviceArray() : data_(NULL) {}
+    ~DeviceArray()
+    {
+        if (data_ != NULL) {
+            cudaFree(data_);
+        }
+    }
+
+    cudaError_t allocate(int64_t count)
+    {
+        return cudaMalloc(reinterpret_cast<void **>(&data_),
+                          std::max<int64_t>(count, 1) * sizeof(T));
+    }
+
+    // Allocates count elements and copies them from host.
+    cudaError_t upload(const T *host, int64_t count)
+    {
+        const cudaError_t status = allocate(count);
+        if (status != cudaSuccess || count == 0) {
+            return status;
+        }
+        return cudaMemcpy(data_, host, count * sizeof(T),
+                          cudaMemcpyHostToDevice);
+    }
+
+    T *get() const { return data_; }
+
+private:
+    T *data_;
+
+    DeviceArray(const DeviceArray &);
+    DeviceArray &operator=(const DeviceArray &);
+};
+
+// Device copies of the arrays of a ModelView and a Timeline.
+struct DeviceModel {
+    DeviceArray<double> initial_state;
+    DeviceArray<int64_t> species_modes;
+    DeviceArray<int64_t> kernel_indptr;
+    DeviceArray<int64_t> kernel_species;
+    DeviceArray<int64_t> kernel_orders;
+    DeviceArray<double> rate_coefficients;
+    DeviceArray<int64_t> stoich_indptr;
+    DeviceArray<int64_t> stoich_indices;
+    DeviceArray<double> stoich_values;
+    DeviceArray<int64_t> reactant_indptr;
+    DeviceArray<int64_t> reactant_indices;
+    DeviceArray<int64_t> reactant_values;
+    DeviceArray<int64_t> dependency_indptr;
+    DeviceArray<int64_t> dependency_indices;
+    DeviceArray<int64_t> program_indptr;
+    DeviceArray<int64_t> program_code;
+    DeviceArray<double> program_constants;
+    DeviceArray<double> parameter_values;
+    DeviceArray<double> times;
+    DeviceArray<int64_t> species;
+
+    // Copies model and timeline to the device, and points view and
+    // device_timeline at the copies.
+    cudaError_t upload(const ModelView &model, int64_t num_constants,
+                       int64_t num_parameters, const Timeline &timeline,
+                       ModelView &view, Timeline &device_timeline)
+    {
+        const int64_t S = model.num_species, R = model.num_reactions;
+        cudaError_t status;
+        if ((status = initial_state.upload(model.initial_state, S)) ||
+            (status = species_modes.upload(model.species_modes, S)) ||
+            (status = kernel_indptr.upload(model.kernel_indptr, R + 1)) ||
+            (status = kernel_species.upload(model.kernel_species,
+                                            model.kernel_indptr[R])) ||
+            (status = kernel_orders.upload(model.kernel_orders,
+                                           model.kernel_indptr[R])) ||
+            (status = rate_coefficients.upload(model.rate_coefficients, R)) ||
+            (status = stoich_indptr.upload(model.stoich_indptr, R + 1)) ||
+            (status = stoich_indices.upload(model.stoich_indices,
+                                            model.stoich_indptr[R])) ||
+            (status = stoich_values.upload(model.stoich_values,
+                                           model.stoich_indptr[R])) ||
+            (status = reactant_indptr.upload(model.reactant_indptr, R + 1)) ||
+            (status = reactant_indices.upload(model.reactant_indices,
+                                              model.reactant_indptr[R])) ||
+            (status = reactant_values.upload(model.reactant_values,
+                                             model.reactant_indptr[R])) ||
+            (status = dependency_indptr.upload(model.dependency_indptr,
+                                               R + 1)) ||
+            (status = dependency_indices.upload(model.dependency_indices,
+                                                model.dependency_indptr[R])) ||
+            (status = program_indptr.upload(model.program_indptr, R + 1)) ||
+            (status = program_code.upload(model.program_code,
+                                          2 * model.program_indptr[R])) ||
+            (status = program_constants.upload(model.program_constants,
+                                               num_constants)) ||
+            (status = parameter_values.upload(model.parameter_values,
+                                              num_parameters)) ||
+            (status = times.upload(timeline.times, timeline.num_times)) ||
+            (status = species.upload(timeline.species,
+                                     timeline.num_species))) {
+            return status;
+        }
+        view = model;
+        view.initial_state = initial_state.get();
+        view.species_modes = species_modes.get();
+        view.kernel_indptr = kernel_indptr.get();
+        view.kernel_species = kernel_species.get();
+        view.kernel_orders = kernel_orders.get();
+        view.rate_coefficients = rate_coefficients.get();
+        view.stoich_indptr = stoich_indptr.get();
+        view.stoich_indices = stoich_indices.get();
+        view.stoich_values = stoich_values.get();
+        view.reactant_indptr = reactant_indptr.get();
+        view.reactant_indices = reactant_indices.get();
+        view.reactant_values = reactant_values.get();
+        view.dependency_indptr = dependency_indptr.get();
+        view.dependency_indices = dependency_indices.get();
+        view.program_indptr = program_indptr.get();
+        view.program_code = program_code.get();
+        view.program_constants = program_constants.get();
+        view.parameter_values = parameter_values.get();
+        device_timeline = timeline;
+        device_timeline.times = times.get();
+        device_timeline.species = species.get();
+        return cudaSuccess;
+    }
+};
+
+// Simulates trajectories first + j, j < count, into values, one per
+// thread.
+__global__ void simulate(ModelView model, Timeline timeline, uint64_t seed,
+                         uint64_t first, int64_t count, int64_t scratch_size,
+                         double *scratch, double *values)
+{
+    const int64_t j =
+        static_cast<int64_t>(blockIdx.x) * blockDim.x + threadIdx.x;
+    if (j >= count) {
+        return;
+    }
+    double *x = scratch + j * scratch_size;
+    double *a = x + model.num_species;
+    double *stack = a + model.num_reactions;
+    Random random(seed, first + j);
+    device_ssa_direct(model, timeline, random, x, a, stack,
+                      values + j * timeline.num_times * timeline.num_species);
+}
+
+// Adds the count trajectories in values to the running statistics, one
+// output value per thread.
+__global__ void reduce(const double *values, int64_t count,
+                       int64_t num_values, ValueStatistics *totals)
+{
+    const int64_t v =
+        static_cast<int64_t>(blockIdx.x) * blockDim.x + threadIdx.x;
+    if (v < num_values) {
+        reduce_value(values, count, num_values, v, totals[v]);
+    }
+}
+
+__global__ void clear(int64_t num_values, ValueStatistics *totals)
+{
+    const int64_t v =
+        static_cast<int64_t>(blockIdx.x) * blockDim.x + threadIdx.x;
+    if (v < num_values) {
+        totals[v] = empty_statistics();
+    }
+}
+
+unsigned int grid_size(int64_t threads)
+{
+    return static_cast<unsigned int>((threads + THREADS_PER_BLOCK - 1) /
+                                     THREADS_PER_BLOCK);
+}
+
+} // namespace
+
+std::string gpu_ssa_direct(const ModelView &model, int64_t num_constants,
+                           int64_t num_parameters, const Timeline &timeline,
+                           uint64_t seed, uint64_t first_trajectory,
+                           int64_t num_trajectories, int64_t num_kept,
+                           double *kept, double *statistics, int device)
+{
+    GILLESPY2_CUDA_CHECK(cudaSetDevice(device));
+
+    ModelView view;
+    Timeline device_timeline;
+    DeviceModel device_model;
+    GILLESPY2_CUDA_CHECK(device_model.upload(model, num_constants,
+                                             num_parameters, timeline, view,
+                                             device_timeline));
+
+    const int64_t num_values = timeline.num_times * timeline.num_species;
+    const int64_t scratch_size =
+        model.num_species + model.num_reactions + model.max_stack_depth + 1;
+    int64_t wave = WAVE_BYTES / (sizeof(double) * (num_values + scratch_size));
+    wave = std::min(wave, MAX_WAVE) / STATISTICS_BLOCK * STATISTICS_BLOCK;
+    wave = std::max(wave, STATISTICS_BLOCK);
+    wave = std::min(wave, (num_trajectories + STATISTICS_BLOCK - 1) /
+                              STATISTICS_BLOCK * STATISTICS_BLOCK);
+
+    DeviceArray<double> values, scratch;
+    DeviceArray<ValueStatistics> totals;
+    GILLESPY2_CUDA_CHECK(values.allocate(wave * num_values));
+    GILLESPY2_CUDA_CHECK(scratch.allocate(wave * scratch_size));
+    if (statistics != NULL) {
+        GILLESPY2_CUDA_CHECK(totals.allocate(num_values));
+        clear<<<grid_size(num_values), THREADS_PER_BLOCK>>>(num_values,
+                                                          totals.get());
+        GILLESPY2_CUDA_CHECK(cudaGetLastError());
+    }
+
+    const int64_t trajectory_size =
+        timeline.num_times * (timeline.num_species + 1);
+    std::vector<double> rows;
+    for (int64_t begin = 0; begin < num_trajectories; begin += wave) {
+        const int64_t count = std::min(wave, num_trajectories - begin);
+        simulate<<<grid_size(count), THREADS_PER_BLOCK>>>(
+            view, device_timeline, seed, first_trajectory + begin, count,
+            scratch_size, scratch.get(), values.get());
+        GILLESPY2_CUDA_CHECK(cudaGetLastError());
+        if (statistics != NULL) {
+            reduce<<<grid_size(num_values), THREADS_PER_BLOCK>>>(
+                values.get(), count, num_values, totals.get());
+            GILLESPY2_CUDA_CHECK(cudaGetLastError());
+        }
+
+        // Kept trajectories are copied back with the time column added.
+        const int64_t num_rows = std::min(count, num_kept - begin);
+        if (num_rows <= 0) {
+            continue;
+        }
+        rows.resize(num_rows * num_values);
+        GILLESPY2_CUDA_CHECK(cudaMemcpy(rows.data(), values.get(),
+                                        rows.size() * sizeof(double),
+                                        cudaMemcpyDeviceToHost));
+        for (int64_t j = 0; j < num_rows; ++j) {
+            double *out = kept + (begin + j) * trajectory_size;
+            for (int64_t k = 0; k < timeline.num_times; ++k) {
+                out[k * (timeline.num_species + 1)] = timeline.times[k];
+                std::copy(rows.begin() + (j * timeline.num_times + k) *
+                                             timeline.num_species,
+                          rows.begin() + (j * timeline.num_times + k + 1) *
+                                             timeline.num_species,
+                          out + k * (timeline.num_species + 1) + 1);
+            }
+        }
+    }
+
+    if (statistics != NULL) {
+        std::vector<ValueStatistics> host(num_values);
+        GILLESPY2_CUDA_CHECK(cudaMemcpy(host.data(), totals.get(),
+                                        num_values * sizeof(ValueStatistics),
+                                        cudaMemcpyDeviceToHost));
+        for (int64_t v = 0; v < num_values; ++v) {
+            const double denominator =
+                host[v].count > 1 ? host[v].count - 1.0 : 1.0;
+            statistics[v] = host[v].mean;
+            statistics[num_values + v] = host[v].m2 / denominator;
+            statistics[2 * num_values + v] = host[v].min;
+            statistics[3 * num_values + v] = host[v].max;
+        }
+    }
+    GILLESPY2_CUDA_CHECK(cudaDeviceSynchronize());
+    return std::string();
+}
+
+} // namespace gillespy2
@@ -0,0 +1,41 @@
+/*
+ * CUDA backend: direct method ensembles with one trajectory per device
+ * thread. Compiled into the extension, from gpu.cu, only when setup.py
+ * finds the CUDA toolkit, which then defines GILLESPY2_CUDA.
+ *
+ * The compiled model is copied to the device once per call. Every thread
+ * simulates one trajectory (gpu_ssa.h) from the counter-based random
+ * stream of its ensemble index, so trajectory i is the same on any device
+ * and any launch configuration. Trajectories run in waves that fit a
+ * fixed device memory budget; the statistics of each wave are reduced on
+ * the device into running totals, so only the totals and the kept
+ * trajectories are copied back to the host.
+ */
+#ifndef GILLESPY2_NATIVE_GPU_H
+#define GILLESPY2_NATIVE_GPU_H
+
+#include <cstdint>
+#include <string>
+
+#include "model.h"
+#include "ssa.h"
+
+namespace gillespy2 {
+
+// Runs the trajectories first_trajectory + i, 0 <= i < num_trajectories,
+// of model with the given seed on CUDA device number device. The first
+// num_kept of them are written to kept in the layout of ssa_direct(). If
+// statistics is not NULL, the running statistics of all of them are
+// written to it as by EnsembleStatistics::write(). num_constants and
+// num_parameters are the lengths of model.program_constants and
+// model.parameter_values. Returns the CUDA error message on failure and
+// an empty string otherwise.
+std::string gpu_ssa_direct(const ModelView &model, int64_t num_constants,
+                           int64_t num_parameters, const Timeline &timeline,
+                           uint64_t seed, uint64_t first_trajectory,
+                           int64_t num_trajectories, int64_t num_kept,
+                           double *kept, double *statistics, int device);
+
+} // namespace gillespy2
+
+#endif
@@ -0,0 +1,162 @@
+/*
+ * The work of one device thread of the CUDA backend (gpu.h): a direct
+ * method trajectory, or the statistics of one output value over a batch
+ * of trajectories. Written as host/device functions, so they also run,
+ * and give the same results, on the host.
+ */
+#ifndef GILLESPY2_NATIVE_GPU_SSA_H
+#define GILLESPY2_NATIVE_GPU_SSA_H
+
+#include <cmath>
+#include <cstdint>
+
+#include "device.h"
+#include "model.h"
+#include "propensity.h"
+#include "random.h"
+#include "ssa.h"
+#include "statistics.h"
+
+namespace gillespy2 {
+
+// Simulates one trajectory by the direct method with the linear reaction
+// selection of ssa_direct() and writes the recorded populations to
+// values, timeline.num_times rows of timeline.num_species values without
+// the time column. x, a and stack are scratch space for
+// model.num_species, model.num_reactions and model.max_stack_depth + 1
+// values.
+GILLESPY2_HOST_DEVICE
+inline void device_ssa_direct(const ModelView &model,
+                              const Timeline &timeline, Random &random,
+                              double *x, double *a, double *stack,
+                              double *values)
+{
+    for (int64_t i = 0; i < model.num_species; ++i) {
+        x[i] = model.initial_state[i];
+    }
+    for (int64_t r = 0; r < model.num_reactions; ++r) {
+        a[r] = propensity(model, r, x, stack);
+    }
+
+    double t = 0.0;
+    int64_t next_output = 0;
+    while (next_output < timeline.num_times) {
+        double propensity_sum = 0.0;
+        for (int64_t r = 0; r < model.num_reactions; ++r) {
+            propensity_sum += a[r];
+        }
+
+        // Nothing can fire anymore, the state is final.
+        if (propensity_sum <= 0.0) {
+            break;
+        }
+
+        t += random.exponential(propensity_sum);
+
+        // The current state holds until the next firing time.
+        while (next_output < timeline.num_times &&
+               timeline.times[next_output] < t) {
+            for (int64_t s = 0; s < timeline.num_species; ++s) {
+                values[next_output * timeline.num_species + s] =
+                    x[timeline.species[s]];
+            }
+            ++next_output;
+        }
+        if (next_output == timeline.num_times) {
+            break;
+        }
+
+        const double target = random.uniform() * propensity_sum;
+        double cumulative_sum = 0.0;
+        int64_t reaction = 0;
+        for (int64_t r = 0; r < model.num_reactions; ++r) {
+            if (a[r] > 0.0) {
+                cumulative_sum += a[r];
+                reaction = r;
+                if (cumulative_sum > target) {
+                    break;
+                }
+            }
+        }
+        fire_reaction(model, reaction, x);
+        for (int64_t k = model.dependency_indptr[reaction];
+             k < model.dependency_indptr[reaction + 1]; ++k) {
+            const int64_t r = model.dependency_indices[k];
+            a[r] = propensity(model, r, x, stack);
+        }
+    }
+
+    for (; next_output < timeline.num_times; ++next_output) {
+        for (int64_t s = 0; s < timeline.num_species; ++s) {
+            values[next_output * timeline.num_species + s] =
+                x[timeline.species[s]];
+        }
+    }
+}
+
+// Running statistics of a single output value, updated and merged like
+// those of EnsembleStatistics.
+struct ValueStatistics {
+    int64_t count;
+    double mean, m2, min, max;
+};
+
+GILLESPY2_HOST_DEVICE
+inline ValueStatistics empty_statistics()
+{
+    ValueStatistics s = {0, 0.0, 0.0, INFINITY, -INFINITY};
+    return s;
+}
+
+GILLESPY2_HOST_DEVICE
+inline void add_value(ValueStatistics &s, double x)
+{
+    ++s.count;
+    const double weight = 1.0 / s.count;
+    const double delta = x - s.mean;
+    s.mean += delta * weight;
+    s.m2 += delta * (x - s.mean);
+    s.min = x < s.min ? x : s.min;
+    s.max = s.max < x ? x : s.max;
+}
+
+GILLESPY2_HOST_DEVICE
+inline void merge_statistics(ValueStatistics &s, const ValueStatistics &other)
+{
+    if (other.count == 0) {
+        return;
+    }
+    const double n = static_cast<double>(s.count);
+    const double m = static_cast<double>(other.count);
+    const double total = n + m;
+    const double delta = other.mean - s.mean;
+    s.mean += delta * (m / total);
+    s.m2 += other.m2 + delta * delta * (n * m / total);
+    s.min = other.min < s.min ? other.min : s.min;
+    s.max = s.max < other.max ? other.max : s.max;
+    s.count += other.count;
+}
+
+// Adds value v of the count trajectories in values, num_values each, to
+// total, in blocks of STATISTICS_BLOCK trajectories merged in order, as
+// the CPU engines do.
+GILLESPY2_HOST_DEVICE
+inline void reduce_value(const double *values, int64_t count,
+                         int64_t num_values, int64_t v,
+                         ValueStatistics &total)
+{
+    for (int64_t begin = 0; begin < count; begin += STATISTICS_BLOCK) {
+        const int64_t end =
+            begin + STATISTICS_BLOCK < count ? begin + STATISTICS_BLOCK
+                                             : count;
+        ValueStatistics block = empty_statistics();
+        for (int64_t j = begin; j < end; ++j) {
+            add_value(block, values[j * num_values + v]);
+        }
+        merge_statistics(total, block);
+    }
+}
+
+} // namespace gillespy2
+
+#endif
@@ -0,0 +1,393 @@
+#include "ssa.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "propensity.h"
+#include "random.h"
+#include "reaction_mask.h"
+
+namespace gillespy2 {
+
+namespace {
+
+// How the species a reaction changes let it be simulated.
+enum ReactionKind {
+    // Changes no species; never needs to be simulated.
+    INERT,
+    // Changes a discrete species, always fires exactly.
+    DISCRETE,
+    // Changes only continuous species, always integrated.
+    CONTINUOUS,
+    // Partitioned by its propensity and populations.
+    DYNAMIC
+};
+
+std::vector<ReactionKind> reaction_kinds(const ModelView &model)
+{
+    std::vector<ReactionKind> kinds(model.num_reactions);
+    for (int64_t r = 0; r < model.num_reactions; ++r) {
+        bool discrete = false, continuous = true;
+        for (int64_t k = model.stoich_indptr[r];
+             k < model.stoich_indptr[r + 1]; ++k) {
+            const int64_t mode = model.species_modes[model.stoich_indices[k]];
+            discrete = discrete || mode == SPECIES_DISCRETE;
+            continuous = continuous && mode == SPECIES_CONTINUOUS;
+        }
+        if (model.stoich_indptr[r] == model.stoich_indptr[r + 1]) {
+            kinds[r] = INERT;
+        } else if (discrete) {
+            kinds[r] = DISCRETE;
+        } else if (continuous) {
+            kinds[r] = CONTINUOUS;
+        } else {
+            kinds[r] = DYNAMIC;
+        }
+    }
+    return kinds;
+}
+
+// The state of the fast subsystem, (x, g) with dx/dt = sum_{r fast} v_r
+// a_r(x) and dg/dt = sum_{r slow} a_r(x), advanced by the classical
+// fourth-order Runge-Kutta method.
+class FastSubsystem {
+public:
+    FastSubsystem(const ModelView &model,
+                  const std::vector<ReactionKind> &kinds)
+        : model_(model), kinds_(kinds), propensities_(model),
+          fast_(model.num_reactions), argument_(model.num_species),
+          stages_(4 * model.num_species)
+    {
+    }
+
+    ReactionMask &fast() { return fast_; }
+
+    int64_t evaluations() const { return propensities_.evaluations(); }
+
+    // Derivatives at x into dx, returning dg/dt.
+    double derivatives(const double *x, double *dx)
+    {
+        std::fill(dx, dx + model_.num_species, 0.0);
+        double slow = 0.0;
+        for (int64_t r = 0; r < model_.num_reactions; ++r) {
+            if (kinds_[r] == INERT) {
+                continue;
+            }
+            const double a = propensities_(r, x);
+            if (!fast_.test(r)) {
+                slow += a;
+                continue;
+            }
+            for (int64_t k = model_.stoich_indptr[r];
+                 k < model_.stoich_indptr[r + 1]; ++k) {
+                dx[model_.stoich_indices[k]] += a * model_.stoich_values[k];
+            }
+        }
+        return slow;
+    }
+
+    // Advances x by one step of size h in place and returns the increase of
+    // g over the step.
+    double step(double *x, double h)
+    {
+        const int64_t n = model_.num_species;
+        double *k1 = &stages_[0], *k2 = &stages_[n], *k3 = &stages_[2 * n],
+               *k4 = &stages_[3 * n];
+        const double g1 = derivatives(x, k1);
+        for (int64_t i = 0; i < n; ++i) {
+            argument_[i] = x[i] + 0.5 * h * k1[i];
+        }
+        const double g2 = derivatives(argument_.data(), k2);
+        for (int64_t i = 0; i < n; ++i) {
+            argument_[i] = x[i] + 0.5 * h * k2[i];
+        }
+        const double g3 = derivatives(argument_.data(), k3);
+        for (int64_t i = 0; i < n; ++i) {
+            argument_[i] = x[i] + h * k3[i];
+        }
+        const double g4 = derivatives(argument_.data(), k4);
+        for (int64_t i = 0; i < n; ++i) {
+            x[i] += h / 6.0 * (k1[i] + 2.0 * (k2[i] + k3[i]) + k4[i]);
+        }
+        return h / 6.0 * (g1 + 2.0 * (g2 + g3) + g4);
+    }
+
+private:
+    const ModelView &model_;
+    const std::vector<ReactionKind> &kinds_;
+    Propensities propensities_;
+    ReactionMask fast_;
+    std::vector<double> argument_;
+    std::vector<double> stages_;
+};
+
+// Whether reaction r may be integrated: it changes continuous species, or
+// dynamic species with populations of at least continuous_population.
+bool abundant(const ModelView &model, ReactionKind kind, int64_t r,
+              const double *x, const EngineOptions &options)
+{
+    if (kind == CONTINUOUS) {
+        return true;
+    }
+    if (kind != DYNAMIC) {
+        return false;
+    }
+    for (int64_t k = model.stoich_indptr[r]; k < model.stoich_indptr[r + 1];
+         ++k) {
+        const int64_t i = model.stoich_indices[k];
+        if (model.species_modes[i] != SPECIES_CONTINUOUS &&
+            x[i] < options.continuous_population) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Longest step over which the gross flux of the fast reactions through
+// every species stays below epsilon times its population.
+double fast_step(const ModelView &model, const ReactionMask &fast,
+                 const double *propensity, double epsilon, const double *x,
+                 double *flux)
+{
+    std::fill(flux, flux + model.num_species, 0.0);
+    for (int64_t r = 0; r < model.num_reactions; ++r) {
+        if (!fast.test(r)) {
+            continue;
+        }
+        for (int64_t k = model.stoich_indptr[r];
+             k < model.stoich_indptr[r + 1]; ++k) {
+            flux[model.stoich_indices[k]] +=
+                std::fabs(model.stoich_values[k]) * propensity[r];
+        }
+    }
+    double h = std::numeric_limits<double>::infinity();
+    for (int64_t i = 0; i < model.num_species; ++i) {
+        if (flux[i] > 0.0) {
+            h = std::min(h, epsilon * std::max(x[i], 1.0) / flux[i]);
+        }
+    }
+    return h;
+}
+
+// Times a step that takes a population below zero is halved before the
+// hybrid engine gives up integrating and takes an exact step instead.
+const int MAX_HALVINGS = 30;
+
+// Rounds the dynamic species below continuous_population, which only slow
+// reactions change, to the nearest non-negative integer.
+void round_discrete(const ModelView &model, const EngineOptions &options,
+                    double *x)
+{
+    for (int64_t i = 0; i < model.num_species; ++i) {
+        if (model.species_modes[i] == SPECIES_DYNAMIC &&
+            x[i] < options.continuous_population) {
+            x[i] = std::max(std::floor(x[i] + 0.5), 0.0);
+        }
+    }
+}
+
+// Integrates the fast subsystem over step in place, halving the step while
+// it takes a population below zero that was not already there. Returns
+// whether a step was accepted, with its length in step and the increase of
+// g in dg; x is left at saved otherwise.
+bool integrate_fast(FastSubsystem &subsystem, int64_t num_species,
+                    const std::vector<double> &saved, std::vector<double> &x,
+                    double &step, double &dg, Profile *profile)
+{
+    for (int halvings = 0; halvings <= MAX_HALVINGS; ++halvings) {
+        x = saved;
+        dg = subsystem.step(x.data(), step);
+        bool negative = false;
+        for (int64_t i = 0; i < num_species; ++i) {
+            negative = negative || (x[i] < 0.0 && x[i] < saved[i]);
+        }
+        if (!negative) {
+            return true;
+        }
+        step *= 0.5;
+        if (profile != NULL) {
+            ++profile->rejected_leaps;
+        }
+    }
+    x = saved;
+    return false;
+}
+
+} // namespace
+
+void hybrid(const ModelView &model, const Timeline &timeline,
+            const EngineOptions &options, Random &random, double *out,
+            Profile *profile)
+{
+    const int64_t num_species = model.num_species;
+    const int64_t num_reactions = model.num_reactions;
+    const std::vector<ReactionKind> kinds = reaction_kinds(model);
+
+    std::vector<double> x(model.initial_state,
+                          model.initial_state + num_species);
+    std::vector<double> saved(num_species), flux(num_species);
+    std::vector<double> propensity(num_reactions);
+    Propensities propensities(model);
+    FastSubsystem subsystem(model, kinds);
+    ReactionMask &fast = subsystem.fast();
+    ReactionMask candidates(num_reactions);
+    StepTimer timer(profile);
+
+    // The slow reactions fire once their integrated total propensity g
+    // reaches threshold, an exponential variate.
+    double g = 0.0;
+    double threshold = random.exponential(1.0);
+
+    double t = 0.0;
+    int64_t next_output = 0;
+
+    for (;;) {
+        timer.begin_step();
+        record_reached(model, timeline, x.data(), t, next_output, out, timer);
+        if (next_output == timeline.num_times) {
+            break;
+        }
+        const double until_output = timeline.times[next_output] - t;
+
+        // Species that have become discrete hold whole molecules again.
+        round_discrete(model, options, x.data());
+
+        // Partition: the candidates are the reactions on abundant species,
+        // and those frequent enough over the step they allow stay fast.
+        candidates.clear();
+        bool any_candidate = false;
+        for (int64_t r = 0; r < num_reactions; ++r) {
+            propensity[r] =
+                kinds[r] == INERT ? 0.0 : propensities(r, x.data());
+            if (propensity[r] > 0.0 && abundant(model, kinds[r], r, x.data(),
+                                                options)) {
+                candidates.set(r);
+                any_candidate = true;
+            }
+        }
+        fast.clear();
+        bool any_fast = false;
+        double h = 0.0;
+        if (any_candidate) {
+            h = fast_step(model, candidates, propensity.data(),
+                          options.epsilon, x.data(), flux.data());
+            for (int64_t r = 0; r < num_reactions; ++r) {
+                if (candidates.test(r) &&
+                    (kinds[r] == CONTINUOUS ||
+                     propensity[r] * h >= options.fast_events)) {
+                    fast.set(r);
+                    any_fast = true;
+                }
+            }
+            if (any_fast) {
+                h = fast_step(model, fast, propensity.data(), options.epsilon,
+                              x.data(), flux.data());
+            }
+        }
+
+        double slow_sum = 0.0;
+        for (int64_t r = 0; r < num_reactions; ++r) {
+            if (!fast.test(r)) {
+                slow_sum += propensity[r];
+            }
+        }
+
+        timer.phase(PHASE_UPDATE);
+        bool fire = false;
+        double step = 0.0, dg = 0.0;
+        const bool to_output = h >= until_output;
+        bool integrated = false;
+        if (any_fast) {
+            step = to_output ? until_output : h;
+            saved = x;
+            integrated = integrate_fast(subsystem, num_species, saved, x,
+                                        step, dg, profile);
+            if (!integrated) {
+                // No step short enough keeps the populations non-negative,
+                // for example under a custom propensity that does not
+                // vanish at zero: every reaction fires exactly this time.
+                fast.clear();
+                slow_sum = 0.0;
+                for (int64_t r = 0; r < num_reactions; ++r) {
+                    slow_sum += propensity[r];
+                }
+            }
+        }
+        if (!integrated) {
+            // Only slow reactions: an exact direct method step.
+            if (slow_sum <= 0.0) {
+                break;
+            }
+            const double wait = (threshold - g) / slow_sum;
+            if (wait >= until_output) {
+                g += slow_sum * until_output;
+                t = timeline.times[next_output];
+                continue;
+            }
+            t += wait;
+            fire = true;
+        } else {
+            if (profile != NULL) {
+                ++profile->leaps;
+            }
+            if (g + dg >= threshold && dg > 0.0) {
+                // The slow firing falls within the step; g is nearly
+                // linear over it.
+                x = saved;
+                step *= (threshold - g) / dg;
+                subsystem.step(x.data(), step);
+                t += step;
+                fire = true;
+            } else {
+                g += dg;
+                t = to_output && step == until_output
+                        ? timeline.times[next_output]
+                        : t + step;
+            }
+        }
+
+        if (fire) {
+            // Slow reaction chosen at the state of the firing time.
+            double total = 0.0;
+            for (int64_t r = 0; r < num_reactions; ++r) {
+                propensity[r] = fast.test(r) || kinds[r] == INERT
+                                    ? 0.0
+                                    : propensities(r, x.data());
+                total += propensity[r];
+            }
+            if (total > 0.0) {
+                const double target = random.uniform() * total;
+                double cumulative = 0.0;
+                int64_t reaction = -1;
+                for (int64_t r = 0; r < num_reactions; ++r) {
+                    if (propensity[r] > 0.0) {
+                        reaction = r;
+                        cumulative += propensity[r];
+                        if (target < cumulative) {
+                            break;
+                        }
+                    }
+                }
+                fire_reaction(model, reaction, x.data());
+                if (profile != NULL) {
+                    profile->firings[reaction] += 1.0;
+                    ++profile->events;
+                }
+            }
+            g = 0.0;
+            threshold = random.exponential(1.0);
+        }
+    }
+    timer.close_phase();
+
+    record_rest(model, timeline, x.data(), next_output, out, timer);
+    if (profile != NULL) {
+        profile->propensity_evaluations +=
+            propensities.evaluations() + subsystem.evaluations();
+    }
+}
+
+} // namespace gillespy2
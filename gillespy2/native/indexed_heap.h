@@ -0,0 +1,98 @@
+/*
+ * Indexed binary min-heap over a fixed set of keys, as used by the next
+ * reaction method to find the reaction with the earliest firing time.
+ */
+#ifndef GILLESPY2_NATIVE_INDEXED_HEAP_H
+#define GILLESPY2_NATIVE_INDEXED_HEAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace gillespy2 {
+
+class IndexedHeap {
+public:
+    // Builds a heap over items 0 .. keys.size()-1 with the given keys.
+    explicit IndexedHeap(const std::vector<double> &keys)
+        : keys_(keys), heap_(keys.size()), position_(keys.size())
+    {
+        for (std::size_t i = 0; i < keys_.size(); ++i) {
+            heap_[i] = static_cast<int64_t>(i);
+            position_[i] = i;
+        }
+        for (std::size_t i = heap_.size() / 2; i-- > 0;) {
+            sift_down(i);
+        }
+    }
+
+    bool empty() const { return heap_.empty(); }
+
+    // Item with the smallest key.
+    int64_t top() const { return heap_[0]; }
+
+    double key(int64_t item) const { return keys_[item]; }
+
+    // Changes the key of item and restores the heap order.
+    void update(int64_t item, double key)
+    {
+        const double old_key = keys_[item];
+        keys_[item] = key;
+        if (key < old_key) {
+            sift_up(position_[item]);
+        } else {
+            sift_down(position_[item]);
+        }
+    }
+
+private:
+    void swap_nodes(std::size_t a, std::size_t b)
+    {
+        std::swap(heap_[a], heap_[b]);
+        position_[heap_[a]] = a;
+        position_[heap_[b]] = b;
+    }
+
+    void sift_up(std::size_t node)
+    {
+        while (node > 0) {
+            const std::size_t parent = (node - 1) / 2;
+            if (!(keys_[heap_[node]] < keys_[heap_[parent]])) {
+                break;
+            }
+            swap_nodes(node, parent);
+            node = parent;
+        }
+    }
+
+    void sift_down(std::size_t node)
+    {
+        for (;;) {
+            const std::size_t left = 2 * node + 1;
+            const std::size_t right = left + 1;
+            std::size_t smallest = node;
+            if (left < heap_.size() &&
+                keys_[heap_[left]] < keys_[heap_[smallest]]) {
+                smallest = left;
+            }
+            if (right < heap_.size() &&
+                keys_[heap_[right]] < keys_[heap_[smallest]]) {
+                smallest = right;
+            }
+            if (smallest == node) {
+                break;
+            }
+            swap_nodes(node, smallest);
+            node = smallest;
+        }
+    }
+
+    std::vector<double> keys_;
+    std::vector<int64_t> heap_;
+    std::vector<std::size_t> position_;
+};
+
+} // namespace gillespy2
+
+#endif
@@ -0,0 +1,99 @@
+#include "ssa.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "propensity.h"
+#include "random.h"
+#include "stoichiometry.h"
+
+namespace gillespy2 {
+
+void chemical_langevin(const ModelView &model, const Timeline &timeline,
+                       const EngineOptions &options, Random &random,
+                       double *out, Profile *profile)
+{
+    const int64_t num_species = model.num_species;
+    const int64_t num_reactions = model.num_reactions;
+
+    std::vector<double> x(model.initial_state,
+                          model.initial_state + num_species);
+    std::vector<double> propensity(num_reactions);
+    std::vector<double> increments(num_reactions);
+    std::vector<double> mu(num_species), sigma2(num_species);
+    Propensities propensities(model);
+    const StoichiometryMoments moments(model);
+    StepTimer timer(profile);
+
+    double t = 0.0;
+    int64_t next_output = 0;
+
+    for (;;) {
+        timer.begin_step();
+        record_reached(model, timeline, x.data(), t, next_output, out, timer);
+        if (next_output == timeline.num_times) {
+            break;
+        }
+
+        double propensity_sum = 0.0;
+        for (int64_t r = 0; r < num_reactions; ++r) {
+            propensity[r] = std::max(propensities(r, x.data()), 0.0);
+            propensity_sum += propensity[r];
+        }
+        // Nothing can happen anymore, the state is final.
+        if (propensity_sum <= 0.0) {
+            break;
+        }
+
+        double h = options.step_size;
+        if (!(h > 0.0)) {
+            moments(propensity.data(), mu.data(), sigma2.data());
+            h = std::numeric_limits<double>::infinity();
+            for (int64_t i = 0; i < num_species; ++i) {
+                const double bound = std::max(options.epsilon * x[i], 1.0);
+                if (mu[i] != 0.0) {
+                    h = std::min(h, bound / std::fabs(mu[i]));
+                }
+                if (sigma2[i] > 0.0) {
+                    h = std::min(h, bound * bound / sigma2[i]);
+                }
+            }
+        }
+        const double until_output = timeline.times[next_output] - t;
+        const bool to_output = h >= until_output;
+        if (to_output) {
+            h = until_output;
+        }
+
+        // Number of firings of every reaction over the step, a_r h +
+        // sqrt(a_r h) N(0, 1), and the population change V of them.
+        timer.phase(PHASE_UPDATE);
+        random.normals(num_reactions, increments.data());
+        for (int64_t r = 0; r < num_reactions; ++r) {
+            const double mean = propensity[r] * h;
+            increments[r] = mean + std::sqrt(mean) * increments[r];
+        }
+        moments(increments.data(), mu.data());
+        for (int64_t i = 0; i < num_species; ++i) {
+            x[i] = std::fabs(x[i] + mu[i]);
+        }
+        t = to_output ? timeline.times[next_output] : t + h;
+        if (profile != NULL) {
+            ++profile->leaps;
+            for (int64_t r = 0; r < num_reactions; ++r) {
+                profile->firings[r] += increments[r];
+            }
+        }
+    }
+    timer.close_phase();
+
+    record_rest(model, timeline, x.data(), next_output, out, timer);
+    if (profile != NULL) {
+        profile->propensity_evaluations += propensities.evaluations();
+    }
+}
+
+} // namespace gillespy2
@@ -0,0 +1,171 @@
+/*
+ * Building blocks of the tau-leaping engines, shared by the one trajectory
+ * engine and the lockstep one.
+ */
+#ifndef GILLESPY2_NATIVE_LEAPING_H
+#define GILLESPY2_NATIVE_LEAPING_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "model.h"
+#include "profile.h"
+#include "propensity.h"
+#include "random.h"
+#include "reaction_mask.h"
+#include "selection.h"
+#include "ssa.h"
+
+namespace gillespy2 {
+
+// For each species, the highest order of the reactions consuming it and
+// the most molecules of it that a reaction of that order consumes. They
+// determine g_i in Cao et al. (2006), eq. 27.
+class HighestOrders {
+public:
+    explicit HighestOrders(const ModelView &model)
+        : order_(model.num_species, 0), molecules_(model.num_species, 0)
+    {
+        for (int64_t r = 0; r < model.num_reactions; ++r) {
+            int64_t order = 0;
+            for (int64_t k = model.reactant_indptr[r];
+                 k < model.reactant_indptr[r + 1]; ++k) {
+                order += model.reactant_values[k];
+            }
+            for (int64_t k = model.reactant_indptr[r];
+                 k < model.reactant_indptr[r + 1]; ++k) {
+                const int64_t i = model.reactant_indices[k];
+                const int64_t n = model.reactant_values[k];
+                if (order > order_[i]) {
+                    order_[i] = order;
+                    molecules_[i] = n;
+                } else if (order == order_[i] && n > molecules_[i]) {
+                    molecules_[i] = n;
+                }
+            }
+        }
+    }
+
+    // Whether species i is a reactant of some reaction.
+    bool is_reactant(int64_t i) const { return order_[i] > 0; }
+
+    // g_i at population x. Populations too small for the reaction to fire
+    // are clamped, where the leap size is bounded by x_i anyway.
+    double g(int64_t i, double x) const
+    {
+        const double x1 = x - 1.0 > 1.0 ? x - 1.0 : 1.0;
+        const double x2 = x - 2.0 > 1.0 ? x - 2.0 : 1.0;
+        switch (order_[i]) {
+        case 1:
+            return 1.0;
+        case 2:
+            return molecules_[i] == 1 ? 2.0 : 2.0 + 1.0 / x1;
+        case 3:
+            if (molecules_[i] == 1) {
+                return 3.0;
+            }
+            if (molecules_[i] == 2) {
+                return 1.5 * (2.0 + 1.0 / x1);
+            }
+            return 3.0 + 1.0 / x1 + 2.0 / x2;
+        default:
+            return static_cast<double>(order_[i]);
+        }
+    }
+
+private:
+    std::vector<int64_t> order_;
+    std::vector<int64_t> molecules_;
+};
+
+// Number of times reaction r can fire in state x before a species it
+// consumes runs out.
+inline double max_firings(const ModelView &model, int64_t r, const double *x)
+{
+    double firings = std::numeric_limits<double>::infinity();
+    for (int64_t k = model.stoich_indptr[r]; k < model.stoich_indptr[r + 1];
+         ++k) {
+        const double v = model.stoich_values[k];
+        if (v < 0.0) {
+            const double n = std::floor(x[model.stoich_indices[k]] / -v);
+            if (n < firings) {
+                firings = n;
+            }
+        }
+    }
+    return firings;
+}
+
+// The leap accuracy epsilon, adapted to the rate of rejected leaps.
+class AdaptiveEpsilon {
+public:
+    explicit AdaptiveEpsilon(double epsilon)
+        : max_(epsilon), value_(epsilon), leaps_(0), rejected_(0)
+    {
+    }
+
+    double value() const { return value_; }
+
+    void record(bool rejected)
+    {
+        ++leaps_;
+        rejected_ += rejected;
+        if (leaps_ < EPSILON_WINDOW) {
+            return;
+        }
+        if (10 * rejected_ > leaps_) {
+            value_ = std::max(value_ * 0.5, max_ / MAX_EPSILON_REDUCTION);
+        } else if (rejected_ == 0) {
+            value_ = std::min(value_ * 2.0, max_);
+        }
+        leaps_ = 0;
+        rejected_ = 0;
+    }
+
+private:
+    const double max_;
+    double value_;
+    int64_t leaps_;
+    int64_t rejected_;
+};
+
+// Scratch space of take_leap() for one trajectory.
+struct LeapScratch {
+    explicit LeapScratch(const ModelView &model)
+        : saved(model.num_species), means(model.num_reactions),
+          firings(model.num_reactions)
+    {
+    }
+
+    std::vector<double> saved;
+    std::vector<double> means;
+    std::vector<int64_t> firings;
+};
+
+// Advances the state by up to steps exact direct method steps, starting
+// from the given propensities, and records the outputs passed on the way.
+// The burst and its events are counted into the profile of timer.
+void ssa_burst(const ModelView &model, const Timeline &timeline,
+               int64_t steps, const double *propensity,
+               Propensities &propensities, SumTreeSelector &selector,
+               Random &random, double *x, double &t, int64_t &next_output,
+               double *out, StepTimer &timer);
+
+// Leaps the state x at time t by at most leap, ending on the next output
+// time if that comes first: fires every noncritical reaction a Poisson
+// number of times and at most one critical reaction. A leap that makes a
+// population negative is rejected and retried with half the size, and
+// every attempt is recorded in epsilon, and in profile unless it is NULL.
+void take_leap(const ModelView &model, const Timeline &timeline,
+               double leap, const double *propensity,
+               const double *noncritical, const ReactionMask &critical,
+               double critical_sum, Random &random, AdaptiveEpsilon &epsilon,
+               LeapScratch &scratch, double *x, double &t,
+               int64_t next_output, Profile *profile);
+
+} // namespace gillespy2
+
+#endif
@@ -0,0 +1,535 @@
+#include "lockstep.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "leaping.h"
+#include "propensity.h"
+#include "random.h"
+#include "reaction_mask.h"
+#include "selection.h"
+
+// The lane kernels are compiled for AVX-512, AVX2 and the baseline
+// instruction set, and the best one the processor supports is picked at
+// load time, so the extension needs no -march flags. The clones do not
+// contract multiplications and additions into FMAs, which keeps the lanes
+// bitwise equal to the one trajectory engines; setup.py builds those with
+// -ffp-contract=off as well, since -march flags in CFLAGS would let the
+// compiler contract them.
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && \
+    defined(__linux__)
+#define GILLESPY2_LANE_KERNEL                                          \
+    __attribute__((target_clones("avx512f", "avx2", "default"),         \
+                   optimize("fp-contract=off")))
+#else
+#define GILLESPY2_LANE_KERNEL
+#endif
+
+namespace gillespy2 {
+
+namespace {
+
+const int64_t L = LOCKSTEP_LANES;
+
+// Dense species-major copies of the stoichiometry matrix V and of its
+// elementwise square, as in StoichiometryMoments.
+struct LaneStoichiometry {
+    explicit LaneStoichiometry(const ModelView &model)
+        : v(model.num_species * model.num_reactions, 0.0), v2(v)
+    {
+        const int64_t n = model.num_reactions;
+        for (int64_t r = 0; r < n; ++r) {
+            for (int64_t k = model.stoich_indptr[r];
+                 k < model.stoich_indptr[r + 1]; ++k) {
+                const double value = model.stoich_values[k];
+                v[model.stoich_indices[k] * n + r] = value;
+                v2[model.stoich_indices[k] * n + r] = value * value;
+            }
+        }
+    }
+
+    std::vector<double> v, v2;
+};
+
+// Mass-action propensities of every reaction in the states x of all
+// lanes, clamped like Propensities.
+GILLESPY2_LANE_KERNEL
+void lane_propensities(const ModelView &model, const double *x, double *a)
+{
+    for (int64_t r = 0; r < model.num_reactions; ++r) {
+        double *ar = a + r * L;
+        for (int64_t l = 0; l < L; ++l) {
+            ar[l] = model.rate_coefficients[r];
+        }
+        for (int64_t k = model.kernel_indptr[r];
+             k < model.kernel_indptr[r + 1]; ++k) {
+            const double *population = x + model.kernel_species[k] * L;
+            for (int64_t m = 0; m < model.kernel_orders[k]; ++m) {
+                for (int64_t l = 0; l < L; ++l) {
+                    ar[l] *= population[l] - m;
+                }
+            }
+        }
+        for (int64_t l = 0; l < L; ++l) {
+            ar[l] = ar[l] > 0.0 ? ar[l] : 0.0;
+        }
+    }
+}
+
+// Product mu = V w of a dense species-major matrix with the reaction
+// vectors w of all lanes.
+GILLESPY2_LANE_KERNEL
+void lane_product(int64_t num_species, int64_t num_reactions,
+                  const double *v, const double *w, double *mu)
+{
+    for (int64_t i = 0; i < num_species; ++i) {
+        const double *vi = v + i * num_reactions;
+        double m[L] = {0.0};
+        for (int64_t r = 0; r < num_reactions; ++r) {
+            for (int64_t l = 0; l < L; ++l) {
+                m[l] += vi[r] * w[r * L + l];
+            }
+        }
+        for (int64_t l = 0; l < L; ++l) {
+            mu[i * L + l] = m[l];
+        }
+    }
+}
+
+// The sums of the propensities a of all lanes.
+GILLESPY2_LANE_KERNEL
+void lane_sums(int64_t num_reactions, const double *a, double *sum)
+{
+    for (int64_t l = 0; l < L; ++l) {
+        sum[l] = 0.0;
+    }
+    for (int64_t r = 0; r < num_reactions; ++r) {
+        for (int64_t l = 0; l < L; ++l) {
+            sum[l] += a[r * L + l];
+        }
+    }
+}
+
+// Splits the propensities a of all lanes into those of the critical
+// reactions, which can fire fewer than threshold times before exhausting
+// a reactant, and the noncritical ones, which are zero for the critical
+// reactions.
+GILLESPY2_LANE_KERNEL
+void lane_partition(const ModelView &model, const double *x, const double *a,
+                    double threshold, double *noncritical,
+                    double *critical_sum)
+{
+    const double never = std::numeric_limits<double>::infinity();
+    for (int64_t l = 0; l < L; ++l) {
+        critical_sum[l] = 0.0;
+    }
+    for (int64_t r = 0; r < model.num_reactions; ++r) {
+        double firings[L];
+        for (int64_t l = 0; l < L; ++l) {
+            firings[l] = never;
+        }
+        for (int64_t k = model.stoich_indptr[r];
+             k < model.stoich_indptr[r + 1]; ++k) {
+            const double v = model.stoich_values[k];
+            if (v < 0.0) {
+                const double *population = x + model.stoich_indices[k] * L;
+                for (int64_t l = 0; l < L; ++l) {
+                    const double n = std::floor(population[l] / -v);
+                    firings[l] = n < firings[l] ? n : firings[l];
+                }
+            }
+        }
+        const double *ar = a + r * L;
+        for (int64_t l = 0; l < L; ++l) {
+            const bool critical = ar[l] > 0.0 && firings[l] < threshold;
+            critical_sum[l] += critical ? ar[l] : 0.0;
+            noncritical[r * L + l] = critical ? 0.0 : ar[l];
+        }
+    }
+}
+
+// The largest leaps of all lanes that keep the expected change and the
+// standard deviation of every reactant population below epsilon x_i / g_i,
+// as in tau_leaping().
+GILLESPY2_LANE_KERNEL
+void lane_leaps(const HighestOrders &orders, int64_t num_species,
+                const double *x, const double *mu, const double *sigma2,
+                const double *epsilon, double *leap)
+{
+    for (int64_t l = 0; l < L; ++l) {
+        leap[l] = std::numeric_limits<double>::infinity();
+    }
+    for (int64_t i = 0; i < num_species; ++i) {
+        if (!orders.is_reactant(i)) {
+            continue;
+        }
+        for (int64_t l = 0; l < L; ++l) {
+            const double xi = x[i * L + l];
+            double bound = epsilon[l] * xi / orders.g(i, xi);
+            bound = bound < 1.0 ? 1.0 : bound;
+            const double m = std::fabs(mu[i * L + l]);
+            const double s = sigma2[i * L + l];
+            if (m != 0.0 && bound / m < leap[l]) {
+                leap[l] = bound / m;
+            }
+            if (s > 0.0 && bound * bound / s < leap[l]) {
+                leap[l] = bound * bound / s;
+            }
+        }
+    }
+}
+
+// The Langevin steps of all lanes that keep the expected change and the
+// standard deviation of every population below epsilon times it, as in
+// chemical_langevin().
+GILLESPY2_LANE_KERNEL
+void lane_langevin_steps(int64_t num_species, const double *x,
+                         const double *mu, const double *sigma2,
+                         double epsilon, double *h)
+{
+    for (int64_t l = 0; l < L; ++l) {
+        h[l] = std::numeric_limits<double>::infinity();
+    }
+    for (int64_t i = 0; i < num_species; ++i) {
+        for (int64_t l = 0; l < L; ++l) {
+            const double bound = std::max(epsilon * x[i * L + l], 1.0);
+            const double m = mu[i * L + l], s = sigma2[i * L + l];
+            if (m != 0.0) {
+                h[l] = std::min(h[l], bound / std::fabs(m));
+            }
+            if (s > 0.0) {
+                h[l] = std::min(h[l], bound * bound / s);
+            }
+        }
+    }
+}
+
+// Turns the standard normal variates z of all lanes into the numbers of
+// firings a h + sqrt(a h) z over their steps h.
+GILLESPY2_LANE_KERNEL
+void lane_increments(int64_t num_reactions, const double *a, const double *h,
+                     double *z)
+{
+    for (int64_t r = 0; r < num_reactions; ++r) {
+        for (int64_t l = 0; l < L; ++l) {
+            const double mean = a[r * L + l] * h[l];
+            z[r * L + l] = mean + std::sqrt(mean) * z[r * L + l];
+        }
+    }
+}
+
+// Adds the population changes mu to the states x of the moving lanes,
+// reflecting them at 0.
+GILLESPY2_LANE_KERNEL
+void lane_reflect(int64_t num_species, const double *mu, const bool *moving,
+                  double *x)
+{
+    for (int64_t i = 0; i < num_species; ++i) {
+        for (int64_t l = 0; l < L; ++l) {
+            x[i * L + l] = moving[l] ? std::fabs(x[i * L + l] + mu[i * L + l])
+                                     : x[i * L + l];
+        }
+    }
+}
+
+void gather(const std::vector<double> &lanes, int64_t l,
+            std::vector<double> &x)
+{
+    for (size_t i = 0; i < x.size(); ++i) {
+        x[i] = lanes[i * L + l];
+    }
+}
+
+void scatter(const std::vector<double> &x, int64_t l,
+             std::vector<double> &lanes)
+{
+    for (size_t i = 0; i < x.size(); ++i) {
+        lanes[i * L + l] = x[i];
+    }
+}
+
+// The clocks and output positions of the lanes of a block. Lanes past
+// num_lanes are padding and are done from the start.
+struct LaneClocks {
+    LaneClocks(const ModelView &model, int64_t num_lanes)
+        : x(model.num_species * L)
+    {
+        for (int64_t l = 0; l < L; ++l) {
+            t[l] = 0.0;
+            next_output[l] = 0;
+            done[l] = l >= num_lanes;
+            for (int64_t i = 0; i < model.num_species; ++i) {
+                x[i * L + l] = model.initial_state[i];
+            }
+        }
+    }
+
+    // Records the outputs lane l has reached, marking it done after the
+    // last one; returns whether it still runs. xl is scratch space for the
+    // state of the lane.
+    bool advance(const ModelView &model, const Timeline &timeline, int64_t l,
+                 std::vector<double> &xl, double *out, StepTimer &timer)
+    {
+        if (timeline.times[next_output[l]] <= t[l]) {
+            gather(x, l, xl);
+            record_reached(model, timeline, xl.data(), t[l], next_output[l],
+                           out, timer);
+        }
+        done[l] = next_output[l] == timeline.num_times;
+        return !done[l];
+    }
+
+    // Records the remaining outputs of lane l, whose state xl is final.
+    void finish(const ModelView &model, const Timeline &timeline, int64_t l,
+                const std::vector<double> &xl, double *out, StepTimer &timer)
+    {
+        record_rest(model, timeline, xl.data(), next_output[l], out, timer);
+        done[l] = true;
+    }
+
+    std::vector<double> x;
+    double t[L];
+    int64_t next_output[L];
+    bool done[L];
+};
+
+} // namespace
+
+bool lockstep_supported(const ModelView &model)
+{
+    if (model.num_species > LOCKSTEP_MAX_SPECIES ||
+        model.num_reactions > LOCKSTEP_MAX_REACTIONS) {
+        return false;
+    }
+    for (int64_t r = 0; r < model.num_reactions; ++r) {
+        if (model.program_indptr[r] != model.program_indptr[r + 1]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void tau_leaping_lockstep(const ModelView &model, const Timeline &timeline,
+                          const EngineOptions &options, Random *random,
+                          int64_t num_lanes, double *out, Profile *profile)
+{
+    const int64_t num_species = model.num_species;
+    const int64_t num_reactions = model.num_reactions;
+    const int64_t trajectory_size =
+        timeline.num_times * (timeline.num_species + 1);
+
+    LaneClocks lanes(model, num_lanes);
+    std::vector<double> propensity(num_reactions * L);
+    std::vector<double> noncritical(num_reactions * L);
+    std::vector<double> mu(num_species * L), sigma2(num_species * L);
+    std::vector<double> xl(num_species), pl(num_reactions),
+        nl(num_reactions);
+    double sum[L], critical_sum[L], leap[L], epsilon_value[L];
+    const LaneStoichiometry stoichiometry(model);
+    const HighestOrders orders(model);
+    Propensities propensities(model);
+    ReactionMask critical(num_reactions);
+    std::vector<SumTreeSelector> selectors(num_lanes,
+                                           SumTreeSelector(num_reactions));
+    std::vector<AdaptiveEpsilon> epsilon(num_lanes,
+                                         AdaptiveEpsilon(options.epsilon));
+    std::vector<LeapScratch> scratch(num_lanes, LeapScratch(model));
+    StepTimer timer(profile);
+
+    for (;;) {
+        timer.begin_step();
+        bool running = false;
+        int64_t num_running = 0;
+        for (int64_t l = 0; l < num_lanes; ++l) {
+            if (!lanes.done[l]) {
+                running = lanes.advance(model, timeline, l, xl,
+                                        out + l * trajectory_size, timer) ||
+                          running;
+                num_running += !lanes.done[l];
+            }
+        }
+        if (!running) {
+            break;
+        }
+
+        lane_propensities(model, lanes.x.data(), propensity.data());
+        if (profile != NULL) {
+            profile->propensity_evaluations += num_running * num_reactions;
+        }
+        lane_sums(num_reactions, propensity.data(), sum);
+        lane_partition(model, lanes.x.data(), propensity.data(),
+                       static_cast<double>(options.critical_threshold),
+                       noncritical.data(), critical_sum);
+        lane_product(num_species, num_reactions, stoichiometry.v.data(),
+                     noncritical.data(), mu.data());
+        lane_product(num_species, num_reactions, stoichiometry.v2.data(),
+                     noncritical.data(), sigma2.data());
+        for (int64_t l = 0; l < L; ++l) {
+            epsilon_value[l] =
+                l < num_lanes ? epsilon[l].value() : options.epsilon;
+        }
+        lane_leaps(orders, num_species, lanes.x.data(), mu.data(),
+                   sigma2.data(), epsilon_value, leap);
+
+        // The leaps themselves draw their own random variates, lane by
+        // lane.
+        timer.phase(PHASE_UPDATE);
+        for (int64_t l = 0; l < num_lanes; ++l) {
+            if (lanes.done[l]) {
+                continue;
+            }
+            double *lane_out = out + l * trajectory_size;
+            gather(lanes.x, l, xl);
+            // Nothing can fire anymore, the state is final.
+            if (sum[l] <= 0.0) {
+                lanes.finish(model, timeline, l, xl, lane_out, timer);
+                continue;
+            }
+            gather(propensity, l, pl);
+            gather(noncritical, l, nl);
+            if (leap[l] < options.ssa_threshold / sum[l]) {
+                ssa_burst(model, timeline, options.ssa_steps, pl.data(),
+                          propensities, selectors[l], random[l], xl.data(),
+                          lanes.t[l], lanes.next_output[l], lane_out, timer);
+            } else {
+                critical.clear();
+                for (int64_t r = 0; r < num_reactions; ++r) {
+                    if (pl[r] > 0.0 && nl[r] == 0.0) {
+                        critical.set(r);
+                    }
+                }
+                take_leap(model, timeline, leap[l], pl.data(), nl.data(),
+                          critical, critical_sum[l], random[l], epsilon[l],
+                          scratch[l], xl.data(), lanes.t[l],
+                          lanes.next_output[l], profile);
+            }
+            scatter(xl, l, lanes.x);
+        }
+    }
+    timer.close_phase();
+    if (profile != NULL) {
+        profile->propensity_evaluations += propensities.evaluations();
+    }
+}
+
+void chemical_langevin_lockstep(const ModelView &model,
+                                const Timeline &timeline,
+                                const EngineOptions &options, Random *random,
+                                int64_t num_lanes, double *out,
+                                Profile *profile)
+{
+    const int64_t num_species = model.num_species;
+    const int64_t num_reactions = model.num_reactions;
+    const int64_t trajectory_size =
+        timeline.num_times * (timeline.num_species + 1);
+
+    LaneClocks lanes(model, num_lanes);
+    std::vector<double> propensity(num_reactions * L);
+    std::vector<double> increments(num_reactions * L);
+    std::vector<double> mu(num_species * L), sigma2(num_species * L);
+    std::vector<double> xl(num_species), z(num_reactions);
+    double sum[L], h[L];
+    bool moving[L];
+    const LaneStoichiometry stoichiometry(model);
+    StepTimer timer(profile);
+
+    for (;;) {
+        timer.begin_step();
+        int64_t num_running = 0;
+        for (int64_t l = 0; l < num_lanes; ++l) {
+            if (!lanes.done[l]) {
+                num_running += lanes.advance(model, timeline, l, xl,
+                                             out + l * trajectory_size,
+                                             timer);
+            }
+        }
+
+        lane_propensities(model, lanes.x.data(), propensity.data());
+        if (profile != NULL) {
+            profile->propensity_evaluations += num_running * num_reactions;
+        }
+        lane_sums(num_reactions, propensity.data(), sum);
+        bool running = false;
+        for (int64_t l = 0; l < num_lanes; ++l) {
+            // Nothing can happen anymore, the state is final.
+            if (!lanes.done[l] && sum[l] <= 0.0) {
+                gather(lanes.x, l, xl);
+                lanes.finish(model, timeline, l, xl,
+                             out + l * trajectory_size, timer);
+            }
+            running = running || !lanes.done[l];
+        }
+        if (!running) {
+            break;
+        }
+
+        if (options.step_size > 0.0) {
+            std::fill(h, h + L, options.step_size);
+        } else {
+            lane_product(num_species, num_reactions, stoichiometry.v.data(),
+                         propensity.data(), mu.data());
+            lane_product(num_species, num_reactions, stoichiometry.v2.data(),
+                         propensity.data(), sigma2.data());
+            lane_langevin_steps(num_species, lanes.x.data(), mu.data(),
+                                sigma2.data(), options.epsilon, h);
+        }
+
+        // Steps end exactly on the output times; the lanes that are done
+        // stand still.
+        timer.phase(PHASE_UPDATE);
+        bool to_output[L];
+        for (int64_t l = 0; l < L; ++l) {
+            moving[l] = !lanes.done[l];
+            to_output[l] = false;
+            if (!moving[l]) {
+                h[l] = 0.0;
+                continue;
+            }
+            const double until_output =
+                timeline.times[lanes.next_output[l]] - lanes.t[l];
+            to_output[l] = h[l] >= until_output;
+            if (to_output[l]) {
+                h[l] = until_output;
+            }
+        }
+        for (int64_t l = 0; l < L; ++l) {
+            if (moving[l]) {
+                random[l].normals(num_reactions, z.data());
+            } else {
+                std::fill(z.begin(), z.end(), 0.0);
+            }
+            for (int64_t r = 0; r < num_reactions; ++r) {
+                increments[r * L + l] = z[r];
+            }
+        }
+        lane_increments(num_reactions, propensity.data(), h,
+                        increments.data());
+        lane_product(num_species, num_reactions, stoichiometry.v.data(),
+                     increments.data(), mu.data());
+        lane_reflect(num_species, mu.data(), moving, lanes.x.data());
+        for (int64_t l = 0; l < num_lanes; ++l) {
+            if (moving[l]) {
+                lanes.t[l] = to_output[l]
+                                 ? timeline.times[lanes.next_output[l]]
+                                 : lanes.t[l] + h[l];
+            }
+        }
+        if (profile != NULL) {
+            for (int64_t l = 0; l < num_lanes; ++l) {
+                if (!moving[l]) {
+                    continue;
+                }
+                ++profile->leaps;
+                for (int64_t r = 0; r < num_reactions; ++r) {
+                    profile->firings[r] += increments[r * L + l];
+                }
+            }
+        }
+    }
+    timer.close_phase();
+}
+
+} // namespace gillespy2
@@ -0,0 +1,56 @@
+/*
+ * Lockstep engines: blocks of trajectories of a small model simulated
+ * together, for ensemble throughput.
+ *
+ * The state and the propensities of a block are laid out structure of
+ * arrays, LOCKSTEP_LANES values per species or reaction, one lane per
+ * trajectory, so evaluating the propensities, the moments of the
+ * population changes and the step sizes of all trajectories at once is a
+ * loop over full SIMD registers. Lanes whose trajectory has ended are
+ * masked. Random variates, and the leaps and exact steps that depend on
+ * them, stay per lane, so every lane produces exactly the trajectory of
+ * the one trajectory engine (ssa.h) for its random stream.
+ */
+#ifndef GILLESPY2_NATIVE_LOCKSTEP_H
+#define GILLESPY2_NATIVE_LOCKSTEP_H
+
+#include <cstdint>
+
+#include "model.h"
+#include "random.h"
+#include "ssa.h"
+
+namespace gillespy2 {
+
+// Trajectories per block: one AVX-512 register of doubles, or two AVX2
+// ones.
+const int64_t LOCKSTEP_LANES = 8;
+
+// Largest models simulated in lockstep. Beyond them the per-trajectory
+// overhead that lockstep amortizes is small against the work per step.
+const int64_t LOCKSTEP_MAX_SPECIES = 32;
+const int64_t LOCKSTEP_MAX_REACTIONS = 32;
+
+// Whether model is small enough for the lockstep engines and has
+// mass-action propensities only.
+bool lockstep_supported(const ModelView &model);
+
+// The engines below simulate num_lanes <= LOCKSTEP_LANES trajectories of a
+// model accepted by lockstep_supported(), trajectory l drawing from
+// random[l] and written to out + l * timeline.num_times *
+// (timeline.num_species + 1) as by the engine of the same name in ssa.h,
+// and count into profile, unless it is NULL, the work of all lanes.
+
+void tau_leaping_lockstep(const ModelView &model, const Timeline &timeline,
+                          const EngineOptions &options, Random *random,
+                          int64_t num_lanes, double *out, Profile *profile);
+
+void chemical_langevin_lockstep(const ModelView &model,
+                                const Timeline &timeline,
+                                const EngineOptions &options, Random *random,
+                                int64_t num_lanes, double *out,
+                                Profile *profile);
+
+} // namespace gillespy2
+
+#endif
@@ -0,0 +1,105 @@
+/*
+ * Flattened, index-based view of a gillespy2 Model for the native solvers.
+ *
+ * None of the pointers below are owned by the view; they point directly
+ * into numpy arrays that are kept alive by the Python caller for the
+ * duration of a simulation.
+ */
+#ifndef GILLESPY2_NATIVE_MODEL_H
+#define GILLESPY2_NATIVE_MODEL_H
+
+#include <cstdint>
+
+#include "device.h"
+
+namespace gillespy2 {
+
+struct ModelView {
+    int64_t num_species;
+    int64_t num_reactions;
+
+    // Initial population of each species.
+    const double *initial_state;
+
+    // How the hybrid engine treats each species, one of the SPECIES_*
+    // modes below.
+    const int64_t *species_modes;
+
+    // Mass-action kernels in CSR form: the propensity of reaction r is
+    //     rate_coefficients[r] * prod_k x_i (x_i - 1) ... (x_i - n_k + 1)
+    // with i = kernel_species[k] and n_k = kernel_orders[k], for k in
+    // kernel_indptr[r] .. kernel_indptr[r+1]. The volume scaling and the
+    // 1/n! factors are folded into the coefficient.
+    const int64_t *kernel_indptr;
+    const int64_t *kernel_species;
+    const int64_t *kernel_orders;
+    const double *rate_coefficients;
+
+    // Stoichiometry matrix in CSR form: firing reaction r changes species
+    // stoich_indices[k] by stoich_values[k], for k in stoich_indptr[r] ..
+    // stoich_indptr[r+1].
+    const int64_t *stoich_indptr;
+    const int64_t *stoich_indices;
+    const double *stoich_values;
+
+    // Reactant matrix in CSR form: the species consumed by each reaction.
+    const int64_t *reactant_indptr;
+    const int64_t *reactant_indices;
+    const int64_t *reactant_values;
+
+    // Dependency graph in CSR form: the propensities of reactions
+    // dependency_indices[dependency_indptr[r] .. dependency_indptr[r+1])
+    // change when reaction r fires.
+    const int64_t *dependency_indptr;
+    const int64_t *dependency_indices;
+
+    // Reactions that are not mass-action have a stack machine program of
+    // (opcode, operand) pairs program_code[2*k], program_code[2*k+1] for k
+    // in program_indptr[r] .. program_indptr[r+1]. An empty program means
+    // the mass-action kernel is used. See propensity.h.
+    const int64_t *program_indptr;
+    const int64_t *program_code;
+    const double *program_constants;
+    int64_t max_stack_depth;
+
+    // Values of the model parameters and the system volume, as referenced
+    // by the programs.
+    const double *parameter_values;
+    double volume;
+};
+
+// Species modes. A dynamic species is simulated continuously while its
+// population is large and discretely otherwise; the others are always
+// simulated one way.
+const int64_t SPECIES_DYNAMIC = 0;
+const int64_t SPECIES_DISCRETE = 1;
+const int64_t SPECIES_CONTINUOUS = 2;
+
+GILLESPY2_HOST_DEVICE
+inline double mass_action_propensity(const ModelView &model, int64_t r,
+                                     const double *x)
+{
+    double a = model.rate_coefficients[r];
+    for (int64_t k = model.kernel_indptr[r]; k < model.kernel_indptr[r + 1];
+         ++k) {
+        const double population = x[model.kernel_species[k]];
+        for (int64_t m = 0; m < model.kernel_orders[k]; ++m) {
+            a *= population - m;
+        }
+    }
+    return a;
+}
+
+// Applies one firing of reaction r to the state x.
+GILLESPY2_HOST_DEVICE
+inline void fire_reaction(const ModelView &model, int64_t r, double *x)
+{
+    for (int64_t k = model.stoich_indptr[r]; k < model.stoich_indptr[r + 1];
+         ++k) {
+        x[model.stoich_indices[k]] += model.stoich_values[k];
+    }
+}
+
+} // namespace gillespy2
+
+#endif
@@ -0,0 +1,1230 @@
+/*
+ * CPython bindings of the gillespy2 native solvers.
+ *
+ * Arrays are exchanged through the buffer protocol only, so the extension
+ * builds without numpy headers. The Python side is responsible for handing
+ * in C-contiguous float64/int64 arrays; anything else is rejected here.
+ */
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "ensemble.h"
+#ifdef GILLESPY2_CUDA
+#include "gpu.h"
+#endif
+#include "lockstep.h"
+#include "model.h"
+#include "ode.h"
+#include "profile.h"
+#include "propensity.h"
+#include "ssa.h"
+#include "statistics.h"
+
+namespace {
+
+using namespace gillespy2;
+
+// RAII wrapper around a Py_buffer holding a 1-d view of float64 ('d') or
+// int64 ('q') items.
+class Buffer {
+public:
+    Buffer() : valid_(false) {}
+    ~Buffer()
+    {
+        if (valid_) {
+            PyBuffer_Release(&view_);
+        }
+    }
+
+    bool acquire(PyObject *obj, const char *name, char kind, bool writable)
+    {
+        int flags = PyBUF_C_CONTIGUOUS | PyBUF_FORMAT;
+        if (writable) {
+            flags |= PyBUF_WRITABLE;
+        }
+        if (PyObject_GetBuffer(obj, &view_, flags) != 0) {
+            return false;
+        }
+        valid_ = true;
+        if (view_.itemsize != 8 || !format_matches(kind)) {
+            PyErr_Format(PyExc_TypeError,
+                         "'%s' must be a contiguous %s array", name,
+                         kind == 'd' ? "float64" : "int64");
+            return false;
+        }
+        return true;
+    }
+
+    // Looks up attribute name on obj and acquires its buffer.
+    bool acquire_attr(PyObject *obj, const char *name, char kind)
+    {
+        PyObject *attr = PyObject_GetAttrString(obj, name);
+        if (attr == NULL) {
+            return false;
+        }
+        const bool ok = acquire(attr, name, kind, false);
+        Py_DECREF(attr);
+        return ok;
+    }
+
+    Py_ssize_t size() const { return view_.len / view_.itemsize; }
+
+    template <class T> T *data() const
+    {
+        return static_cast<T *>(view_.buf);
+    }
+
+private:
+    bool format_matches(char kind) const
+    {
+        const char *format = view_.format;
+        if (format == NULL) {
+            return false;
+        }
+        if (*format == '<' || *format == '=' || *format == '@') {
+            ++format;
+        }
+        if (kind == 'd') {
+            return std::strcmp(format, "d") == 0;
+        }
+        return std::strcmp(format, "q") == 0 || std::strcmp(format, "l") == 0;
+    }
+
+    Py_buffer view_;
+    bool valid_;
+
+    Buffer(const Buffer &);
+    Buffer &operator=(const Buffer &);
+};
+
+bool get_int_attr(PyObject *obj, const char *name, int64_t &value)
+{
+    PyObject *attr = PyObject_GetAttrString(obj, name);
+    if (attr == NULL) {
+        return false;
+    }
+    value = PyLong_AsLongLong(attr);
+    Py_DECREF(attr);
+    return !(value == -1 && PyErr_Occurred());
+}
+
+// Checks that a CSR structure with num_rows rows only references columns
+// below num_columns, so the engines never index out of bounds.
+bool check_csr(const Buffer &indptr, const Buffer &indices,
+               const Buffer &values, int64_t num_rows, int64_t num_columns,
+               const char *name)
+{
+    if (indptr.size() != num_rows + 1) {
+        PyErr_Format(PyExc_ValueError, "'%s' has the wrong number of rows",
+                     name);
+        return false;
+    }
+    const int64_t *ptr = indptr.data<int64_t>();
+    if (ptr[0] != 0 || ptr[num_rows] != indices.size() ||
+        indices.size() != values.size()) {
+        PyErr_Format(PyExc_ValueError, "'%s' is not a valid CSR matrix",
+                     name);
+        return false;
+    }
+    for (int64_t r = 0; r < num_rows; ++r) {
+        if (ptr[r + 1] < ptr[r]) {
+            PyErr_Format(PyExc_ValueError, "'%s' is not a valid CSR matrix",
+                         name);
+            return false;
+        }
+    }
+    const int64_t *idx = indices.data<int64_t>();
+    for (Py_ssize_t k = 0; k < indices.size(); ++k) {
+        if (idx[k] < 0 || idx[k] >= num_columns) {
+            PyErr_Format(PyExc_ValueError, "'%s' has an index out of range",
+                         name);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Checks that every program only references existing species, parameters
+// and constants, and stays within max_stack_depth.
+bool check_programs(const ModelView &view, const Buffer &code,
+                    int64_t num_parameters, int64_t num_constants)
+{
+    const int64_t *ptr = view.program_indptr;
+    bool valid = ptr[0] == 0 && ptr[view.num_reactions] * 2 == code.size();
+    for (int64_t r = 0; valid && r < view.num_reactions; ++r) {
+        valid = ptr[r] <= ptr[r + 1];
+    }
+    if (!valid) {
+        PyErr_SetString(PyExc_ValueError, "'program_indptr' is not valid");
+        return false;
+    }
+
+    for (int64_t r = 0; r < view.num_reactions; ++r) {
+        int64_t depth = 0;
+        for (int64_t k = ptr[r]; valid && k < ptr[r + 1]; ++k) {
+            const int64_t opcode = view.program_code[2 * k];
+            const int64_t operand = view.program_code[2 * k + 1];
+            switch (opcode) {
+            case OP_CONSTANT:
+                valid = operand >= 0 && operand < num_constants;
+                break;
+            case OP_SPECIES:
+                valid = operand >= 0 && operand < view.num_species;
+                break;
+            case OP_PARAMETER:
+                valid = operand >= 0 && operand < num_parameters;
+                break;
+            case OP_CALL1:
+                valid = operand >= 0 && operand < NUM_UNARY_FUNCTIONS;
+                break;
+            case OP_CALL2:
+                valid = operand >= 0 && operand < NUM_BINARY_FUNCTIONS;
+                break;
+            default:
+                valid = opcode >= 0 && opcode < NUM_OPCODES;
+            }
+            valid = valid && depth >= stack_inputs(opcode);
+            depth += 1 - stack_inputs(opcode);
+            valid = valid && depth <= view.max_stack_depth;
+        }
+        if (!valid || (ptr[r] != ptr[r + 1] && depth != 1)) {
+            PyErr_Format(PyExc_ValueError,
+                         "invalid propensity program for reaction %lld",
+                         static_cast<long long>(r));
+            return false;
+        }
+    }
+    return true;
+}
+
+bool get_float_attr(PyObject *obj, const char *name, double &value)
+{
+    PyObject *attr = PyObject_GetAttrString(obj, name);
+    if (attr == NULL) {
+        return false;
+    }
+    value = PyFloat_AsDouble(attr);
+    Py_DECREF(attr);
+    return !(value == -1.0 && PyErr_Occurred());
+}
+
+// Buffers backing a ModelView, acquired from the attributes of a
+// gillespy2.CompiledModel.
+struct ModelBuffers {
+    Buffer initial_state;
+    Buffer species_modes;
+    Buffer kernel_indptr;
+    Buffer kernel_species;
+    Buffer kernel_orders;
+    Buffer rate_coefficients;
+    Buffer stoich_indptr;
+    Buffer stoich_indices;
+    Buffer stoich_values;
+    Buffer reactant_indptr;
+    Buffer reactant_indices;
+    Buffer reactant_values;
+    Buffer dependency_indptr;
+    Buffer dependency_indices;
+    Buffer program_indptr;
+    Buffer program_code;
+    Buffer program_constants;
+    Buffer parameter_values;
+
+    bool load(PyObject *model, ModelView &view)
+    {
+        if (!get_int_attr(model, "num_species", view.num_species) ||
+            !get_int_attr(model, "num_reactions", view.num_reactions) ||
+            !get_int_attr(model, "max_stack_depth", view.max_stack_depth) ||
+            !get_float_attr(model, "volume", view.volume) ||
+            !initial_state.acquire_attr(model, "initial_state", 'd') ||
+            !species_modes.acquire_attr(model, "species_modes", 'q') ||
+            !kernel_indptr.acquire_attr(model, "kernel_indptr", 'q') ||
+            !kernel_species.acquire_attr(model, "kernel_species", 'q') ||
+            !kernel_orders.acquire_attr(model, "kernel_orders", 'q') ||
+            !rate_coefficients.acquire_attr(model, "rate_coefficients", 'd') ||
+            !stoich_indptr.acquire_attr(model, "stoich_indptr", 'q') ||
+            !stoich_indices.acquire_attr(model, "stoich_indices", 'q') ||
+            !stoich_values.acquire_attr(model, "stoich_values", 'd') ||
+            !reactant_indptr.acquire_attr(model, "reactant_indptr", 'q') ||
+            !reactant_indices.acquire_attr(model, "reactant_indices", 'q') ||
+            !reactant_values.acquire_attr(model, "reactant_values", 'q') ||
+            !dependency_indptr.acquire_attr(model, "dependency_indptr", 'q') ||
+            !dependency_indices.acquire_attr(model, "dependency_indices",
+                                             'q') ||
+            !program_indptr.acquire_attr(model, "program_indptr", 'q') ||
+            !program_code.acquire_attr(model, "program_code", 'q') ||
+            !program_constants.acquire_attr(model, "program_constants", 'd') ||
+            !parameter_values.acquire_attr(model, "parameter_values", 'd')) {
+            return false;
+        }
+        if (initial_state.size() != view.num_species ||
+            species_modes.size() != view.num_species ||
+            rate_coefficients.size() != view.num_reactions ||
+            program_indptr.size() != view.num_reactions + 1 ||
+            view.max_stack_depth < 0) {
+            PyErr_SetString(PyExc_ValueError,
+                            "model arrays do not match the model dimensions");
+            return false;
+        }
+        if (!check_csr(kernel_indptr, kernel_species, kernel_orders,
+                       view.num_reactions, view.num_species, "kernels") ||
+            !check_csr(stoich_indptr, stoich_indices, stoich_values,
+                       view.num_reactions, view.num_species,
+                       "stoichiometry") ||
+            !check_csr(reactant_indptr, reactant_indices, reactant_values,
+                       view.num_reactions, view.num_species, "reactants") ||
+            !check_csr(dependency_indptr, dependency_indices,
+                       dependency_indices, view.num_reactions,
+                       view.num_reactions, "dependencies")) {
+            return false;
+        }
+        for (int64_t i = 0; i < view.num_species; ++i) {
+            const int64_t mode = species_modes.data<int64_t>()[i];
+            if (mode != SPECIES_DYNAMIC && mode != SPECIES_DISCRETE &&
+                mode != SPECIES_CONTINUOUS) {
+                PyErr_SetString(PyExc_ValueError, "invalid species mode");
+                return false;
+            }
+        }
+        view.initial_state = initial_state.data<double>();
+        view.species_modes = species_modes.data<int64_t>();
+        view.kernel_indptr = kernel_indptr.data<int64_t>();
+        view.kernel_species = kernel_species.data<int64_t>();
+        view.kernel_orders = kernel_orders.data<int64_t>();
+        view.rate_coefficients = rate_coefficients.data<double>();
+        view.stoich_indptr = stoich_indptr.data<int64_t>();
+        view.stoich_indices = stoich_indices.data<int64_t>();
+        view.stoich_values = stoich_values.data<double>();
+        view.reactant_indptr = reactant_indptr.data<int64_t>();
+        view.reactant_indices = reactant_indices.data<int64_t>();
+        view.reactant_values = reactant_values.data<int64_t>();
+        view.dependency_indptr = dependency_indptr.data<int64_t>();
+        view.dependency_indices = dependency_indices.data<int64_t>();
+        view.program_indptr = program_indptr.data<int64_t>();
+        view.program_code = program_code.data<int64_t>();
+        view.program_constants = program_constants.data<double>();
+        view.parameter_values = parameter_values.data<double>();
+        return check_programs(view, program_code, parameter_values.size(),
+                              program_constants.size());
+    }
+};
+
+// Acquires the output times, which must be non-empty, non-negative and
+// non-decreasing, and the indices of the recorded species, all of them if
+// species_obj is None, into timeline. all_species backs the default.
+bool load_timeline(PyObject *times_obj, PyObject *species_obj,
+                   const ModelView &model, Buffer &times, Buffer &species,
+                   std::vector<int64_t> &all_species, Timeline &timeline)
+{
+    if (!times.acquire(times_obj, "times", 'd', false)) {
+        return false;
+    }
+    timeline.times = times.data<double>();
+    timeline.num_times = times.size();
+    bool ordered = timeline.num_times > 0 && timeline.times[0] >= 0.0;
+    for (int64_t k = 1; ordered && k < timeline.num_times; ++k) {
+        ordered = timeline.times[k] >= timeline.times[k - 1];
+    }
+    if (!ordered) {
+        PyErr_SetString(PyExc_ValueError, "'times' must be non-empty, "
+                                          "non-negative and non-decreasing");
+        return false;
+    }
+    if (species_obj == Py_None) {
+        all_species.resize(model.num_species);
+        for (int64_t s = 0; s < model.num_species; ++s) {
+            all_species[s] = s;
+        }
+        timeline.species = all_species.data();
+        timeline.num_species = model.num_species;
+        return true;
+    }
+    if (!species.acquire(species_obj, "species", 'q', false)) {
+        return false;
+    }
+    timeline.species = species.data<int64_t>();
+    timeline.num_species = species.size();
+    for (int64_t s = 0; s < timeline.num_species; ++s) {
+        if (timeline.species[s] < 0 ||
+            timeline.species[s] >= model.num_species) {
+            PyErr_SetString(PyExc_ValueError,
+                            "'species' holds an index out of range");
+            return false;
+        }
+    }
+    return true;
+}
+
+// Signature of the single trajectory engines in ssa.h.
+typedef void (*Engine)(const ModelView &, const Timeline &,
+                       const EngineOptions &, Random &, double *, Profile *);
+
+// Signature of the lockstep engines in lockstep.h.
+typedef void (*BlockEngine)(const ModelView &, const Timeline &,
+                            const EngineOptions &, Random *, int64_t,
+                            double *, Profile *);
+
+// Collects the profiles of the tasks of an ensemble into profile. Every
+// task counts into a Profile of its own, allocated and written only by
+// the thread running it, so the threads share no cache lines while they
+// count, and adds it to profile under a lock when it is done. Without a
+// profile, every task gets NULL.
+class SharedProfile {
+public:
+    explicit SharedProfile(Profile *profile) : profile_(profile) {}
+
+    std::unique_ptr<Profile> task_profile() const
+    {
+        return std::unique_ptr<Profile>(
+            profile_ != NULL ? new Profile(profile_->firings.size()) : NULL);
+    }
+
+    void add(const Profile *task)
+    {
+        if (task != NULL) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            profile_->merge(*task);
+        }
+    }
+
+private:
+    Profile *profile_;
+    std::mutex mutex_;
+};
+
+// Simulates the trajectories first_trajectory + i, begin <= i < end, of
+// model into consecutive trajectories of out: in blocks of LOCKSTEP_LANES
+// by block_engine, unless it is NULL, and one by one by engine otherwise.
+// Unless profile is NULL, the engines count into it, and the wall time of
+// every trajectory goes to consecutive elements of wall_times; the
+// trajectories of a lockstep block share its time evenly.
+void run_trajectories(Engine engine, BlockEngine block_engine,
+                      const ModelView &model, const Timeline &timeline,
+                      const EngineOptions &options, uint64_t seed,
+                      uint64_t first_trajectory, int64_t begin, int64_t end,
+                      double *out, Profile *profile, double *wall_times)
+{
+    const int64_t trajectory_size =
+        timeline.num_times * (timeline.num_species + 1);
+    if (block_engine == NULL) {
+        for (int64_t i = begin; i < end; ++i) {
+            Random random(seed, first_trajectory + i);
+            const double start = profile != NULL ? profile_clock() : 0.0;
+            engine(model, timeline, options, random,
+                   out + (i - begin) * trajectory_size, profile);
+            if (profile != NULL) {
+                wall_times[i - begin] = profile_clock() - start;
+            }
+        }
+        return;
+    }
+    std::vector<Random> random;
+    for (int64_t i = begin; i < end; i += LOCKSTEP_LANES) {
+        const int64_t num_lanes = std::min(LOCKSTEP_LANES, end - i);
+        random.clear();
+        for (int64_t l = 0; l < num_lanes; ++l) {
+            random.push_back(Random(seed, first_trajectory + i + l));
+        }
+        const double start = profile != NULL ? profile_clock() : 0.0;
+        block_engine(model, timeline, options, random.data(), num_lanes,
+                     out + (i - begin) * trajectory_size, profile);
+        if (profile != NULL) {
+            const double share = (profile_clock() - start) / num_lanes;
+            std::fill(wall_times + (i - begin),
+                      wall_times + (i - begin) + num_lanes, share);
+        }
+    }
+}
+
+// Acquires the parameter values, rate coefficients and volumes of the K
+// points of a parameter sweep, all or none of which must be given, into
+// points: copies of model with those values bound. Without them, points
+// holds model alone.
+bool load_points(PyObject *parameters_obj, PyObject *coefficients_obj,
+                 PyObject *volumes_obj, const ModelView &model,
+                 int64_t num_parameters, Buffer &parameters,
+                 Buffer &coefficients, Buffer &volumes,
+                 std::vector<ModelView> &points)
+{
+    const int given = (parameters_obj != Py_None) +
+                      (coefficients_obj != Py_None) +
+                      (volumes_obj != Py_None);
+    if (given == 0) {
+        points.assign(1, model);
+        return true;
+    }
+    if (given != 3) {
+        PyErr_SetString(PyExc_TypeError, "parameters, rate_coefficients and "
+                                         "volumes must be given together");
+        return false;
+    }
+    if (!parameters.acquire(parameters_obj, "parameters", 'd', false) ||
+        !coefficients.acquire(coefficients_obj, "rate_coefficients", 'd',
+                              false) ||
+        !volumes.acquire(volumes_obj, "volumes", 'd', false)) {
+        return false;
+    }
+    const int64_t num_points = volumes.size();
+    if (num_points == 0 ||
+        parameters.size() != num_points * num_parameters ||
+        coefficients.size() != num_points * model.num_reactions) {
+        PyErr_SetString(PyExc_ValueError,
+                        "parameters, rate_coefficients and volumes do not "
+                        "match the model and each other");
+        return false;
+    }
+    points.assign(num_points, model);
+    for (int64_t k = 0; k < num_points; ++k) {
+        points[k].parameter_values =
+            parameters.data<double>() + k * num_parameters;
+        points[k].rate_coefficients =
+            coefficients.data<double>() + k * model.num_reactions;
+        points[k].volume = volumes.data<double>()[k];
+    }
+    return true;
+}
+
+// Runs num_trajectories trajectories of engine at every point into the
+// running statistics totals[k] of the point, keeping the first num_kept of
+// them in kept, num_kept consecutive trajectories per point. Each block of
+// STATISTICS_BLOCK trajectories is accumulated on its own and merged into
+// the total of its point in ensemble order, once all blocks before it are.
+// Unless profile is NULL, the engines count into it, and wall_times
+// receives the wall time of every trajectory, num_trajectories per point.
+void stream_ensemble(Engine engine, BlockEngine block_engine,
+                     const std::vector<ModelView> &points,
+                     const Timeline &timeline, const EngineOptions &options,
+                     uint64_t seed, uint64_t first_trajectory,
+                     int64_t num_trajectories, int64_t cores,
+                     int64_t num_kept, double *kept, int64_t bins,
+                     const double *ranges,
+                     std::vector<EnsembleStatistics> &totals,
+                     Profile *profile, double *wall_times)
+{
+    const int64_t trajectory_size =
+        timeline.num_times * (timeline.num_species + 1);
+    const int64_t num_points = points.size();
+    const int64_t num_blocks =
+        (num_trajectories + STATISTICS_BLOCK - 1) / STATISTICS_BLOCK;
+    std::mutex merge_mutex;
+    std::vector<std::map<int64_t, std::unique_ptr<EnsembleStatistics> > >
+        finished(num_points);
+    std::vector<int64_t> next_block(num_points, 0);
+
+    const int64_t num_tasks = num_points * num_blocks;
+    SharedProfile profiles(profile);
+    run_ensemble(num_tasks, ensemble_threads(cores, num_tasks),
+                 [&](int64_t task) {
+        const int64_t k = task / num_blocks;
+        const int64_t b = task - k * num_blocks;
+        std::unique_ptr<EnsembleStatistics> block(new EnsembleStatistics(
+            timeline.num_times, timeline.num_species, bins, ranges));
+        // The kept trajectories go straight to kept, the others through a
+        // buffer of one lockstep block.
+        std::vector<double> trajectories(LOCKSTEP_LANES * trajectory_size);
+        std::unique_ptr<Profile> task_profile = profiles.task_profile();
+        const int64_t end =
+            std::min(num_trajectories, (b + 1) * STATISTICS_BLOCK);
+        int64_t i = b * STATISTICS_BLOCK;
+        while (i < end) {
+            const int64_t count =
+                i < num_kept ? std::min(end, num_kept) - i
+                             : std::min(end - i, LOCKSTEP_LANES);
+            double *rows = i < num_kept
+                               ? kept + (k * num_kept + i) * trajectory_size
+                               : trajectories.data();
+            run_trajectories(engine, block_engine, points[k], timeline,
+                             options, seed, first_trajectory, i, i + count,
+                             rows, task_profile.get(),
+                             profile != NULL
+                                 ? wall_times + k * num_trajectories + i
+                                 : NULL);
+            for (int64_t j = 0; j < count; ++j) {
+                block->add(rows + j * trajectory_size);
+            }
+            i += count;
+        }
+        profiles.add(task_profile.get());
+
+        std::lock_guard<std::mutex> lock(merge_mutex);
+        std::map<int64_t, std::unique_ptr<EnsembleStatistics> > &done =
+            finished[k];
+        done[b] = std::move(block);
+        while (!done.empty() && done.begin()->first == next_block[k]) {
+            totals[k].merge(*done.begin()->second);
+            done.erase(done.begin());
+            ++next_block[k];
+        }
+    });
+}
+
+// The counters of profile as a dict, with the phase times estimated.
+PyObject *profile_dict(const Profile &profile)
+{
+    PyObject *firings = PyList_New(profile.firings.size());
+    if (firings == NULL) {
+        return NULL;
+    }
+    for (size_t r = 0; r < profile.firings.size(); ++r) {
+        PyObject *value = PyFloat_FromDouble(profile.firings[r]);
+        if (value == NULL) {
+            Py_DECREF(firings);
+            return NULL;
+        }
+        PyList_SET_ITEM(firings, r, value);
+    }
+    return Py_BuildValue(
+        "{s:N,s:L,s:L,s:L,s:L,s:L,s:d,s:d,s:d}", "firings", firings,
+        "events", static_cast<long long>(profile.events), "leaps",
+        static_cast<long long>(profile.leaps), "rejected_leaps",
+        static_cast<long long>(profile.rejected_leaps), "ssa_bursts",
+        static_cast<long long>(profile.ssa_bursts), "propensity_evaluations",
+        static_cast<long long>(profile.propensity_evaluations),
+        "selection_time", profile.phase_seconds(PHASE_SELECT), "update_time",
+        profile.phase_seconds(PHASE_UPDATE), "recording_time",
+        profile.phase_seconds(PHASE_RECORD));
+}
+
+// Parses (model, times, seed, out) and the engine options and runs the
+// trajectories first_trajectory, first_trajectory + 1, ... of engine into
+// out, with the GIL released, recording the species given by index in
+// species, or all of them. Given statistics, a float64 array of shape
+// (4, len(times), len(species)), num_trajectories trajectories are run
+// instead and only their running statistics (see EnsembleStatistics) and
+// the first len(out) of them are kept; histogram, an int64 array of shape
+// (len(times), len(species), bins), and histogram_range, (len(species), 2)
+// float64 bounds, optionally add histograms. Given the parameters,
+// rate_coefficients and volumes of K sweep points (see load_points()), the
+// trajectories are run at every point, and out, statistics and histogram
+// gain a leading dimension of K; trajectory i of every point draws from
+// the same random stream. block_engine, the lockstep variant of engine if
+// there is one, takes over for the models it supports unless the lockstep
+// keyword is false. Given profile, a float64 array with an element per
+// trajectory run, the engines are profiled: the wall time of every
+// trajectory is written to it, and the counters are returned as a dict
+// (see profile_dict()) instead of None.
+PyObject *run_engine(PyObject *args, PyObject *kwargs, Engine engine,
+                     BlockEngine block_engine = NULL)
+{
+    static const char *keywords[] = {"model", "times", "seed", "out",
+                                     "first_trajectory", "cores", "epsilon",
+                                     "critical_threshold", "ssa_threshold",
+                                     "ssa_steps", "fast_events",
+                                     "continuous_population", "step_size",
+                                     "statistics", "num_trajectories",
+                                     "histogram", "histogram_range",
+                                     "species", "parameters",
+                                     "rate_coefficients", "volumes",
+                                     "lockstep", "profile", NULL};
+    PyObject *model_obj, *times_obj, *out_obj;
+    PyObject *statistics_obj = Py_None, *histogram_obj = Py_None;
+    PyObject *range_obj = Py_None, *species_obj = Py_None;
+    PyObject *parameters_obj = Py_None, *coefficients_obj = Py_None;
+    PyObject *volumes_obj = Py_None, *profile_obj = Py_None;
+    unsigned long long seed;
+    unsigned long long first_trajectory = 0;
+    Py_ssize_t cores = 0;
+    long long num_streamed = -1;
+    EngineOptions options;
+    long long critical_threshold = options.critical_threshold;
+    long long ssa_steps = options.ssa_steps;
+    int lockstep = 1;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OOKO|KndLdLdddOLOOOOOOpO",
+                                     const_cast<char **>(keywords),
+                                     &model_obj, &times_obj, &seed, &out_obj,
+                                     &first_trajectory, &cores,
+                                     &options.epsilon, &critical_threshold,
+                                     &options.ssa_threshold, &ssa_steps,
+                                     &options.fast_events,
+                                     &options.continuous_population,
+                                     &options.step_size, &statistics_obj,
+                                     &num_streamed, &histogram_obj,
+                                     &range_obj, &species_obj,
+                                     &parameters_obj, &coefficients_obj,
+                                     &volumes_obj, &lockstep,
+                                     &profile_obj)) {
+        return NULL;
+    }
+    if (!(options.epsilon > 0.0 && options.epsilon <= 1.0) ||
+        critical_threshold < 0 || !(options.ssa_threshold >= 0.0) ||
+        ssa_steps < 1 || !(options.fast_events >= 0.0) ||
+        !(options.continuous_population >= 0.0) ||
+        !(options.step_size >= 0.0)) {
+        PyErr_SetString(PyExc_ValueError,
+                        "epsilon must be in (0, 1], critical_threshold, "
+                        "ssa_threshold, fast_events, continuous_population "
+                        "and step_size must not be negative and ssa_steps "
+                        "must be positive");
+        return NULL;
+    }
+    options.critical_threshold = critical_threshold;
+    options.ssa_steps = ssa_steps;
+
+    ModelView model;
+    ModelBuffers model_buffers;
+    Buffer times, species, out, parameters, coefficients, volumes;
+    std::vector<int64_t> all_species;
+    std::vector<ModelView> points;
+    Timeline timeline;
+    if (!model_buffers.load(model_obj, model) ||
+        !load_timeline(times_obj, species_obj, model, times, species,
+                       all_species, timeline) ||
+        !load_points(parameters_obj, coefficients_obj, volumes_obj, model,
+                     model_buffers.parameter_values.size(), parameters,
+                     coefficients, volumes, points) ||
+        !out.acquire(out_obj, "out", 'd', true)) {
+        return NULL;
+    }
+
+    if (!lockstep || !lockstep_supported(model)) {
+        block_engine = NULL;
+    }
+
+    const int64_t num_points = points.size();
+    const int64_t trajectory_size =
+        timeline.num_times * (timeline.num_species + 1);
+    if (out.size() % (num_points * trajectory_size) != 0) {
+        PyErr_SetString(PyExc_ValueError,
+                        "'out' does not match the requested output shape");
+        return NULL;
+    }
+
+    double *results = out.data<double>();
+    const int64_t num_trajectories =
+        out.size() / (num_points * trajectory_size);
+    const bool streaming = statistics_obj != Py_None;
+    if (!streaming && (histogram_obj != Py_None || num_streamed >= 0)) {
+        PyErr_SetString(PyExc_TypeError, "num_trajectories and histogram "
+                                         "require statistics");
+        return NULL;
+    }
+    const int64_t num_values = timeline.num_times * timeline.num_species;
+    Buffer statistics, histogram, ranges;
+    int64_t bins = 0;
+    if (streaming) {
+        if (!statistics.acquire(statistics_obj, "statistics", 'd', true)) {
+            return NULL;
+        }
+        if (statistics.size() != num_points * 4 * num_values ||
+            num_streamed < num_trajectories) {
+            PyErr_SetString(PyExc_ValueError,
+                            "'statistics' does not match the output shape, "
+                            "or num_trajectories is less than len(out)");
+            return NULL;
+        }
+        if ((histogram_obj != Py_None) != (range_obj != Py_None)) {
+            PyErr_SetString(PyExc_TypeError, "histogram and histogram_range "
+                                             "must be given together");
+            return NULL;
+        }
+        if (histogram_obj != Py_None) {
+            if (!histogram.acquire(histogram_obj, "histogram", 'q', true) ||
+                !ranges.acquire(range_obj, "histogram_range", 'd', false)) {
+                return NULL;
+            }
+            bins = num_values > 0
+                       ? histogram.size() / (num_points * num_values)
+                       : 0;
+            bool ordered = ranges.size() == 2 * timeline.num_species;
+            for (int64_t s = 0; ordered && s < timeline.num_species; ++s) {
+                ordered = ranges.data<double>()[2 * s] <
+                          ranges.data<double>()[2 * s + 1];
+            }
+            if (bins < 1 ||
+                histogram.size() != num_points * bins * num_values ||
+                !ordered) {
+                PyErr_SetString(PyExc_ValueError,
+                                "'histogram' or 'histogram_range' does not "
+                                "match the output shape");
+                return NULL;
+            }
+        }
+    }
+
+    Buffer wall_times;
+    std::unique_ptr<Profile> profile;
+    if (profile_obj != Py_None) {
+        if (!wall_times.acquire(profile_obj, "profile", 'd', true)) {
+            return NULL;
+        }
+        if (wall_times.size() !=
+            num_points * (streaming ? num_streamed : num_trajectories)) {
+            PyErr_SetString(PyExc_ValueError, "'profile' does not have an "
+                                              "element per trajectory");
+            return NULL;
+        }
+        profile.reset(new Profile(model.num_reactions));
+    }
+    double *trajectory_times =
+        profile ? wall_times.data<double>() : NULL;
+
+    bool out_of_memory = false;
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        if (streaming) {
+            const double *bin_ranges =
+                bins > 0 ? ranges.data<double>() : NULL;
+            std::vector<EnsembleStatistics> totals;
+            totals.reserve(num_points);
+            for (int64_t k = 0; k < num_points; ++k) {
+                totals.push_back(EnsembleStatistics(
+                    timeline.num_times, timeline.num_species, bins,
+                    bin_ranges));
+            }
+            stream_ensemble(engine, block_engine, points, timeline,
+                            options, seed, first_trajectory, num_streamed,
+                            cores, num_trajectories, results, bins,
+                            bin_ranges, totals, profile.get(),
+                            trajectory_times);
+            for (int64_t k = 0; k < num_points; ++k) {
+                totals[k].write(statistics.data<double>() +
+                                    k * 4 * num_values,
+                                bins > 0 ? histogram.data<int64_t>() +
+                                               k * bins * num_values
+                                         : NULL);
+            }
+        } else {
+            // A task is one trajectory, or one lockstep block of them.
+            const int64_t chunk = block_engine != NULL ? LOCKSTEP_LANES : 1;
+            const int64_t num_chunks = (num_trajectories + chunk - 1) / chunk;
+            const int64_t num_tasks = num_points * num_chunks;
+            SharedProfile profiles(profile.get());
+            run_ensemble(num_tasks, ensemble_threads(cores, num_tasks),
+                         [&](int64_t task) {
+                             const int64_t k = task / num_chunks;
+                             const int64_t begin = (task - k * num_chunks) *
+                                                   chunk;
+                             const int64_t end =
+                                 std::min(num_trajectories, begin + chunk);
+                             const int64_t first = k * num_trajectories +
+                                                   begin;
+                             std::unique_ptr<Profile> task_profile =
+                                 profiles.task_profile();
+                             run_trajectories(
+                                 engine, block_engine, points[k], timeline,
+                                 options, seed, first_trajectory, begin, end,
+                                 results + first * trajectory_size,
+                                 task_profile.get(),
+                                 profile ? trajectory_times + first : NULL);
+                             profiles.add(task_profile.get());
+                         });
+        }
+    } catch (const std::bad_alloc &) {
+        out_of_memory = true;
+    }
+    Py_END_ALLOW_THREADS
+
+    if (out_of_memory) {
+        return PyErr_NoMemory();
+    }
+    if (profile) {
+        return profile_dict(*profile);
+    }
+    Py_RETURN_NONE;
+}
+
+const char ssa_direct_doc[] =
+    "ssa_direct(model, times, seed, out, first_trajectory=0, cores=0,\n"
+    "           species=None)\n"
+    "\n"
+    "Runs direct method trajectories into out, a float64 array of shape\n"
+    "(trajectories, len(times), 1 + len(species)); column 0 holds the\n"
+    "output time, and the others the populations of the species with the\n"
+    "int64 indices species, all of them by default. times need not be\n"
+    "evenly spaced, only non-decreasing. out[i] is trajectory number\n"
+    "first_trajectory + i of the ensemble with the given 64-bit seed, and\n"
+    "draws from its own random stream. Trajectories are spread over cores\n"
+    "threads, all hardware threads if cores is 0; the results do not\n"
+    "depend on the number of threads.\n"
+    "\n"
+    "All engines also take statistics, num_trajectories, histogram and\n"
+    "histogram_range keywords. Given statistics, a float64 array of shape\n"
+    "(4, len(times), len(species)), num_trajectories trajectories are run\n"
+    "and only the first len(out) of them are kept; statistics receives\n"
+    "the mean, the sample variance, the minimum and the maximum of every\n"
+    "species at every time, in that order. histogram, an int64 array of\n"
+    "shape (len(times), len(species), bins), then receives the counts of\n"
+    "each species in bins equal-width bins between its histogram_range[i]\n"
+    "= (low, high); values outside fall in the first or last bin.\n"
+    "\n"
+    "Parameter sweeps take parameters, a (K, len(model.parameter_values))\n"
+    "float64 array, the matching (K, model.num_reactions)\n"
+    "rate_coefficients and volumes of length K, all three together. The\n"
+    "trajectories are then run at each of the K points, sharing the\n"
+    "compiled model, into out of shape (K, trajectories, len(times),\n"
+    "1 + len(species)), and statistics and histogram gain the same\n"
+    "leading dimension. Trajectory i draws from the same random stream\n"
+    "at every point, so out[k] equals a run of the model with the values\n"
+    "of point k.\n"
+    "\n"
+    "Given profile, a float64 array with an element per trajectory run\n"
+    "(K x num_trajectories of them with statistics, K x trajectories\n"
+    "otherwise), the engines count their work: profile receives the wall\n"
+    "time of every trajectory in seconds, and the call returns a dict of\n"
+    "the firings of every reaction, the numbers of exact events, of\n"
+    "accepted and rejected leaps, of bursts of exact steps taken instead\n"
+    "of leaps and of propensity evaluations, and the seconds spent\n"
+    "selecting, carrying out and recording steps, the first two estimated\n"
+    "from one step in 64. Every thread counts on its own, so profiling\n"
+    "barely slows the engines down.";
+
+PyObject *py_ssa_direct(PyObject *, PyObject *args, PyObject *kwargs)
+{
+    return run_engine(args, kwargs, ssa_direct);
+}
+
+const char ssa_next_reaction_doc[] =
+    "ssa_next_reaction(model, times, seed, out, first_trajectory=0,\n"
+    "                  cores=0)\n"
+    "\n"
+    "Same as ssa_direct, using the next reaction method.";
+
+PyObject *py_ssa_next_reaction(PyObject *, PyObject *args, PyObject *kwargs)
+{
+    return run_engine(args, kwargs, ssa_next_reaction);
+}
+
+const char tau_leaping_doc[] =
+    "tau_leaping(model, times, seed, out, first_trajectory=0, cores=0,\n"
+    "            epsilon=0.03, critical_threshold=10, ssa_threshold=10,\n"
+    "            ssa_steps=100, lockstep=True)\n"
+    "\n"
+    "Same as ssa_direct, using explicit tau-leaping with the step size\n"
+    "selection of Cao et al. (2006). epsilon bounds the relative change of\n"
+    "the propensities in one leap, and is lowered while leaps are\n"
+    "rejected; reactions that can fire fewer than critical_threshold\n"
+    "times before exhausting a reactant are simulated one event at a\n"
+    "time. Whenever the leap would be shorter than ssa_threshold mean\n"
+    "reaction waiting times, ssa_steps exact steps are taken instead.\n"
+    "\n"
+    "With lockstep, small mass-action models are simulated in blocks of\n"
+    "trajectories that share their propensity evaluations and step size\n"
+    "selections as SIMD vectors; the trajectories are the same either\n"
+    "way.";
+
+PyObject *py_tau_leaping(PyObject *, PyObject *args, PyObject *kwargs)
+{
+    return run_engine(args, kwargs, tau_leaping, tau_leaping_lockstep);
+}
+
+const char hybrid_doc[] =
+    "hybrid(model, times, seed, out, first_trajectory=0, cores=0,\n"
+    "       epsilon=0.03, fast_events=10, continuous_population=100)\n"
+    "\n"
+    "Same as ssa_direct, using the hybrid method of Salis and Kaznessis\n"
+    "(2005). Before every step, the reactions that change only species\n"
+    "with populations of at least continuous_population and fire at least\n"
+    "fast_events times per step are integrated as rate equations, over\n"
+    "steps that move every population by a fraction epsilon of its gross\n"
+    "flux at most; the others fire exactly. model.species_modes forces\n"
+    "species to be simulated discretely or continuously. The populations\n"
+    "of continuously simulated species are not rounded.";
+
+PyObject *py_hybrid(PyObject *, PyObject *args, PyObject *kwargs)
+{
+    return run_engine(args, kwargs, hybrid);
+}
+
+const char chemical_langevin_doc[] =
+    "chemical_langevin(model, times, seed, out, first_trajectory=0,\n"
+    "                  cores=0, epsilon=0.03, step_size=0,\n"
+    "                  lockstep=True)\n"
+    "\n"
+    "Same as ssa_direct, integrating the chemical Langevin equation by\n"
+    "the Euler-Maruyama method. Steps are step_size long, or, if that is\n"
+    "0, keep the expected change and the standard deviation of every\n"
+    "population below epsilon times the population. Populations are\n"
+    "real-valued and reflected at 0. lockstep is as for tau_leaping.";
+
+PyObject *py_chemical_langevin(PyObject *, PyObject *args, PyObject *kwargs)
+{
+    return run_engine(args, kwargs, chemical_langevin,
+                      chemical_langevin_lockstep);
+}
+
+const char ode_doc[] =
+    "ode(model, times, out, rtol=1e-6, atol=1e-8, parameters=None,\n"
+    "    rate_coefficients=None, cores=0, species=None)\n"
+    "\n"
+    "Integrates the reaction rate equations of model with the stiff\n"
+    "Rosenbrock method RODAS4 and the analytic Jacobian, and writes the\n"
+    "states at times into out, a float64 array of shape\n"
+    "(len(times), 1 + len(species)) laid out like one trajectory of\n"
+    "ssa_direct. Raises RuntimeError if the step size underflows.\n"
+    "\n"
+    "Given parameters, a (K, len(model.parameter_values)) float64 array,\n"
+    "and the matching (K, model.num_reactions) rate_coefficients, the K\n"
+    "systems are integrated on cores threads (all hardware threads if\n"
+    "cores is 0) into out of shape (K, len(times), 1 + len(species)).\n"
+    "A system whose step size underflows is filled with NaN from the\n"
+    "failure on instead of raising.";
+
+PyObject *py_ode(PyObject *, PyObject *args, PyObject *kwargs)
+{
+    static const char *keywords[] = {"model", "times", "out", "rtol", "atol",
+                                     "parameters", "rate_coefficients",
+                                     "cores", "species", NULL};
+    PyObject *model_obj, *times_obj, *out_obj;
+    PyObject *parameters_obj = Py_None, *coefficients_obj = Py_None;
+    PyObject *species_obj = Py_None;
+    Py_ssize_t cores = 0;
+    OdeOptions options;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OOO|ddOOnO",
+                                     const_cast<char **>(keywords),
+                                     &model_obj, &times_obj, &out_obj,
+                                     &options.rtol, &options.atol,
+                                     &parameters_obj, &coefficients_obj,
+                                     &cores, &species_obj)) {
+        return NULL;
+    }
+    if (!(options.rtol > 0.0) || !(options.atol > 0.0)) {
+        PyErr_SetString(PyExc_ValueError,
+                        "rtol and atol must be positive");
+        return NULL;
+    }
+    const bool batch = parameters_obj != Py_None;
+    if (batch != (coefficients_obj != Py_None)) {
+        PyErr_SetString(PyExc_TypeError, "parameters and rate_coefficients "
+                                         "must be given together");
+        return NULL;
+    }
+
+    ModelView model;
+    ModelBuffers model_buffers;
+    Buffer times, species, out, parameters, coefficients;
+    std::vector<int64_t> all_species;
+    Timeline timeline;
+    if (!model_buffers.load(model_obj, model) ||
+        !load_timeline(times_obj, species_obj, model, times, species,
+                       all_species, timeline) ||
+        !out.acquire(out_obj, "out", 'd', true)) {
+        return NULL;
+    }
+    if (batch &&
+        (!parameters.acquire(parameters_obj, "parameters", 'd', false) ||
+         !coefficients.acquire(coefficients_obj, "rate_coefficients", 'd',
+                               false))) {
+        return NULL;
+    }
+
+    const int64_t trajectory_size =
+        timeline.num_times * (timeline.num_species + 1);
+    const int64_t num_systems = out.size() / trajectory_size;
+    const int64_t num_parameters = model_buffers.parameter_values.size();
+    if (out.size() != num_systems * trajectory_size ||
+        (!batch && num_systems != 1)) {
+        PyErr_SetString(PyExc_ValueError,
+                        "'out' does not match the requested output shape");
+        return NULL;
+    }
+    if (batch && (parameters.size() != num_systems * num_parameters ||
+                  coefficients.size() != num_systems * model.num_reactions)) {
+        PyErr_SetString(PyExc_ValueError,
+                        "parameters and rate_coefficients do not match the "
+                        "model and output dimensions");
+        return NULL;
+    }
+
+    double *results = out.data<double>();
+    std::vector<char> failed(num_systems, 0);
+    bool out_of_memory = false;
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        run_ensemble(num_systems, ensemble_threads(batch ? cores : 1,
+                                                   num_systems),
+                     [&](int64_t k) {
+                         ModelView system = model;
+                         if (batch) {
+                             system.parameter_values =
+                                 parameters.data<double>() +
+                                 k * num_parameters;
+                             system.rate_coefficients =
+                                 coefficients.data<double>() +
+                                 k * model.num_reactions;
+                         }
+                         double *trajectory = results + k * trajectory_size;
+                         // Populations at output times not reached are
+                         // left NaN.
+                         for (int64_t i = 0; i < trajectory_size; ++i) {
+                             if (i % (timeline.num_species + 1) != 0) {
+                                 trajectory[i] = NAN;
+                             }
+                         }
+                         failed[k] = !ode_rosenbrock(system, timeline,
+                                                     options, trajectory);
+                     });
+    } catch (const std::bad_alloc &) {
+        out_of_memory = true;
+    }
+    Py_END_ALLOW_THREADS
+
+    if (out_of_memory) {
+        return PyErr_NoMemory();
+    }
+    if (!batch && failed[0]) {
+        PyErr_SetString(PyExc_RuntimeError,
+                        "the integration step size became too small");
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+#ifdef GILLESPY2_CUDA
+const char gpu_ssa_direct_doc[] =
+    "gpu_ssa_direct(model, times, seed, out, first_trajectory=0, cores=0,\n"
+    "               statistics=None, num_trajectories=-1, histogram=None,\n"
+    "               histogram_range=None, species=None, device=0)\n"
+    "\n"
+    "Same as ssa_direct, on CUDA device number device: one trajectory per\n"
+    "device thread, from the same random stream as on the CPU. Given\n"
+    "statistics, they are reduced on the device, and only they and the\n"
+    "first len(out) trajectories are copied back. cores is ignored, and\n"
+    "histogram and histogram_range must be None: histograms and parameter\n"
+    "sweeps are not supported. The device math library may round\n"
+    "differently, so the results equal those of ssa_direct in\n"
+    "distribution rather than bit for bit. Raises RuntimeError on CUDA\n"
+    "errors.";
+
+PyObject *py_gpu_ssa_direct(PyObject *, PyObject *args, PyObject *kwargs)
+{
+    static const char *keywords[] = {"model", "times", "seed", "out",
+                                     "first_trajectory", "cores",
+                                     "statistics", "num_trajectories",
+                                     "histogram", "histogram_range",
+                                     "species", "device", NULL};
+    PyObject *model_obj, *times_obj, *out_obj;
+    PyObject *statistics_obj = Py_None, *histogram_obj = Py_None;
+    PyObject *range_obj = Py_None, *species_obj = Py_None;
+    unsigned long long seed;
+    unsigned long long first_trajectory = 0;
+    Py_ssize_t cores = 0;
+    long long num_streamed = -1;
+    int device = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OOKO|KnOLOOOi",
+                                     const_cast<char **>(keywords),
+                                     &model_obj, &times_obj, &seed, &out_obj,
+                                     &first_trajectory, &cores,
+                                     &statistics_obj, &num_streamed,
+                                     &histogram_obj, &range_obj,
+                                     &species_obj, &device)) {
+        return NULL;
+    }
+    if (histogram_obj != Py_None || range_obj != Py_None) {
+        PyErr_SetString(PyExc_TypeError,
+                        "gpu_ssa_direct does not support histograms");
+        return NULL;
+    }
+
+    ModelView model;
+    ModelBuffers model_buffers;
+    Buffer times, species, out, statistics;
+    std::vector<int64_t> all_species;
+    Timeline timeline;
+    if (!model_buffers.load(model_obj, model) ||
+        !load_timeline(times_obj, species_obj, model, times, species,
+                       all_species, timeline) ||
+        !out.acquire(out_obj, "out", 'd', true)) {
+        return NULL;
+    }
+
+    const int64_t trajectory_size =
+        timeline.num_times * (timeline.num_species + 1);
+    if (out.size() % trajectory_size != 0) {
+        PyErr_SetString(PyExc_ValueError,
+                        "'out' does not match the requested output shape");
+        return NULL;
+    }
+    const int64_t num_kept = out.size() / trajectory_size;
+    const bool streaming = statistics_obj != Py_None;
+    if (!streaming && num_streamed >= 0) {
+        PyErr_SetString(PyExc_TypeError,
+                        "num_trajectories requires statistics");
+        return NULL;
+    }
+    if (streaming) {
+        if (!statistics.acquire(statistics_obj, "statistics", 'd', true)) {
+            return NULL;
+        }
+        if (statistics.size() !=
+                4 * timeline.num_times * timeline.num_species ||
+            num_streamed < num_kept) {
+            PyErr_SetString(PyExc_ValueError,
+                            "'statistics' does not match the output shape, "
+                            "or num_trajectories is less than len(out)");
+            return NULL;
+        }
+    }
+
+    std::string error;
+    bool out_of_memory = false;
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        error = gpu_ssa_direct(
+            model, model_buffers.program_constants.size(),
+            model_buffers.parameter_values.size(), timeline, seed,
+            first_trajectory, streaming ? num_streamed : num_kept, num_kept,
+            out.data<double>(),
+            streaming ? statistics.data<double>() : NULL, device);
+    } catch (const std::bad_alloc &) {
+        out_of_memory = true;
+    }
+    Py_END_ALLOW_THREADS
+
+    if (out_of_memory) {
+        return PyErr_NoMemory();
+    }
+    if (!error.empty()) {
+        PyErr_SetString(PyExc_RuntimeError, error.c_str());
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+#endif
+
+PyMethodDef native_methods[] = {
+    {"ssa_direct", reinterpret_cast<PyCFunction>(py_ssa_direct),
+     METH_VARARGS | METH_KEYWORDS, ssa_direct_doc},
+    {"ssa_next_reaction", reinterpret_cast<PyCFunction>(py_ssa_next_reaction),
+     METH_VARARGS | METH_KEYWORDS, ssa_next_reaction_doc},
+    {"tau_leaping", reinterpret_cast<PyCFunction>(py_tau_leaping),
+     METH_VARARGS | METH_KEYWORDS, tau_leaping_doc},
+    {"hybrid", reinterpret_cast<PyCFunction>(py_hybrid),
+     METH_VARARGS | METH_KEYWORDS, hybrid_doc},
+    {"chemical_langevin", reinterpret_cast<PyCFunction>(py_chemical_langevin),
+     METH_VARARGS | METH_KEYWORDS, chemical_langevin_doc},
+    {"ode", reinterpret_cast<PyCFunction>(py_ode),
+     METH_VARARGS | METH_KEYWORDS, ode_doc},
+#ifdef GILLESPY2_CUDA
+    {"gpu_ssa_direct", reinterpret_cast<PyCFunction>(py_gpu_ssa_direct),
+     METH_VARARGS | METH_KEYWORDS, gpu_ssa_direct_doc},
+#endif
+    {NULL, NULL, 0, NULL}};
+
+struct PyModuleDef native_module = {
+    PyModuleDef_HEAD_INIT,
+    "_native",
+    "Native simulation engines for gillespy2.",
+    -1,
+    native_methods,
+    NULL,
+    NULL,
+    NULL,
+    NULL};
+
+} // namespace
+
+PyMODINIT_FUNC PyInit__native(void)
+{
+    return PyModule_Create(&native_module);
+}
@@ -0,0 +1,95 @@
+#include "ssa.h"
+
+#include <limits>
+#include <vector>
+
+#include "indexed_heap.h"
+#include "propensity.h"
+#include "random.h"
+
+namespace gillespy2 {
+
+void ssa_next_reaction(const ModelView &model, const Timeline &timeline,
+                       const EngineOptions &, Random &random, double *out,
+                       Profile *profile)
+{
+    const double never = std::numeric_limits<double>::infinity();
+
+    std::vector<double> x(model.initial_state,
+                          model.initial_state + model.num_species);
+    std::vector<double> propensity(model.num_reactions);
+    std::vector<double> firing_time(model.num_reactions, never);
+    Propensities propensities(model);
+    StepTimer timer(profile);
+
+    for (int64_t r = 0; r < model.num_reactions; ++r) {
+        propensity[r] = propensities(r, x.data());
+        if (propensity[r] > 0.0) {
+            firing_time[r] = random.exponential(propensity[r]);
+        }
+    }
+    IndexedHeap queue(firing_time);
+
+    int64_t next_output = 0;
+
+    while (next_output < timeline.num_times && !queue.empty()) {
+        timer.begin_step();
+        const int64_t reaction = queue.top();
+        const double t = queue.key(reaction);
+
+        // Nothing can fire anymore, the state is final.
+        if (t == never) {
+            break;
+        }
+
+        // The current state holds until the next firing time.
+        record_before(model, timeline, x.data(), t, next_output, out, timer);
+        if (next_output == timeline.num_times) {
+            break;
+        }
+
+        timer.phase(PHASE_UPDATE);
+        fire_reaction(model, reaction, x.data());
+
+        // The fired reaction always needs a fresh firing time, even if its
+        // propensity does not depend on its own products.
+        bool fired_updated = false;
+        for (int64_t k = model.dependency_indptr[reaction];
+             k < model.dependency_indptr[reaction + 1]; ++k) {
+            const int64_t r = model.dependency_indices[k];
+            const double old_propensity = propensity[r];
+            propensity[r] = propensities(r, x.data());
+            double next_time = never;
+            if (propensity[r] > 0.0) {
+                if (r == reaction || old_propensity <= 0.0) {
+                    next_time = t + random.exponential(propensity[r]);
+                } else {
+                    // Rescale the remaining waiting time (Gibson and Bruck
+                    // 2000), which saves a random number per update.
+                    next_time = t + (old_propensity / propensity[r]) *
+                                        (queue.key(r) - t);
+                }
+            }
+            queue.update(r, next_time);
+            fired_updated = fired_updated || r == reaction;
+        }
+        if (!fired_updated) {
+            queue.update(reaction,
+                         propensity[reaction] > 0.0
+                             ? t + random.exponential(propensity[reaction])
+                             : never);
+        }
+        if (profile != NULL) {
+            profile->firings[reaction] += 1.0;
+            ++profile->events;
+        }
+    }
+    timer.close_phase();
+
+    record_rest(model, timeline, x.data(), next_output, out, timer);
+    if (profile != NULL) {
+        profile->propensity_evaluations += propensities.evaluations();
+    }
+}
+
+} // namespace gillespy2
@@ -0,0 +1,322 @@
+#include "ode.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "propensity.h"
+
+namespace gillespy2 {
+
+namespace {
+
+// RODAS4 coefficients, as in Hairer's rodas.f (method 1). Stage i is
+// evaluated at y + sum_j A[i][j] k_j and adds sum_j C[i][j] / h k_j to the
+// right-hand side; the last stage gives the new solution and its own
+// value is the error estimate.
+const int STAGES = 6;
+const double GAMMA = 0.25;
+const double A[STAGES][STAGES - 1] = {
+    {0.0, 0.0, 0.0, 0.0, 0.0},
+    {1.544, 0.0, 0.0, 0.0, 0.0},
+    {0.9466785280815826, 0.2557011698983284, 0.0, 0.0, 0.0},
+    {3.314825187068521, 2.896124015972201, 0.9986419139977817, 0.0, 0.0},
+    {1.221224509226641, 6.019134481288629, 12.53708332932087,
+     -0.6878860361058950, 0.0},
+    {1.221224509226641, 6.019134481288629, 12.53708332932087,
+     -0.6878860361058950, 1.0}};
+const double C[STAGES][STAGES - 1] = {
+    {0.0, 0.0, 0.0, 0.0, 0.0},
+    {-5.6688, 0.0, 0.0, 0.0, 0.0},
+    {-2.430093356833875, -0.2063599157091915, 0.0, 0.0, 0.0},
+    {-0.1073529058151375, -9.594562251023355, -20.47028614809616, 0.0,
+     0.0},
+    {7.496443313967647, -10.24680431464352, -33.99990352819905,
+     11.70890893206160, 0.0},
+    {8.083246795921522, -7.981132988064893, -31.52159432874371,
+     16.31930543123136, -6.058818238834054}};
+
+// Step size controller bounds and safety factor.
+const double MAX_GROWTH = 6.0;
+const double MAX_SHRINK = 0.2;
+const double SAFETY = 0.9;
+
+// x (x - 1) ... (x - n + 1) and its derivative.
+inline void falling_factorial(double x, int64_t n, double &value,
+                              double &derivative)
+{
+    value = 1.0;
+    derivative = 0.0;
+    for (int64_t m = 0; m < n; ++m) {
+        derivative = derivative * (x - m) + value;
+        value *= x - m;
+    }
+}
+
+// Right-hand side f(x) = V^T a(x) of the rate equations and its Jacobian.
+class RateEquations {
+public:
+    explicit RateEquations(const ModelView &model)
+        : model_(model), propensities_(model), shifted_(model.num_species),
+          program_species_indptr_(1, 0)
+    {
+        // Species read by each propensity program, for finite differences.
+        std::vector<char> read(model.num_species);
+        for (int64_t r = 0; r < model.num_reactions; ++r) {
+            std::fill(read.begin(), read.end(), 0);
+            for (int64_t k = model.program_indptr[r];
+                 k < model.program_indptr[r + 1]; ++k) {
+                if (model.program_code[2 * k] == OP_SPECIES &&
+                    !read[model.program_code[2 * k + 1]]) {
+                    read[model.program_code[2 * k + 1]] = 1;
+                    program_species_.push_back(model.program_code[2 * k + 1]);
+                }
+            }
+            program_species_indptr_.push_back(program_species_.size());
+        }
+    }
+
+    void rates(const double *x, double *f)
+    {
+        std::fill(f, f + model_.num_species, 0.0);
+        for (int64_t r = 0; r < model_.num_reactions; ++r) {
+            const double a = propensities_(r, x);
+            if (a != 0.0) {
+                add_column(r, a, f);
+            }
+        }
+    }
+
+    // Dense, row-major (species x species) Jacobian df/dx at x.
+    void jacobian(const double *x, double *jac)
+    {
+        const int64_t n = model_.num_species;
+        std::fill(jac, jac + n * n, 0.0);
+        for (int64_t r = 0; r < model_.num_reactions; ++r) {
+            if (model_.program_indptr[r] == model_.program_indptr[r + 1]) {
+                kernel_derivatives(r, x, jac);
+            } else {
+                program_derivatives(r, x, jac);
+            }
+        }
+    }
+
+private:
+    // f += a v_r
+    void add_column(int64_t r, double a, double *f) const
+    {
+        for (int64_t k = model_.stoich_indptr[r];
+             k < model_.stoich_indptr[r + 1]; ++k) {
+            f[model_.stoich_indices[k]] += a * model_.stoich_values[k];
+        }
+    }
+
+    // jac[:, i] += da_r/dx_i v_r
+    void add_derivative(int64_t r, int64_t i, double derivative,
+                        double *jac) const
+    {
+        const int64_t n = model_.num_species;
+        for (int64_t k = model_.stoich_indptr[r];
+             k < model_.stoich_indptr[r + 1]; ++k) {
+            jac[model_.stoich_indices[k] * n + i] +=
+                derivative * model_.stoich_values[k];
+        }
+    }
+
+    void kernel_derivatives(int64_t r, const double *x, double *jac) const
+    {
+        const int64_t begin = model_.kernel_indptr[r];
+        const int64_t end = model_.kernel_indptr[r + 1];
+        for (int64_t k = begin; k < end; ++k) {
+            double derivative = model_.rate_coefficients[r];
+            for (int64_t j = begin; j < end; ++j) {
+                double value, slope;
+                falling_factorial(x[model_.kernel_species[j]],
+                                  model_.kernel_orders[j], value, slope);
+                derivative *= j == k ? slope : value;
+            }
+            if (derivative != 0.0) {
+                add_derivative(r, model_.kernel_species[k], derivative, jac);
+            }
+        }
+    }
+
+    void program_derivatives(int64_t r, const double *x, double *jac)
+    {
+        const double a = propensities_(r, x);
+        std::copy(x, x + model_.num_species, shifted_.begin());
+        for (int64_t k = program_species_indptr_[r];
+             k < program_species_indptr_[r + 1]; ++k) {
+            const int64_t i = program_species_[k];
+            const double delta = 1.5e-8 * std::max(std::fabs(x[i]), 1.0);
+            shifted_[i] = x[i] + delta;
+            const double derivative = (propensities_(r, shifted_.data()) - a) /
+                                      delta;
+            shifted_[i] = x[i];
+            if (derivative != 0.0) {
+                add_derivative(r, i, derivative, jac);
+            }
+        }
+    }
+
+    const ModelView &model_;
+    Propensities propensities_;
+    std::vector<double> shifted_;
+    std::vector<int64_t> program_species_indptr_;
+    std::vector<int64_t> program_species_;
+};
+
+// In-place LU factorization with partial pivoting of the dense n x n matrix
+// m. Returns false if m is singular.
+bool lu_factor(int64_t n, double *m, int64_t *pivots)
+{
+    for (int64_t c = 0; c < n; ++c) {
+        int64_t pivot = c;
+        for (int64_t r = c + 1; r < n; ++r) {
+            if (std::fabs(m[r * n + c]) > std::fabs(m[pivot * n + c])) {
+                pivot = r;
+            }
+        }
+        pivots[c] = pivot;
+        if (m[pivot * n + c] == 0.0) {
+            return false;
+        }
+        if (pivot != c) {
+            std::swap_ranges(m + c * n, m + (c + 1) * n, m + pivot * n);
+        }
+        const double inverse = 1.0 / m[c * n + c];
+        for (int64_t r = c + 1; r < n; ++r) {
+            const double factor = m[r * n + c] * inverse;
+            m[r * n + c] = factor;
+            if (factor != 0.0) {
+                for (int64_t j = c + 1; j < n; ++j) {
+                    m[r * n + j] -= factor * m[c * n + j];
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// Solves m x = b in place, given the factorization of lu_factor().
+void lu_solve(int64_t n, const double *m, const int64_t *pivots, double *b)
+{
+    for (int64_t c = 0; c < n; ++c) {
+        std::swap(b[c], b[pivots[c]]);
+        for (int64_t r = c + 1; r < n; ++r) {
+            b[r] -= m[r * n + c] * b[c];
+        }
+    }
+    for (int64_t c = n - 1; c >= 0; --c) {
+        for (int64_t j = c + 1; j < n; ++j) {
+            b[c] -= m[c * n + j] * b[j];
+        }
+        b[c] /= m[c * n + c];
+    }
+}
+
+} // namespace
+
+bool ode_rosenbrock(const ModelView &model, const Timeline &timeline,
+                    const OdeOptions &options, double *out)
+{
+    const int64_t n = model.num_species;
+    std::vector<double> y(model.initial_state, model.initial_state + n);
+    std::vector<double> argument(n), y_new(n);
+    std::vector<double> stages(STAGES * n);
+    std::vector<double> jac(n * n), matrix(n * n);
+    std::vector<int64_t> pivots(n);
+    RateEquations equations(model);
+
+    double t = 0.0;
+    int64_t next_output = 0;
+    while (next_output < timeline.num_times &&
+           timeline.times[next_output] <= t) {
+        record_state(model, timeline, y.data(), next_output++, out);
+    }
+    if (next_output == timeline.num_times) {
+        return true;
+    }
+
+    // The first step is grown from a small one by the controller.
+    double h = 1e-6 * std::max(timeline.times[timeline.num_times - 1], 1.0);
+    bool jacobian_current = false;
+
+    while (next_output < timeline.num_times) {
+        // Steps end exactly on the output times.
+        const double until_output = timeline.times[next_output] - t;
+        const bool to_output = h >= until_output;
+        const double step = to_output ? until_output : h;
+
+        if (!jacobian_current) {
+            equations.jacobian(y.data(), jac.data());
+            jacobian_current = true;
+        }
+        const double diagonal = 1.0 / (step * GAMMA);
+        for (int64_t k = 0; k < n * n; ++k) {
+            matrix[k] = -jac[k];
+        }
+        for (int64_t i = 0; i < n; ++i) {
+            matrix[i * n + i] += diagonal;
+        }
+
+        double error = 0.0;
+        if (lu_factor(n, matrix.data(), pivots.data())) {
+            for (int s = 0; s < STAGES; ++s) {
+                double *stage = &stages[s * n];
+                for (int64_t i = 0; i < n; ++i) {
+                    double value = y[i];
+                    for (int j = 0; j < s; ++j) {
+                        value += A[s][j] * stages[j * n + i];
+                    }
+                    argument[i] = value;
+                }
+                equations.rates(argument.data(), stage);
+                for (int j = 0; j < s; ++j) {
+                    const double c = C[s][j] / step;
+                    for (int64_t i = 0; i < n; ++i) {
+                        stage[i] += c * stages[j * n + i];
+                    }
+                }
+                lu_solve(n, matrix.data(), pivots.data(), stage);
+            }
+            const double *last = &stages[(STAGES - 1) * n];
+            for (int64_t i = 0; i < n; ++i) {
+                y_new[i] = argument[i] + last[i];
+                const double scale =
+                    options.atol +
+                    options.rtol * std::max(std::fabs(y[i]),
+                                            std::fabs(y_new[i]));
+                error += (last[i] / scale) * (last[i] / scale);
+            }
+            error = n > 0 ? std::sqrt(error / n) : 0.0;
+        } else {
+            error = HUGE_VAL;
+        }
+
+        double factor = error > 0.0 ? SAFETY * std::pow(error, -0.25)
+                                    : MAX_GROWTH;
+        factor = std::min(MAX_GROWTH, std::max(MAX_SHRINK, factor));
+        if (error <= 1.0) {
+            y.swap(y_new);
+            jacobian_current = false;
+            t = to_output ? timeline.times[next_output] : t + step;
+            while (next_output < timeline.num_times &&
+                   timeline.times[next_output] <= t) {
+                record_state(model, timeline, y.data(), next_output++, out);
+            }
+            // A step shortened to hit an output time says little about
+            // the step size the solution allows.
+            h = to_output ? std::max(h, step * factor) : step * factor;
+        } else {
+            h = step * std::min(factor, 1.0);
+        }
+        if (!(h > 1e-14 * std::max(std::fabs(t), 1.0))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace gillespy2
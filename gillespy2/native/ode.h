@@ -0,0 +1,39 @@
+/*
+ * Deterministic integration of the reaction rate equations.
+ */
+#ifndef GILLESPY2_NATIVE_ODE_H
+#define GILLESPY2_NATIVE_ODE_H
+
+#include <cstdint>
+
+#include "model.h"
+#include "ssa.h"
+
+namespace gillespy2 {
+
+// Error tolerances of the integrator. A step is accepted when the error
+// estimate of every species is below atol + rtol * |x_i|.
+struct OdeOptions {
+    double rtol;
+    double atol;
+
+    OdeOptions() : rtol(1e-6), atol(1e-8) {}
+};
+
+// Integrates dx/dt = sum_r v_r a_r(x), where v_r is the stoichiometry and
+// a_r the propensity of reaction r, from the initial state and writes the
+// states at the output times to out in the layout of the stochastic
+// engines (see ssa.h). Uses the stiffly accurate, L-stable Rosenbrock
+// method RODAS4 (Hairer and Wanner, "Solving Ordinary Differential
+// Equations II", 1996) with adaptive step size control. Its Jacobian is
+// assembled from the analytic derivatives of the mass-action kernels and
+// from finite differences of the propensity programs, both in
+// O(nonzeros) per step; the linear systems are solved by dense LU
+// factorization. Returns false, with the rows from the failure on left
+// unwritten, if the step size underflows.
+bool ode_rosenbrock(const ModelView &model, const Timeline &timeline,
+                    const OdeOptions &options, double *out);
+
+} // namespace gillespy2
+
+#endif
@@ -0,0 +1,179 @@
+/*
+ * Optional instrumentation of the simulation engines.
+ *
+ * An engine given a Profile counts its work into it: the firings of every
+ * reaction, exact events, leaps taken and rejected, fallbacks to exact
+ * steps and propensity evaluations, and times its steps. Every task of
+ * an ensemble fills a Profile of its own, which is merged into the total
+ * once the task is done, so counting costs a few additions per step to
+ * memory no other thread writes; given NULL, the engines skip it at the
+ * cost of a branch. Reading the clock around every phase of every step
+ * would cost more than a small step itself, so only one step in
+ * PROFILE_SAMPLE_INTERVAL is timed, and the phase times are estimated
+ * from those steps. Recording the output is timed whenever it happens.
+ */
+#ifndef GILLESPY2_NATIVE_PROFILE_H
+#define GILLESPY2_NATIVE_PROFILE_H
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace gillespy2 {
+
+const int64_t PROFILE_SAMPLE_INTERVAL = 64;
+
+// Phases of an engine step. Selection decides what happens next (the
+// waiting time and the reaction to fire, or the size of a leap), update
+// carries it out (firing, leaping, integrating and updating the
+// propensities), and recording copies the state into the output.
+enum ProfilePhase { PHASE_SELECT, PHASE_UPDATE, PHASE_RECORD, NUM_PHASES };
+
+// Seconds on a monotonic clock.
+inline double profile_clock()
+{
+    return std::chrono::duration<double>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+struct Profile {
+    explicit Profile(int64_t num_reactions)
+        : firings(num_reactions, 0.0), events(0), leaps(0),
+          rejected_leaps(0), ssa_bursts(0), propensity_evaluations(0),
+          steps(0), timed_steps(0)
+    {
+        for (int p = 0; p < NUM_PHASES; ++p) {
+            seconds[p] = 0.0;
+        }
+    }
+
+    void merge(const Profile &other)
+    {
+        for (size_t r = 0; r < firings.size(); ++r) {
+            firings[r] += other.firings[r];
+        }
+        events += other.events;
+        leaps += other.leaps;
+        rejected_leaps += other.rejected_leaps;
+        ssa_bursts += other.ssa_bursts;
+        propensity_evaluations += other.propensity_evaluations;
+        steps += other.steps;
+        timed_steps += other.timed_steps;
+        for (int p = 0; p < NUM_PHASES; ++p) {
+            seconds[p] += other.seconds[p];
+        }
+    }
+
+    // Estimated seconds spent in phase p: measured for PHASE_RECORD, and
+    // scaled from the timed steps to all of them for the others.
+    double phase_seconds(int p) const
+    {
+        if (p == PHASE_RECORD) {
+            return seconds[p];
+        }
+        return timed_steps > 0 ? seconds[p] * steps / timed_steps : 0.0;
+    }
+
+    // Firings of every reaction: real-valued for the Langevin engine, and
+    // only the exact ones for the hybrid engine.
+    std::vector<double> firings;
+    // Reactions fired one at a time.
+    int64_t events;
+    // Accepted tau-leaps, Langevin steps and integration steps of the
+    // hybrid engine, and rejected ones.
+    int64_t leaps;
+    int64_t rejected_leaps;
+    // Bursts of exact steps taken instead of too short leaps.
+    int64_t ssa_bursts;
+    int64_t propensity_evaluations;
+    // Steps seen by StepTimer, and the timed ones among them.
+    int64_t steps;
+    int64_t timed_steps;
+    double seconds[NUM_PHASES];
+};
+
+// Times the phases of the steps of an engine into a Profile, which may be
+// NULL. A step starts with begin_step() in PHASE_SELECT and moves through
+// phases with phase(); output recording is bracketed by begin_record()
+// and end_record() wherever it happens, and is left out of the phase it
+// interrupts.
+class StepTimer {
+public:
+    explicit StepTimer(Profile *profile)
+        : profile_(profile), countdown_(1), timed_(false), phase_(0),
+          last_(0.0), record_start_(0.0)
+    {
+    }
+
+    Profile *profile() const { return profile_; }
+
+    void begin_step()
+    {
+        if (profile_ == NULL) {
+            return;
+        }
+        close_phase();
+        ++profile_->steps;
+        timed_ = --countdown_ == 0;
+        if (timed_) {
+            countdown_ = PROFILE_SAMPLE_INTERVAL;
+            ++profile_->timed_steps;
+            phase_ = PHASE_SELECT;
+            last_ = profile_clock();
+        }
+    }
+
+    void phase(int phase)
+    {
+        if (timed_) {
+            const double now = profile_clock();
+            profile_->seconds[phase_] += now - last_;
+            phase_ = phase;
+            last_ = now;
+        }
+    }
+
+    void begin_record()
+    {
+        if (profile_ != NULL) {
+            record_start_ = profile_clock();
+            if (timed_) {
+                profile_->seconds[phase_] += record_start_ - last_;
+            }
+        }
+    }
+
+    void end_record()
+    {
+        if (profile_ != NULL) {
+            const double now = profile_clock();
+            profile_->seconds[PHASE_RECORD] += now - record_start_;
+            last_ = now;
+        }
+    }
+
+    // Ends the timed step, if any; begin_step() does so as well.
+    void close_phase()
+    {
+        if (timed_) {
+            profile_->seconds[phase_] += profile_clock() - last_;
+            timed_ = false;
+        }
+    }
+
+private:
+    Profile *profile_;
+    int64_t countdown_;
+    bool timed_;
+    int phase_;
+    double last_;
+    double record_start_;
+
+    StepTimer(const StepTimer &);
+    StepTimer &operator=(const StepTimer &);
+};
+
+} // namespace gillespy2
+
+#endif
@@ -0,0 +1,249 @@
+/*
+ * Evaluation of compiled propensity functions.
+ *
+ * Mass-action propensities are evaluated by a specialized kernel. All other
+ * ("customized") propensities are compiled once per model by
+ * gillespy2/propensity_compiler.py into a small stack machine program,
+ * which is interpreted here. The opcodes below must be kept in sync with
+ * the OP_* constants of propensity_compiler.py.
+ */
+#ifndef GILLESPY2_NATIVE_PROPENSITY_H
+#define GILLESPY2_NATIVE_PROPENSITY_H
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "device.h"
+#include "model.h"
+
+namespace gillespy2 {
+
+enum Opcode {
+    OP_CONSTANT = 0,   // push program_constants[operand]
+    OP_SPECIES = 1,    // push x[operand]
+    OP_PARAMETER = 2,  // push parameter_values[operand]
+    OP_VOLUME = 3,     // push volume
+    OP_ADD = 4,
+    OP_SUBTRACT = 5,
+    OP_MULTIPLY = 6,
+    OP_DIVIDE = 7,
+    OP_POWER = 8,
+    OP_MODULO = 9,
+    OP_NEGATE = 10,
+    OP_LESS = 11,
+    OP_LESS_EQUAL = 12,
+    OP_GREATER = 13,
+    OP_GREATER_EQUAL = 14,
+    OP_EQUAL = 15,
+    OP_NOT_EQUAL = 16,
+    OP_SELECT = 17,    // pop else, then, cond; push cond ? then : else
+    OP_CALL1 = 18,     // apply unary function number operand
+    OP_CALL2 = 19,     // apply binary function number operand
+    NUM_OPCODES = 20
+};
+
+enum UnaryFunction {
+    FN_ABS = 0,
+    FN_EXP = 1,
+    FN_LOG = 2,
+    FN_LOG10 = 3,
+    FN_SQRT = 4,
+    FN_SIN = 5,
+    FN_COS = 6,
+    FN_TAN = 7,
+    FN_FLOOR = 8,
+    FN_CEIL = 9,
+    NUM_UNARY_FUNCTIONS = 10
+};
+
+enum BinaryFunction {
+    FN_POW = 0,
+    FN_MIN = 1,
+    FN_MAX = 2,
+    NUM_BINARY_FUNCTIONS = 3
+};
+
+// Number of values popped from the stack by opcode. Every opcode pushes
+// exactly one value.
+inline int stack_inputs(int64_t opcode)
+{
+    switch (opcode) {
+    case OP_CONSTANT:
+    case OP_SPECIES:
+    case OP_PARAMETER:
+    case OP_VOLUME:
+        return 0;
+    case OP_NEGATE:
+    case OP_CALL1:
+        return 1;
+    case OP_SELECT:
+        return 3;
+    default:
+        return 2;
+    }
+}
+
+GILLESPY2_HOST_DEVICE
+inline double apply_unary(int64_t function, double a)
+{
+    switch (function) {
+    case FN_ABS: return std::fabs(a);
+    case FN_EXP: return std::exp(a);
+    case FN_LOG: return std::log(a);
+    case FN_LOG10: return std::log10(a);
+    case FN_SQRT: return std::sqrt(a);
+    case FN_SIN: return std::sin(a);
+    case FN_COS: return std::cos(a);
+    case FN_TAN: return std::tan(a);
+    case FN_FLOOR: return std::floor(a);
+    default: return std::ceil(a);
+    }
+}
+
+GILLESPY2_HOST_DEVICE
+inline double apply_binary(int64_t function, double a, double b)
+{
+    switch (function) {
+    case FN_POW: return std::pow(a, b);
+    case FN_MIN: return a < b ? a : b;
+    default: return a > b ? a : b;
+    }
+}
+
+// Runs the program of a customized propensity, program_code[2 * begin ..
+// 2 * end), in state x, on stack, which holds model.max_stack_depth + 1
+// values.
+GILLESPY2_HOST_DEVICE
+inline double run_program(const ModelView &model, int64_t begin, int64_t end,
+                          const double *x, double *stack)
+{
+    int64_t top = -1;
+    for (int64_t pc = 2 * begin; pc < 2 * end; pc += 2) {
+        const int64_t operand = model.program_code[pc + 1];
+        switch (model.program_code[pc]) {
+        case OP_CONSTANT:
+            stack[++top] = model.program_constants[operand];
+            break;
+        case OP_SPECIES:
+            stack[++top] = x[operand];
+            break;
+        case OP_PARAMETER:
+            stack[++top] = model.parameter_values[operand];
+            break;
+        case OP_VOLUME:
+            stack[++top] = model.volume;
+            break;
+        case OP_ADD:
+            --top;
+            stack[top] += stack[top + 1];
+            break;
+        case OP_SUBTRACT:
+            --top;
+            stack[top] -= stack[top + 1];
+            break;
+        case OP_MULTIPLY:
+            --top;
+            stack[top] *= stack[top + 1];
+            break;
+        case OP_DIVIDE:
+            --top;
+            stack[top] /= stack[top + 1];
+            break;
+        case OP_POWER:
+            --top;
+            stack[top] = std::pow(stack[top], stack[top + 1]);
+            break;
+        case OP_MODULO:
+            // Python semantics: the result takes the sign of the divisor.
+            --top;
+            stack[top] -= std::floor(stack[top] / stack[top + 1]) *
+                          stack[top + 1];
+            break;
+        case OP_NEGATE:
+            stack[top] = -stack[top];
+            break;
+        case OP_LESS:
+            --top;
+            stack[top] = stack[top] < stack[top + 1];
+            break;
+        case OP_LESS_EQUAL:
+            --top;
+            stack[top] = stack[top] <= stack[top + 1];
+            break;
+        case OP_GREATER:
+            --top;
+            stack[top] = stack[top] > stack[top + 1];
+            break;
+        case OP_GREATER_EQUAL:
+            --top;
+            stack[top] = stack[top] >= stack[top + 1];
+            break;
+        case OP_EQUAL:
+            --top;
+            stack[top] = stack[top] == stack[top + 1];
+            break;
+        case OP_NOT_EQUAL:
+            --top;
+            stack[top] = stack[top] != stack[top + 1];
+            break;
+        case OP_SELECT:
+            top -= 2;
+            stack[top] = stack[top] != 0.0 ? stack[top + 1]
+                                           : stack[top + 2];
+            break;
+        case OP_CALL1:
+            stack[top] = apply_unary(operand, stack[top]);
+            break;
+        case OP_CALL2:
+            --top;
+            stack[top] = apply_binary(operand, stack[top],
+                                      stack[top + 1]);
+            break;
+        }
+    }
+    return stack[0];
+}
+
+// Propensity of reaction r in state x, with stack as for run_program().
+// Negative and NaN results are clamped to zero.
+GILLESPY2_HOST_DEVICE
+inline double propensity(const ModelView &model, int64_t r, const double *x,
+                         double *stack)
+{
+    const int64_t begin = model.program_indptr[r];
+    const int64_t end = model.program_indptr[r + 1];
+    const double a = begin == end ? mass_action_propensity(model, r, x)
+                                  : run_program(model, begin, end, x, stack);
+    return a > 0.0 ? a : 0.0;
+}
+
+// Evaluates propensities of a model, and counts the evaluations. Holds
+// the scratch stack of the program interpreter, so every thread needs its
+// own instance.
+class Propensities {
+public:
+    explicit Propensities(const ModelView &model)
+        : model_(model), stack_(model.max_stack_depth + 1), evaluations_(0)
+    {
+    }
+
+    // Propensity of reaction r in state x. Negative and NaN results are
+    // clamped to zero.
+    double operator()(int64_t r, const double *x)
+    {
+        ++evaluations_;
+        return propensity(model_, r, x, stack_.data());
+    }
+
+    int64_t evaluations() const { return evaluations_; }
+
+private:
+    const ModelView &model_;
+    std::vector<double> stack_;
+    int64_t evaluations_;
+};
+
+} // namespace gillespy2
+
+#endif
@@ -0,0 +1,209 @@
+/*
+ * Random number generation for the native engines.
+ *
+ * Every trajectory draws from its own stream of the counter-based Philox
+ * 4x32-10 generator (Salmon et al., "Parallel random numbers: as easy as
+ * 1, 2, 3", SC 2011). The stream is keyed by the ensemble seed, and the
+ * trajectory index is part of the counter, so trajectory i of an ensemble
+ * is the same whichever thread or process simulates it and in whatever
+ * order. Variates are derived with portable arithmetic only, not with the
+ * implementation-defined <random> distributions.
+ */
+#ifndef GILLESPY2_NATIVE_RANDOM_H
+#define GILLESPY2_NATIVE_RANDOM_H
+
+#include <cmath>
+#include <cstdint>
+
+#include "device.h"
+
+namespace gillespy2 {
+
+// Philox 4x32 with 10 rounds: maps a 128-bit counter and a 64-bit key to
+// 128 random bits.
+GILLESPY2_HOST_DEVICE
+inline void philox4x32(const uint32_t counter[4], const uint32_t key[2],
+                       uint32_t out[4])
+{
+    const uint64_t M0 = 0xD2511F53u, M1 = 0xCD9E8D57u;
+    const uint32_t W0 = 0x9E3779B9u, W1 = 0xBB67AE85u;
+    uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2],
+             c3 = counter[3];
+    uint32_t k0 = key[0], k1 = key[1];
+    for (int round = 0; round < 10; ++round) {
+        const uint64_t p0 = M0 * c0;
+        const uint64_t p1 = M1 * c2;
+        const uint32_t hi0 = static_cast<uint32_t>(p0 >> 32);
+        const uint32_t hi1 = static_cast<uint32_t>(p1 >> 32);
+        c0 = hi1 ^ c1 ^ k0;
+        c1 = static_cast<uint32_t>(p1);
+        c2 = hi0 ^ c3 ^ k1;
+        c3 = static_cast<uint32_t>(p0);
+        k0 += W0;
+        k1 += W1;
+    }
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+class Random {
+public:
+    // The stream of trajectory number trajectory of an ensemble.
+    GILLESPY2_HOST_DEVICE
+    Random(uint64_t seed, uint64_t trajectory)
+        : block_(0), next_word_(4), spare_normal_(0.0),
+          has_spare_normal_(false)
+    {
+        key_[0] = static_cast<uint32_t>(seed);
+        key_[1] = static_cast<uint32_t>(seed >> 32);
+        trajectory_[0] = static_cast<uint32_t>(trajectory);
+        trajectory_[1] = static_cast<uint32_t>(trajectory >> 32);
+    }
+
+    // Uniform variate in [0, 1) with 53 random bits.
+    GILLESPY2_HOST_DEVICE
+    double uniform()
+    {
+        const uint64_t high = next_word();
+        const uint64_t bits = (high << 32 | next_word()) >> 11;
+        return bits * (1.0 / 9007199254740992.0);
+    }
+
+    // Exponential variate with the given rate, which must be positive.
+    GILLESPY2_HOST_DEVICE
+    double exponential(double rate)
+    {
+        return -std::log(1.0 - uniform()) / rate;
+    }
+
+    // Standard normal variate, by the Box-Muller transform; every other call
+    // returns the second variate of the previous pair.
+    GILLESPY2_HOST_DEVICE
+    double normal()
+    {
+        if (has_spare_normal_) {
+            has_spare_normal_ = false;
+            return spare_normal_;
+        }
+        const double radius = std::sqrt(-2.0 * std::log(1.0 - uniform()));
+        const double angle = 6.283185307179586 * uniform();
+        spare_normal_ = radius * std::sin(angle);
+        has_spare_normal_ = true;
+        return radius * std::cos(angle);
+    }
+
+    // Poisson variate with the given mean; 0 if the mean is not positive.
+    GILLESPY2_HOST_DEVICE
+    int64_t poisson(double mean)
+    {
+        if (!(mean > 0.0)) {
+            return 0;
+        }
+        if (mean < 10.0) {
+            return poisson_inversion(mean);
+        }
+        return poisson_ptrs(mean);
+    }
+
+    // Batch versions of uniform(), normal() and poisson(), drawing the same
+    // values as n single calls.
+    GILLESPY2_HOST_DEVICE
+    void uniforms(int64_t n, double *out)
+    {
+        for (int64_t i = 0; i < n; ++i) {
+            out[i] = uniform();
+        }
+    }
+
+    GILLESPY2_HOST_DEVICE
+    void normals(int64_t n, double *out)
+    {
+        for (int64_t i = 0; i < n; ++i) {
+            out[i] = normal();
+        }
+    }
+
+    GILLESPY2_HOST_DEVICE
+    void poissons(int64_t n, const double *means, int64_t *out)
+    {
+        for (int64_t i = 0; i < n; ++i) {
+            out[i] = poisson(means[i]);
+        }
+    }
+
+private:
+    GILLESPY2_HOST_DEVICE
+    uint32_t next_word()
+    {
+        if (next_word_ == 4) {
+            const uint32_t counter[4] = {
+                static_cast<uint32_t>(block_),
+                static_cast<uint32_t>(block_ >> 32), trajectory_[0],
+                trajectory_[1]};
+            philox4x32(counter, key_, words_);
+            ++block_;
+            next_word_ = 0;
+        }
+        return words_[next_word_++];
+    }
+
+    // Sequential search of the cumulative distribution, for small means.
+    GILLESPY2_HOST_DEVICE
+    int64_t poisson_inversion(double mean)
+    {
+        double p = std::exp(-mean);
+        double cumulative = p;
+        const double u = uniform();
+        int64_t k = 0;
+        // The tail beyond 1000 is far below double precision for mean < 10.
+        while (u > cumulative && k < 1000) {
+            ++k;
+            p *= mean / k;
+            cumulative += p;
+        }
+        return k;
+    }
+
+    // Hormann's transformed rejection with squeeze (PTRS), for mean >= 10.
+    GILLESPY2_HOST_DEVICE
+    int64_t poisson_ptrs(double mean)
+    {
+        const double log_mean = std::log(mean);
+        const double b = 0.931 + 2.53 * std::sqrt(mean);
+        const double a = -0.059 + 0.02483 * b;
+        const double inv_alpha = 1.1239 + 1.1328 / (b - 3.4);
+        const double v_r = 0.9277 - 3.6224 / (b - 2.0);
+        for (;;) {
+            const double u = uniform() - 0.5;
+            const double v = uniform();
+            const double us = 0.5 - std::fabs(u);
+            const double k =
+                std::floor((2.0 * a / us + b) * u + mean + 0.43);
+            if (us >= 0.07 && v <= v_r) {
+                return static_cast<int64_t>(k);
+            }
+            if (k < 0.0 || (us < 0.013 && v > us)) {
+                continue;
+            }
+            if (std::log(v) + std::log(inv_alpha) -
+                    std::log(a / (us * us) + b) <=
+                -mean + k * log_mean - std::lgamma(k + 1.0)) {
+                return static_cast<int64_t>(k);
+            }
+        }
+    }
+
+    uint32_t key_[2];
+    uint32_t trajectory_[2];
+    uint64_t block_;
+    uint32_t words_[4];
+    int next_word_;
+    double spare_normal_;
+    bool has_spare_normal_;
+};
+
+} // namespace gillespy2
+
+#endif
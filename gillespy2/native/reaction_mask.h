@@ -0,0 +1,38 @@
+/*
+ * Bit sets over the reactions of a model.
+ */
+#ifndef GILLESPY2_NATIVE_REACTION_MASK_H
+#define GILLESPY2_NATIVE_REACTION_MASK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace gillespy2 {
+
+// Set of reactions, one bit each.
+class ReactionMask {
+public:
+    explicit ReactionMask(int64_t num_reactions)
+        : words_((num_reactions + 63) / 64)
+    {
+    }
+
+    void clear()
+    {
+        for (size_t w = 0; w < words_.size(); ++w) {
+            words_[w] = 0;
+        }
+    }
+
+    void set(int64_t r) { words_[r >> 6] |= uint64_t(1) << (r & 63); }
+
+    bool test(int64_t r) const { return (words_[r >> 6] >> (r & 63)) & 1; }
+
+private:
+    std::vector<uint64_t> words_;
+};
+
+} // namespace gillespy2
+
+#endif
@@ -0,0 +1,266 @@
+/*
+ * Reaction selection structures for the direct method.
+ *
+ * Each selector holds the current propensity of every reaction and picks
+ * a reaction with probability proportional to its propensity:
+ *
+ *   LinearSelector                 O(M) selection, O(1) update
+ *   SumTreeSelector                O(log M) selection and update
+ *   CompositionRejectionSelector   O(1) expected selection and update
+ *                                  (Slepoy, Thompson and Plimpton 2008)
+ */
+#ifndef GILLESPY2_NATIVE_SELECTION_H
+#define GILLESPY2_NATIVE_SELECTION_H
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "random.h"
+
+namespace gillespy2 {
+
+class LinearSelector {
+public:
+    explicit LinearSelector(int64_t num_reactions)
+        : propensity_(num_reactions, 0.0)
+    {
+    }
+
+    void update(int64_t r, double a) { propensity_[r] = a; }
+
+    // Summed from scratch, so rounding errors cannot accumulate.
+    double total() const
+    {
+        double sum = 0.0;
+        for (size_t r = 0; r < propensity_.size(); ++r) {
+            sum += propensity_[r];
+        }
+        return sum;
+    }
+
+    // Picks a reaction given the current total() propensity.
+    int64_t select(double total, Random &random) const
+    {
+        const double target = random.uniform() * total;
+        double cumulative_sum = 0.0;
+        int64_t last = 0;
+        for (size_t r = 0; r < propensity_.size(); ++r) {
+            if (propensity_[r] > 0.0) {
+                cumulative_sum += propensity_[r];
+                last = static_cast<int64_t>(r);
+                if (cumulative_sum > target) {
+                    break;
+                }
+            }
+        }
+        return last;
+    }
+
+private:
+    std::vector<double> propensity_;
+};
+
+// Complete binary tree whose leaves are the propensities and whose inner
+// nodes hold the sum of their children. Inner nodes are recomputed rather
+// than adjusted on update, so the sums never drift.
+class SumTreeSelector {
+public:
+    explicit SumTreeSelector(int64_t num_reactions) : leaves_(1)
+    {
+        while (leaves_ < static_cast<size_t>(num_reactions)) {
+            leaves_ *= 2;
+        }
+        tree_.assign(2 * leaves_, 0.0);
+    }
+
+    void update(int64_t r, double a)
+    {
+        size_t node = leaves_ + static_cast<size_t>(r);
+        tree_[node] = a;
+        for (node /= 2; node > 0; node /= 2) {
+            tree_[node] = tree_[2 * node] + tree_[2 * node + 1];
+        }
+    }
+
+    double total() const { return tree_[1]; }
+
+    int64_t select(double total, Random &random) const
+    {
+        double target = random.uniform() * total;
+        size_t node = 1;
+        while (node < leaves_) {
+            const double left = tree_[2 * node];
+            // Rounding may point past the last non-empty subtree.
+            if (target < left || tree_[2 * node + 1] <= 0.0) {
+                node = 2 * node;
+            } else {
+                target -= left;
+                node = 2 * node + 1;
+            }
+        }
+        return static_cast<int64_t>(node - leaves_);
+    }
+
+private:
+    size_t leaves_;
+    std::vector<double> tree_;
+};
+
+// Reactions are grouped by the binary exponent of their propensity, so
+// all members of a group are within a factor of two of the group bound
+// 2^exponent. A group is chosen by a linear scan over the (few) groups in
+// use, and a member by rejection sampling against the bound, which
+// accepts with probability at least 1/2.
+class CompositionRejectionSelector {
+public:
+    explicit CompositionRejectionSelector(int64_t num_reactions)
+        : propensity_(num_reactions, 0.0),
+          group_of_(num_reactions, -1),
+          slot_(num_reactions, 0),
+          groups_(NUM_GROUPS),
+          group_sum_(NUM_GROUPS, 0.0),
+          min_group_(NUM_GROUPS),
+          max_group_(-1),
+          updates_(0)
+    {
+    }
+
+    void update(int64_t r, double a)
+    {
+        const int old_group = group_of_[r];
+        const int new_group = a > 0.0 ? group_index(a) : -1;
+        if (old_group >= 0) {
+            group_sum_[old_group] -= propensity_[r];
+        }
+        if (old_group != new_group) {
+            if (old_group >= 0) {
+                remove(r, old_group);
+            }
+            if (new_group >= 0) {
+                insert(r, new_group);
+            }
+        }
+        propensity_[r] = a;
+        if (new_group >= 0) {
+            group_sum_[new_group] += a;
+        }
+        // Incrementally updated sums drift; refresh them periodically at
+        // an amortized cost of O(1) per update.
+        if (++updates_ >= propensity_.size()) {
+            refresh_sums();
+        }
+    }
+
+    double total() const
+    {
+        double sum = 0.0;
+        for (int g = min_group_; g <= max_group_; ++g) {
+            sum += group_sum_[g];
+        }
+        return sum;
+    }
+
+    int64_t select(double total, Random &random) const
+    {
+        // Composition: pick a group, scanning the largest propensities
+        // first so the scan usually ends early.
+        const double target = random.uniform() * total;
+        double cumulative_sum = 0.0;
+        int group = -1;
+        for (int g = max_group_; g >= min_group_; --g) {
+            if (!groups_[g].empty()) {
+                group = g;
+                cumulative_sum += group_sum_[g];
+                if (cumulative_sum > target) {
+                    break;
+                }
+            }
+        }
+
+        // Rejection: pick a member uniformly, accept with probability
+        // propensity / bound.
+        const std::vector<int64_t> &members = groups_[group];
+        const double bound = std::ldexp(1.0, group - EXPONENT_OFFSET);
+        for (;;) {
+            const double u = random.uniform() * members.size();
+            const size_t k = static_cast<size_t>(u);
+            const int64_t r = members[k < members.size() ? k : 0];
+            if ((u - k) * bound < propensity_[r]) {
+                return r;
+            }
+        }
+    }
+
+private:
+    // frexp exponents of positive doubles lie in [-1073, 1024].
+    static const int EXPONENT_OFFSET = 1074;
+    static const int NUM_GROUPS = 2100;
+
+    static int group_index(double a)
+    {
+        int exponent;
+        std::frexp(a, &exponent);
+        return exponent + EXPONENT_OFFSET;
+    }
+
+    void insert(int64_t r, int g)
+    {
+        group_of_[r] = g;
+        slot_[r] = groups_[g].size();
+        groups_[g].push_back(r);
+        if (g < min_group_) {
+            min_group_ = g;
+        }
+        if (g > max_group_) {
+            max_group_ = g;
+        }
+    }
+
+    void remove(int64_t r, int g)
+    {
+        std::vector<int64_t> &members = groups_[g];
+        const int64_t last = members.back();
+        members[slot_[r]] = last;
+        slot_[last] = slot_[r];
+        members.pop_back();
+        group_of_[r] = -1;
+        if (members.empty()) {
+            group_sum_[g] = 0.0;
+            while (max_group_ >= 0 && groups_[max_group_].empty()) {
+                --max_group_;
+            }
+            while (min_group_ < NUM_GROUPS && groups_[min_group_].empty()) {
+                ++min_group_;
+            }
+            if (max_group_ < 0) {
+                min_group_ = NUM_GROUPS;
+            }
+        }
+    }
+
+    void refresh_sums()
+    {
+        updates_ = 0;
+        for (int g = min_group_; g <= max_group_; ++g) {
+            double sum = 0.0;
+            for (size_t k = 0; k < groups_[g].size(); ++k) {
+                sum += propensity_[groups_[g][k]];
+            }
+            group_sum_[g] = sum;
+        }
+    }
+
+    std::vector<double> propensity_;
+    std::vector<int> group_of_;
+    std::vector<size_t> slot_;
+    std::vector<std::vector<int64_t> > groups_;
+    std::vector<double> group_sum_;
+    int min_group_;
+    int max_group_;
+    size_t updates_;
+};
+
+} // namespace gillespy2
+
+#endif
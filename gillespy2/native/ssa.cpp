@@ -0,0 +1,85 @@
+#include "ssa.h"
+
+#include <vector>
+
+#include "propensity.h"
+#include "random.h"
+#include "selection.h"
+
+namespace gillespy2 {
+
+namespace {
+
+template <class Selector>
+void direct_method(const ModelView &model, const Timeline &timeline,
+                   Random &random, double *out, Profile *profile)
+{
+    std::vector<double> x(model.initial_state,
+                          model.initial_state + model.num_species);
+    Selector selector(model.num_reactions);
+    Propensities propensities(model);
+    StepTimer timer(profile);
+
+    for (int64_t r = 0; r < model.num_reactions; ++r) {
+        selector.update(r, propensities(r, x.data()));
+    }
+
+    double t = 0.0;
+    int64_t next_output = 0;
+
+    while (next_output < timeline.num_times) {
+        timer.begin_step();
+        const double propensity_sum = selector.total();
+
+        // Nothing can fire anymore, the state is final.
+        if (propensity_sum <= 0.0) {
+            break;
+        }
+
+        t += random.exponential(propensity_sum);
+
+        // The current state holds until the next firing time.
+        record_before(model, timeline, x.data(), t, next_output, out, timer);
+        if (next_output == timeline.num_times) {
+            break;
+        }
+
+        const int64_t reaction = selector.select(propensity_sum, random);
+        timer.phase(PHASE_UPDATE);
+        fire_reaction(model, reaction, x.data());
+        for (int64_t k = model.dependency_indptr[reaction];
+             k < model.dependency_indptr[reaction + 1]; ++k) {
+            const int64_t r = model.dependency_indices[k];
+            selector.update(r, propensities(r, x.data()));
+        }
+        if (profile != NULL) {
+            profile->firings[reaction] += 1.0;
+            ++profile->events;
+        }
+    }
+    timer.close_phase();
+
+    record_rest(model, timeline, x.data(), next_output, out, timer);
+    if (profile != NULL) {
+        profile->propensity_evaluations += propensities.evaluations();
+    }
+}
+
+} // namespace
+
+void ssa_direct(const ModelView &model, const Timeline &timeline,
+                const EngineOptions &, Random &random, double *out,
+                Profile *profile)
+{
+    if (model.num_reactions >= COMPOSITION_REJECTION_MIN_REACTIONS) {
+        direct_method<CompositionRejectionSelector>(model, timeline, random,
+                                                    out, profile);
+    } else if (model.num_reactions >= SUM_TREE_MIN_REACTIONS) {
+        direct_method<SumTreeSelector>(model, timeline, random, out,
+                                       profile);
+    } else {
+        direct_method<LinearSelector>(model, timeline, random, out, profile);
+    }
+}
+
+} // namespace gillespy2
@@ -0,0 +1,192 @@
+/*
+ * Stochastic simulation engines, one trajectory per call.
+ */
+#ifndef GILLESPY2_NATIVE_SSA_H
+#define GILLESPY2_NATIVE_SSA_H
+
+#include <cstdint>
+
+#include "model.h"
+#include "profile.h"
+#include "random.h"
+
+namespace gillespy2 {
+
+// Output timepoints of a simulation, in non-decreasing order, and the
+// indices of the species recorded at them.
+struct Timeline {
+    const double *times;
+    int64_t num_times;
+    const int64_t *species;
+    int64_t num_species;
+};
+
+// Copies the recorded species of the state x into output row k of a
+// trajectory.
+inline void record_state(const ModelView &, const Timeline &timeline,
+                         const double *x, int64_t k, double *out)
+{
+    double *row = out + k * (timeline.num_species + 1);
+    row[0] = timeline.times[k];
+    for (int64_t s = 0; s < timeline.num_species; ++s) {
+        row[s + 1] = x[timeline.species[s]];
+    }
+}
+
+// Records the state x at the outputs from next_output on that come before
+// time t, advancing next_output, and times the recording with timer.
+inline void record_before(const ModelView &model, const Timeline &timeline,
+                          const double *x, double t, int64_t &next_output,
+                          double *out, StepTimer &timer)
+{
+    if (next_output == timeline.num_times ||
+        !(timeline.times[next_output] < t)) {
+        return;
+    }
+    timer.begin_record();
+    while (next_output < timeline.num_times &&
+           timeline.times[next_output] < t) {
+        record_state(model, timeline, x, next_output++, out);
+    }
+    timer.end_record();
+}
+
+// Same as record_before(), for the outputs at or before time t.
+inline void record_reached(const ModelView &model, const Timeline &timeline,
+                           const double *x, double t, int64_t &next_output,
+                           double *out, StepTimer &timer)
+{
+    if (next_output == timeline.num_times ||
+        !(timeline.times[next_output] <= t)) {
+        return;
+    }
+    timer.begin_record();
+    while (next_output < timeline.num_times &&
+           timeline.times[next_output] <= t) {
+        record_state(model, timeline, x, next_output++, out);
+    }
+    timer.end_record();
+}
+
+// Records the final state x at all remaining outputs.
+inline void record_rest(const ModelView &model, const Timeline &timeline,
+                        const double *x, int64_t &next_output, double *out,
+                        StepTimer &timer)
+{
+    if (next_output == timeline.num_times) {
+        return;
+    }
+    timer.begin_record();
+    while (next_output < timeline.num_times) {
+        record_state(model, timeline, x, next_output++, out);
+    }
+    timer.end_record();
+}
+
+// Tuning parameters of the approximate engines. The exact engines ignore
+// them.
+struct EngineOptions {
+    // Bound on the relative change of the propensities in one leap.
+    double epsilon;
+    // Reactions that can fire fewer times than this before exhausting a
+    // reactant are critical and are fired one event at a time.
+    int64_t critical_threshold;
+    // When the leap size falls below ssa_threshold / a0, where a0 is the
+    // total propensity, a burst of ssa_steps exact steps is cheaper and is
+    // run instead. 0 disables the switch.
+    double ssa_threshold;
+    int64_t ssa_steps;
+    // A reaction is integrated continuously by the hybrid engine when it
+    // fires at least fast_events times per integration step and every
+    // dynamic species it changes has a population of at least
+    // continuous_population.
+    double fast_events;
+    double continuous_population;
+    // Fixed step of the Langevin engine; 0 lets epsilon select the steps.
+    double step_size;
+
+    EngineOptions()
+        : epsilon(0.03), critical_threshold(10), ssa_threshold(10.0),
+          ssa_steps(100), fast_events(10.0), continuous_population(100.0),
+          step_size(0.0)
+    {
+    }
+};
+
+// The engines below simulate one trajectory of the model, drawing from
+// random, and write it to out, which holds timeline.num_times rows of
+// (1 + model.num_species) values: the output time followed by the
+// population of every species at that time. Unless profile is NULL, they
+// add their counters and step times to it (see profile.h).
+
+// Gillespie's direct method. The reaction to fire is found by a linear
+// scan for small models, in a sum tree from SUM_TREE_MIN_REACTIONS
+// reactions on, and by composition-rejection sampling from
+// COMPOSITION_REJECTION_MIN_REACTIONS reactions on (see selection.h).
+const int64_t SUM_TREE_MIN_REACTIONS = 32;
+const int64_t COMPOSITION_REJECTION_MIN_REACTIONS = 1024;
+
+void ssa_direct(const ModelView &model, const Timeline &timeline,
+                const EngineOptions &options, Random &random, double *out,
+                Profile *profile);
+
+// Gibson and Bruck's next reaction method. Putative firing times are kept
+// in an indexed priority queue, and only the reactions marked by the
+// dependency graph are updated after each event.
+void ssa_next_reaction(const ModelView &model, const Timeline &timeline,
+                       const EngineOptions &options, Random &random,
+                       double *out, Profile *profile);
+
+// Explicit tau-leaping with the step size selection of Cao, Gillespie and
+// Petzold, "Efficient step size selection for the tau-leaping simulation
+// method", J. Chem. Phys. 124, 044109 (2006). The means and variances of
+// the population changes are products of the stoichiometry matrix with
+// the propensity vector, on a dense copy of the matrix for small models
+// (see stoichiometry.h) and on the sparse one otherwise. Leaps that would
+// make a population negative are rejected and retried with half the step
+// size. Leaps too short to pay off are replaced by bursts of exact direct
+// method steps. epsilon adapts to the rejection rate: after every
+// EPSILON_WINDOW leaps it is halved if more than a tenth of them were
+// rejected, down to options.epsilon / MAX_EPSILON_REDUCTION, and doubled
+// back towards options.epsilon if none were.
+const int64_t EPSILON_WINDOW = 20;
+const double MAX_EPSILON_REDUCTION = 64.0;
+
+void tau_leaping(const ModelView &model, const Timeline &timeline,
+                 const EngineOptions &options, Random &random, double *out,
+                 Profile *profile);
+
+// Hybrid simulation after Salis and Kaznessis, "Accurate hybrid stochastic
+// simulation of a system of coupled chemical or biochemical reactions",
+// J. Chem. Phys. 122, 054103 (2005). The reactions are partitioned anew
+// before every step: fast reactions on abundant species (see
+// EngineOptions) follow their rate equations, integrated by the classical
+// Runge-Kutta method with steps that change no population by more than a
+// fraction epsilon of the gross flux through it, while all other reactions
+// fire exactly. The next exact firing happens when the integral of their
+// total propensity reaches an exponential variate, located within the
+// step by interpolation. Steps of the partition without fast reactions
+// are exact direct method steps. Populations of continuously simulated
+// species are not rounded.
+void hybrid(const ModelView &model, const Timeline &timeline,
+            const EngineOptions &options, Random &random, double *out,
+            Profile *profile);
+
+// The chemical Langevin equation, Gillespie, J. Chem. Phys. 113, 297
+// (2000),
+//     dx = V a(x) dt + V diag(sqrt(a(x))) dW,
+// integrated by the Euler-Maruyama method. Each step draws one Gaussian
+// increment per reaction as a vector and applies the drift and the noise
+// in a single product with the stoichiometry matrix V (see
+// stoichiometry.h). Steps are options.step_size long, or, if that is 0,
+// chosen like tau-leaps so that the expected change and the standard
+// deviation of every population stay below epsilon times the population;
+// they end exactly on the output times. Populations are real-valued and
+// reflected at 0.
+void chemical_langevin(const ModelView &model, const Timeline &timeline,
+                       const EngineOptions &options, Random &random,
+                       double *out, Profile *profile);
+
+} // namespace gillespy2
+
+#endif
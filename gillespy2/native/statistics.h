@@ -0,0 +1,120 @@
+/*
+ * Running statistics of an ensemble, for simulations that do not keep
+ * their trajectories.
+ */
+#ifndef GILLESPY2_NATIVE_STATISTICS_H
+#define GILLESPY2_NATIVE_STATISTICS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace gillespy2 {
+
+// Trajectories are accumulated in blocks of this many ensemble members,
+// and the blocks are merged in ensemble order, so the statistics do not
+// depend on the number of threads.
+const int64_t STATISTICS_BLOCK = 64;
+
+// Mean, variance, minimum and maximum of every species at every output
+// time, and optionally a histogram of them over a fixed range per species,
+// updated one trajectory at a time in O(times x species) memory.
+class EnsembleStatistics {
+public:
+    // ranges holds (low, high) for every species; values outside are
+    // counted in the first or last of the bins.
+    EnsembleStatistics(int64_t num_times, int64_t num_species, int64_t bins,
+                       const double *ranges)
+        : num_values_(num_times * num_species), num_species_(num_species),
+          bins_(bins), ranges_(ranges), count_(0), mean_(num_values_, 0.0),
+          m2_(num_values_, 0.0),
+          min_(num_values_, std::numeric_limits<double>::infinity()),
+          max_(num_values_, -std::numeric_limits<double>::infinity()),
+          histogram_(num_values_ * bins, 0)
+    {
+    }
+
+    // Adds a trajectory in the layout of the engines (see ssa.h), by
+    // Welford's update.
+    void add(const double *trajectory)
+    {
+        ++count_;
+        const double weight = 1.0 / count_;
+        for (int64_t k = 0; k < num_values_; ++k) {
+            const int64_t row = k / num_species_;
+            const int64_t s = k - row * num_species_;
+            const double x = trajectory[row * (num_species_ + 1) + s + 1];
+            const double delta = x - mean_[k];
+            mean_[k] += delta * weight;
+            m2_[k] += delta * (x - mean_[k]);
+            min_[k] = std::min(min_[k], x);
+            max_[k] = std::max(max_[k], x);
+            if (bins_ > 0) {
+                histogram_[k * bins_ + bin(s, x)] += 1;
+            }
+        }
+    }
+
+    // Adds the trajectories of other, by the pairwise update of Chan,
+    // Golub and LeVeque (1979).
+    void merge(const EnsembleStatistics &other)
+    {
+        if (other.count_ == 0) {
+            return;
+        }
+        const double n = static_cast<double>(count_);
+        const double m = static_cast<double>(other.count_);
+        const double total = n + m;
+        for (int64_t k = 0; k < num_values_; ++k) {
+            const double delta = other.mean_[k] - mean_[k];
+            mean_[k] += delta * (m / total);
+            m2_[k] += other.m2_[k] + delta * delta * (n * m / total);
+            min_[k] = std::min(min_[k], other.min_[k]);
+            max_[k] = std::max(max_[k], other.max_[k]);
+        }
+        for (size_t k = 0; k < histogram_.size(); ++k) {
+            histogram_[k] += other.histogram_[k];
+        }
+        count_ += other.count_;
+    }
+
+    // Writes the mean, the sample variance (0 for a single trajectory), the
+    // minimum and the maximum as four consecutive times x species arrays
+    // to statistics, and the times x species x bins counts to histogram.
+    void write(double *statistics, int64_t *histogram) const
+    {
+        const double denominator = count_ > 1 ? count_ - 1.0 : 1.0;
+        for (int64_t k = 0; k < num_values_; ++k) {
+            statistics[k] = mean_[k];
+            statistics[num_values_ + k] = m2_[k] / denominator;
+            statistics[2 * num_values_ + k] = min_[k];
+            statistics[3 * num_values_ + k] = max_[k];
+        }
+        std::copy(histogram_.begin(), histogram_.end(), histogram);
+    }
+
+private:
+    int64_t bin(int64_t s, double x) const
+    {
+        const double low = ranges_[2 * s], high = ranges_[2 * s + 1];
+        const double position = std::floor((x - low) / (high - low) * bins_);
+        if (!(position >= 0.0)) {
+            return 0;
+        }
+        return position < bins_ ? static_cast<int64_t>(position) : bins_ - 1;
+    }
+
+    const int64_t num_values_;
+    const int64_t num_species_;
+    const int64_t bins_;
+    const double *ranges_;
+    int64_t count_;
+    std::vector<double> mean_, m2_, min_, max_;
+    std::vector<int64_t> histogram_;
+};
+
+} // namespace gillespy2
+
+#endif
@@ -0,0 +1,117 @@
+/*
+ * Products of the stoichiometry matrix with reaction vectors, for the
+ * approximate engines.
+ */
+#ifndef GILLESPY2_NATIVE_STOICHIOMETRY_H
+#define GILLESPY2_NATIVE_STOICHIOMETRY_H
+
+#include <cstdint>
+#include <vector>
+
+#include "model.h"
+
+namespace gillespy2 {
+
+// Models with up to this many species x reactions entries get dense copies
+// of the stoichiometry matrix.
+const int64_t DENSE_STOICHIOMETRY_MAX_ENTRIES = 1 << 16;
+
+// Products of the stoichiometry matrix V and of its elementwise square with
+// a propensity vector a: mu = V a and sigma2 = (V * V) a. Small models use
+// dense species-major copies of both matrices, so every entry of mu and
+// sigma2 is a contiguous dot product that the compiler vectorizes.
+class StoichiometryMoments {
+public:
+    explicit StoichiometryMoments(const ModelView &model)
+        : model_(model),
+          dense_(model.num_species * model.num_reactions <=
+                 DENSE_STOICHIOMETRY_MAX_ENTRIES)
+    {
+        if (!dense_) {
+            return;
+        }
+        const int64_t n = model.num_reactions;
+        v_.assign(model.num_species * n, 0.0);
+        v2_.assign(model.num_species * n, 0.0);
+        for (int64_t r = 0; r < n; ++r) {
+            for (int64_t k = model.stoich_indptr[r];
+                 k < model.stoich_indptr[r + 1]; ++k) {
+                const double v = model.stoich_values[k];
+                v_[model.stoich_indices[k] * n + r] = v;
+                v2_[model.stoich_indices[k] * n + r] = v * v;
+            }
+        }
+    }
+
+    // mu = V w, the expected population change for w = a tau.
+    void operator()(const double *w, double *mu) const
+    {
+        const int64_t n = model_.num_reactions;
+        if (dense_) {
+            for (int64_t i = 0; i < model_.num_species; ++i) {
+                const double *v = &v_[i * n];
+                double m = 0.0;
+                for (int64_t r = 0; r < n; ++r) {
+                    m += v[r] * w[r];
+                }
+                mu[i] = m;
+            }
+            return;
+        }
+        for (int64_t i = 0; i < model_.num_species; ++i) {
+            mu[i] = 0.0;
+        }
+        for (int64_t r = 0; r < n; ++r) {
+            if (w[r] == 0.0) {
+                continue;
+            }
+            for (int64_t k = model_.stoich_indptr[r];
+                 k < model_.stoich_indptr[r + 1]; ++k) {
+                mu[model_.stoich_indices[k]] += model_.stoich_values[k] * w[r];
+            }
+        }
+    }
+
+    void operator()(const double *a, double *mu, double *sigma2) const
+    {
+        const int64_t n = model_.num_reactions;
+        if (dense_) {
+            for (int64_t i = 0; i < model_.num_species; ++i) {
+                const double *v = &v_[i * n];
+                const double *v2 = &v2_[i * n];
+                double m = 0.0, s = 0.0;
+                for (int64_t r = 0; r < n; ++r) {
+                    m += v[r] * a[r];
+                    s += v2[r] * a[r];
+                }
+                mu[i] = m;
+                sigma2[i] = s;
+            }
+            return;
+        }
+        for (int64_t i = 0; i < model_.num_species; ++i) {
+            mu[i] = 0.0;
+            sigma2[i] = 0.0;
+        }
+        for (int64_t r = 0; r < n; ++r) {
+            if (a[r] == 0.0) {
+                continue;
+            }
+            for (int64_t k = model_.stoich_indptr[r];
+                 k < model_.stoich_indptr[r + 1]; ++k) {
+                const double v = model_.stoich_values[k];
+                mu[model_.stoich_indices[k]] += v * a[r];
+                sigma2[model_.stoich_indices[k]] += v * v * a[r];
+            }
+        }
+    }
+
+private:
+    const ModelView &model_;
+    const bool dense_;
+    std::vector<double> v_, v2_;
+};
+
+} // namespace gillespy2
+
+#endif
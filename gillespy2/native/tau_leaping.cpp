@@ -0,0 +1,243 @@
+#include "ssa.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "leaping.h"
+#include "propensity.h"
+#include "random.h"
+#include "reaction_mask.h"
+#include "selection.h"
+#include "stoichiometry.h"
+
+namespace gillespy2 {
+
+void ssa_burst(const ModelView &model, const Timeline &timeline,
+               int64_t steps, const double *propensity,
+               Propensities &propensities, SumTreeSelector &selector,
+               Random &random, double *x, double &t, int64_t &next_output,
+               double *out, StepTimer &timer)
+{
+    Profile *profile = timer.profile();
+    if (profile != NULL) {
+        ++profile->ssa_bursts;
+    }
+    for (int64_t r = 0; r < model.num_reactions; ++r) {
+        selector.update(r, propensity[r]);
+    }
+    for (int64_t step = 0; step < steps; ++step) {
+        const double propensity_sum = selector.total();
+        if (propensity_sum <= 0.0) {
+            return;
+        }
+        const double next = t + random.exponential(propensity_sum);
+        record_before(model, timeline, x, next, next_output, out, timer);
+        if (next_output == timeline.num_times) {
+            return;
+        }
+        const int64_t reaction = selector.select(propensity_sum, random);
+        fire_reaction(model, reaction, x);
+        for (int64_t k = model.dependency_indptr[reaction];
+             k < model.dependency_indptr[reaction + 1]; ++k) {
+            const int64_t r = model.dependency_indices[k];
+            selector.update(r, propensities(r, x));
+        }
+        if (profile != NULL) {
+            profile->firings[reaction] += 1.0;
+            ++profile->events;
+        }
+        t = next;
+    }
+}
+
+void take_leap(const ModelView &model, const Timeline &timeline,
+               double leap, const double *propensity,
+               const double *noncritical, const ReactionMask &critical,
+               double critical_sum, Random &random, AdaptiveEpsilon &epsilon,
+               LeapScratch &scratch, double *x, double &t,
+               int64_t next_output, Profile *profile)
+{
+    const double never = std::numeric_limits<double>::infinity();
+    const int64_t num_species = model.num_species;
+    const int64_t num_reactions = model.num_reactions;
+    const double until_output = timeline.times[next_output] - t;
+    for (;;) {
+        // At most one critical reaction fires during a leap, at an
+        // exponential waiting time.
+        const double critical_time =
+            critical_sum > 0.0 ? random.exponential(critical_sum) : never;
+        double tau = leap;
+        bool fire_critical = false;
+        if (critical_time <= leap) {
+            tau = critical_time;
+            fire_critical = true;
+        }
+        // The state must be recorded at the next output time; by
+        // memorylessness, the critical firing is then simply dropped.
+        const bool to_output = tau >= until_output;
+        if (to_output) {
+            tau = until_output;
+            fire_critical = false;
+        }
+
+        for (int64_t r = 0; r < num_reactions; ++r) {
+            scratch.means[r] = noncritical[r] * tau;
+        }
+        random.poissons(num_reactions, scratch.means.data(),
+                        scratch.firings.data());
+
+        std::copy(x, x + num_species, scratch.saved.begin());
+        for (int64_t r = 0; r < num_reactions; ++r) {
+            if (scratch.firings[r] == 0) {
+                continue;
+            }
+            const double n = static_cast<double>(scratch.firings[r]);
+            for (int64_t k = model.stoich_indptr[r];
+                 k < model.stoich_indptr[r + 1]; ++k) {
+                x[model.stoich_indices[k]] += n * model.stoich_values[k];
+            }
+        }
+        int64_t reaction = -1;
+        if (fire_critical) {
+            const double target = random.uniform() * critical_sum;
+            double cumulative = 0.0;
+            for (int64_t r = 0; r < num_reactions; ++r) {
+                if (critical.test(r)) {
+                    reaction = r;
+                    cumulative += propensity[r];
+                    if (target < cumulative) {
+                        break;
+                    }
+                }
+            }
+            fire_reaction(model, reaction, x);
+        }
+
+        bool negative = false;
+        for (int64_t i = 0; i < num_species; ++i) {
+            negative = negative || x[i] < 0.0;
+        }
+        epsilon.record(negative);
+        if (!negative) {
+            t = to_output ? timeline.times[next_output] : t + tau;
+            if (profile != NULL) {
+                ++profile->leaps;
+                for (int64_t r = 0; r < num_reactions; ++r) {
+                    profile->firings[r] +=
+                        static_cast<double>(scratch.firings[r]);
+                }
+                if (reaction >= 0) {
+                    profile->firings[reaction] += 1.0;
+                    ++profile->events;
+                }
+            }
+            return;
+        }
+        if (profile != NULL) {
+            ++profile->rejected_leaps;
+        }
+        std::copy(scratch.saved.begin(), scratch.saved.end(), x);
+        leap *= 0.5;
+    }
+}
+
+void tau_leaping(const ModelView &model, const Timeline &timeline,
+                 const EngineOptions &options, Random &random, double *out,
+                 Profile *profile)
+{
+    const double never = std::numeric_limits<double>::infinity();
+    const int64_t num_species = model.num_species;
+    const int64_t num_reactions = model.num_reactions;
+
+    std::vector<double> x(model.initial_state,
+                          model.initial_state + num_species);
+    std::vector<double> propensity(num_reactions);
+    std::vector<double> noncritical(num_reactions);
+    std::vector<double> mu(num_species), sigma2(num_species);
+    ReactionMask critical(num_reactions);
+    Propensities propensities(model);
+    SumTreeSelector selector(num_reactions);
+    const StoichiometryMoments moments(model);
+    const HighestOrders orders(model);
+    AdaptiveEpsilon epsilon(options.epsilon);
+    LeapScratch scratch(model);
+    StepTimer timer(profile);
+
+    double t = 0.0;
+    int64_t next_output = 0;
+
+    for (;;) {
+        timer.begin_step();
+        record_reached(model, timeline, x.data(), t, next_output, out, timer);
+        if (next_output == timeline.num_times) {
+            break;
+        }
+
+        // Propensities, split into critical reactions, which are close to
+        // exhausting a reactant, and the rest, which are leapt over.
+        double propensity_sum = 0.0;
+        double critical_sum = 0.0;
+        critical.clear();
+        for (int64_t r = 0; r < num_reactions; ++r) {
+            const double a = propensities(r, x.data());
+            propensity[r] = a;
+            propensity_sum += a;
+            if (a > 0.0 && max_firings(model, r, x.data()) <
+                               options.critical_threshold) {
+                critical.set(r);
+                critical_sum += a;
+                noncritical[r] = 0.0;
+            } else {
+                noncritical[r] = a;
+            }
+        }
+
+        // Nothing can fire anymore, the state is final.
+        if (propensity_sum <= 0.0) {
+            break;
+        }
+
+        // Largest leap that keeps the expected change and the standard
+        // deviation of every reactant population below epsilon x_i / g_i.
+        moments(noncritical.data(), mu.data(), sigma2.data());
+        double leap = never;
+        for (int64_t i = 0; i < num_species; ++i) {
+            if (!orders.is_reactant(i)) {
+                continue;
+            }
+            double bound = epsilon.value() * x[i] / orders.g(i, x[i]);
+            if (bound < 1.0) {
+                bound = 1.0;
+            }
+            if (mu[i] != 0.0 && bound / std::fabs(mu[i]) < leap) {
+                leap = bound / std::fabs(mu[i]);
+            }
+            if (sigma2[i] > 0.0 && bound * bound / sigma2[i] < leap) {
+                leap = bound * bound / sigma2[i];
+            }
+        }
+
+        timer.phase(PHASE_UPDATE);
+        if (leap < options.ssa_threshold / propensity_sum) {
+            ssa_burst(model, timeline, options.ssa_steps, propensity.data(),
+                      propensities, selector, random, x.data(), t,
+                      next_output, out, timer);
+            continue;
+        }
+
+        take_leap(model, timeline, leap, propensity.data(),
+                  noncritical.data(), critical, critical_sum, random, epsilon,
+                  scratch, x.data(), t, next_output, profile);
+    }
+    timer.close_phase();
+
+    record_rest(model, timeline, x.data(), next_output, out, timer);
+    if (profile != NULL) {
+        profile->propensity_evaluations += propensities.evaluations();
+    }
+}
+
+} // namespace gillespy2
@@ -0,0 +1,904 @@
+import gillespy2
+import itertools
+import os
+import numpy as np
+from . import checkpoints
+from .gillespySolver import GillesPySolver
+from .gillespyError import *
+from .compiled_model import CompiledModel
+from .random_streams import random_seed
+from .results_store import ResultsStore
+from .results import (timeline, output_species, allocate_trajectories,
+                      format_trajectories, EnsembleStatistics, SolverProfile)
+
+try:
+    from . import _native
+    isNATIVE = True
+except ImportError:
+    isNATIVE = False
+
+
+def histogram_ranges(histogram_range, species):
+    """
+    Returns the (species x 2) float64 bounds of the histogram of every
+    species, from a (low, high) pair for all of them or a dict of pairs by
+    species name.
+    """
+    if isinstance(histogram_range, dict):
+        pairs = [histogram_range[s] for s in species]
+    else:
+        pairs = [histogram_range] * len(species)
+    return np.array(pairs, dtype=np.float64)
+
+
+class NativeSSASolver(GillesPySolver):
+    """
+    Gillespie's direct method, run in the compiled gillespy2._native
+    extension module. The engine works on the arrays of a CompiledModel in
+    place, so no Python code is executed while trajectories are simulated.
+    Neither StochKit2 nor any temporary files are needed. The reaction to
+    fire is found by a linear scan in small models, and in a sum tree
+    (O(log reactions)) or by composition-rejection sampling (O(1)
+    expected) in large ones, chosen from the number of reactions.
+
+    Trajectories are simulated in parallel on cores threads, one per
+    hardware thread by default. Each trajectory draws from its own Philox
+    stream keyed by (seed, trajectory index), so the results do not depend
+    on the number of threads.
+
+    Returns a list of numpy arrays of shape (timepoints, 1 + species) with
+    time in column 0, or a list of dicts keyed by 'time' and species name
+    if show_labels is set. The populations are recorded at timepoints, any
+    non-decreasing times, if given instead of every increment, and only
+    for the listed species, if given. model may also be a CompiledModel,
+    which is simulated as it is; gillespy2.distributed sends those to the
+    nodes of a cluster.
+
+    Given a checkpoint path, run() and run_statistics() simulate the
+    ensemble in batches of checkpoint_interval trajectories and record
+    the progress in that file after each batch (see
+    gillespy2.checkpoints). A run that is interrupted resumes after the
+    last finished batch when it is started again with the same arguments
+    and checkpoint, and the file is removed once the run completes. The
+    trajectories are the same with or without checkpoints. The statistics
+    of the batches are merged, so they equal those of a run without
+    checkpoints up to rounding, and those of an uninterrupted run with
+    the same checkpoint_interval exactly.
+
+    Given a store path instead, run() writes the ensemble to a chunked,
+    memory-mapped ResultsStore at that path (see gillespy2.results_store)
+    as it is simulated, in chunks of store_chunks (trajectories,
+    timepoints, columns), and returns the store, so that ensembles larger
+    than memory are simulated, and read back one species, time window or
+    block of trajectories at a time, without holding them whole.
+
+    With profile set, run(), run_statistics() and run_sweep() also return
+    the SolverProfile of the run, as the last element of a tuple: the
+    firings of every reaction, the events, leaps and propensity
+    evaluations of the engine, the time it spent selecting, carrying out
+    and recording steps, and the wall time of every trajectory.
+    """
+
+    # Name of the gillespy2._native function that simulates the trajectories.
+    engine = 'ssa_direct'
+
+    # What the engine needs at build time, for the error when it is missing.
+    requirement = 'a C++ compiler'
+
+    @classmethod
+    def check_engine(self):
+        """
+        Raises a SimulationError if the engine is not compiled into the
+        gillespy2._native extension module.
+        """
+        if not isNATIVE:
+            raise SimulationError("The gillespy2._native extension module is"
+                                  " not available, reinstall gillespy2 with a"
+                                  " C++ compiler to use {0}.".format(
+                                      self.__name__))
+        if not hasattr(_native, self.engine):
+            raise SimulationError("The gillespy2._native extension module was"
+                                  " built without {0}, reinstall gillespy2"
+                                  " with {1} to use {2}.".format(
+                                      self.engine, self.requirement,
+                                      self.__name__))
+
+    @classmethod
+    def compile_model(self, model):
+        """
+        Returns the CompiledModel of model, or model itself if it is one,
+        after checking that the engine can simulate it.
+        """
+        if model.units == "concentration":
+            raise SimulationError("{0} can only simulate population "
+                                  "models.".format(self.__name__))
+        if not isinstance(model, CompiledModel):
+            model = CompiledModel(model)
+        model.check_native()
+        return model
+
+    @classmethod
+    def checkpoint_key(self, compiled_model, times, indices, seed,
+                       first_trajectory, number_of_trajectories, options):
+        """
+        Returns the checkpoints.run_key() of a run of the engine with
+        these arguments; options are those passed on to the engine, with
+        arrays as lists.
+        """
+        return checkpoints.run_key(
+            self.engine, compiled_model.fingerprint,
+            compiled_model.initial_state.tolist(),
+            compiled_model.parameter_values.tolist(),
+            compiled_model.rate_coefficients.tolist(), compiled_model.volume,
+            times.tolist(), indices.tolist(), seed, first_trajectory,
+            number_of_trajectories, sorted(options.items()))
+
+    @classmethod
+    def call_engine(self, profile, compiled_model, times, seed, out,
+                    **engine_args):
+        """
+        Calls the engine with engine_args. If profile is set, it profiles
+        the run, whose SolverProfile is returned, and None otherwise.
+        """
+        engine = getattr(_native, self.engine)
+        seed &= 0xFFFFFFFFFFFFFFFF
+        if not profile:
+            engine(compiled_model, times, seed, out, **engine_args)
+            return None
+        num_points = 1
+        if engine_args.get('volumes') is not None:
+            num_points = len(engine_args['volumes'])
+        if engine_args.get('statistics') is not None:
+            count = num_points * engine_args['num_trajectories']
+        else:
+            count = out.size // (len(times) * out.shape[-1]) if out.size \
+                else 0
+        trajectory_times = np.zeros(count)
+        counters = engine(compiled_model, times, seed, out,
+                          profile=trajectory_times, **engine_args)
+        return SolverProfile(compiled_model.reactions, counters,
+                             trajectory_times)
+
+    @classmethod
+    def merge_profiles(self, total, profile):
+        if total is None:
+            return profile
+        total.merge(profile)
+        return total
+
+    @classmethod
+    def check_checkpoint_interval(self, checkpoint_interval):
+        if checkpoint_interval < 1:
+            raise SimulationError("checkpoint_interval must be at least 1.")
+
+    @classmethod
+    def run(self, model, t=20, number_of_trajectories=1,
+            increment=0.05, seed=None, debug=False, show_labels=False,
+            stochkit_home=None, cores=None, first_trajectory=0,
+            timepoints=None, species=None, checkpoint=None,
+            checkpoint_interval=1024, store=None, store_chunks=None,
+            profile=False):
+        return self.simulate(model, t, number_of_trajectories, increment,
+                             seed, debug, show_labels, cores,
+                             first_trajectory, timepoints=timepoints,
+                             species=species, checkpoint=checkpoint,
+                             checkpoint_interval=checkpoint_interval,
+                             store=store, store_chunks=store_chunks,
+                             profile=profile)
+
+    @classmethod
+    def simulate(self, model, t, number_of_trajectories, increment, seed,
+                 debug, show_labels, cores, first_trajectory,
+                 timepoints=None, species=None, checkpoint=None,
+                 checkpoint_interval=1024, store=None, store_chunks=None,
+                 profile=False, **engine_options):
+        """
+        Runs the engine with the arguments of run(); engine_options are
+        passed on to the gillespy2._native function.
+        """
+        self.check_engine()
+
+        if cores is not None and cores < 1:
+            raise SimulationError("cores must be at least 1.")
+        self.check_checkpoint_interval(checkpoint_interval)
+        if store is not None and checkpoint is not None:
+            raise SimulationError("A run is either checkpointed or written "
+                                  "to a store.")
+
+        compiled_model = self.compile_model(model)
+        times = timeline(t, increment, timepoints)
+        names, indices = output_species(compiled_model.species, species)
+
+        key = None
+        if checkpoint is not None:
+            key = self.checkpoint_key(compiled_model, times, indices, seed,
+                                      first_trajectory,
+                                      number_of_trajectories,
+                                      engine_options)
+        if seed is None:
+            seed = random_seed()
+
+        if store is not None:
+            return self.stored_trajectories(
+                model, compiled_model, times, names, indices, seed,
+                first_trajectory, number_of_trajectories, cores, show_labels,
+                store, store_chunks, profile, engine_options)
+
+        trajectories = allocate_trajectories(number_of_trajectories, times,
+                                             len(names))
+        total = None
+        if checkpoint is None:
+            total = self.call_engine(
+                profile, compiled_model, times, seed, trajectories,
+                first_trajectory=first_trajectory, cores=cores or 0,
+                species=indices, **engine_options)
+        else:
+            seed, done = checkpoints.resume_trajectories(checkpoint, key,
+                                                         seed, trajectories)
+            while done < number_of_trajectories:
+                batch = allocate_trajectories(
+                    min(checkpoint_interval, number_of_trajectories - done),
+                    times, len(names))
+                total = self.merge_profiles(total, self.call_engine(
+                    profile, compiled_model, times, seed, batch,
+                    first_trajectory=first_trajectory + done,
+                    cores=cores or 0, species=indices, **engine_options))
+                trajectories[done:done + len(batch)] = batch
+                done += len(batch)
+                checkpoints.append_trajectories(checkpoint, batch, done)
+            os.remove(checkpoint)
+
+        if debug:
+            print("{0}: {1} species, {2} reactions, {3} "
+                  "trajectories".format(self.__name__,
+                                        compiled_model.num_species,
+                                        compiled_model.num_reactions,
+                                        number_of_trajectories))
+
+        results = format_trajectories(trajectories, names, show_labels)
+        if profile:
+            return results, total
+        return results
+
+    @classmethod
+    def stored_trajectories(self, model, compiled_model, times, names,
+                            indices, seed, first_trajectory,
+                            number_of_trajectories, cores, show_labels, store,
+                            store_chunks, profile, engine_options):
+        """
+        Runs run() into a new ResultsStore at store, in batches of whole
+        chunks, and returns the store.
+        """
+        metadata = dict(solver=self.__name__, seed=seed,
+                        first_trajectory=first_trajectory,
+                        options=engine_options,
+                        fingerprint=str(compiled_model.fingerprint))
+        if isinstance(model, gillespy2.Model):
+            metadata.update(model=model.name, stochml=model.serialize())
+        results = ResultsStore.create(store, times, ('time',) + tuple(names),
+                                      number_of_trajectories,
+                                      chunks=store_chunks, metadata=metadata)
+        batch_size = results.batch_trajectories()
+        total = None
+        for begin in range(0, number_of_trajectories, batch_size):
+            batch = allocate_trajectories(
+                min(batch_size, number_of_trajectories - begin), times,
+                len(names))
+            total = self.merge_profiles(total, self.call_engine(
+                profile, compiled_model, times, seed, batch,
+                first_trajectory=first_trajectory + begin, cores=cores or 0,
+                species=indices, **engine_options))
+            results.write(begin, batch)
+        results.show_labels = show_labels
+        if profile:
+            return results, total
+        return results
+
+    @classmethod
+    def run_statistics(self, model, t=20, number_of_trajectories=1,
+                       increment=0.05, seed=None, debug=False,
+                       show_labels=False, cores=None, first_trajectory=0,
+                       keep_trajectories=0, histogram_bins=0,
+                       histogram_range=None, timepoints=None, species=None,
+                       checkpoint=None, checkpoint_interval=1024,
+                       profile=False, **engine_options):
+        """
+        Runs number_of_trajectories trajectories like run(), but returns
+        only their running statistics as an EnsembleStatistics, in memory
+        proportional to timepoints x species however many trajectories
+        run. The first keep_trajectories trajectories are kept as well.
+        With histogram_bins, the populations of every species at every
+        timepoint are also counted in that many bins over histogram_range,
+        a (low, high) pair for all species or a dict of pairs by species
+        name, which allows quantile estimates. timepoints and species
+        select the output times and species as in run(). checkpoint,
+        checkpoint_interval and profile are as for run(). engine_options
+        are the tuning parameters of the solver's run().
+        """
+        self.check_engine()
+        if cores is not None and cores < 1:
+            raise SimulationError("cores must be at least 1.")
+        if not 0 <= keep_trajectories <= number_of_trajectories:
+            raise SimulationError("keep_trajectories must be between 0 and "
+                                  "number_of_trajectories.")
+        if histogram_bins < 0 or (histogram_bins and histogram_range is None):
+            raise SimulationError("histogram_bins must not be negative, and"
+                                  " needs a histogram_range.")
+        self.check_checkpoint_interval(checkpoint_interval)
+
+        compiled_model = self.compile_model(model)
+        times = timeline(t, increment, timepoints)
+        names, indices = output_species(compiled_model.species, species)
+        num_species = len(names)
+        if checkpoint is not None and number_of_trajectories:
+            return self.checkpointed_statistics(
+                compiled_model, times, names, indices, seed,
+                number_of_trajectories, first_trajectory, keep_trajectories,
+                histogram_bins, histogram_range, cores, show_labels,
+                checkpoint, checkpoint_interval, profile, engine_options)
+        if seed is None:
+            seed = random_seed()
+
+        kept = allocate_trajectories(keep_trajectories, times, num_species)
+        statistics = np.empty((4, len(times), num_species))
+        histogram = ranges = None
+        if histogram_bins:
+            ranges = histogram_ranges(histogram_range, names)
+            histogram = np.zeros((len(times), num_species, histogram_bins),
+                                 dtype=np.int64)
+        try:
+            total = self.call_engine(
+                profile, compiled_model, times, seed, kept,
+                first_trajectory=first_trajectory, cores=cores or 0,
+                statistics=statistics,
+                num_trajectories=number_of_trajectories,
+                histogram=histogram, histogram_range=ranges,
+                species=indices, **engine_options)
+        except ValueError as e:
+            raise SimulationError(str(e))
+
+        if debug:
+            print("{0}: {1} species, {2} reactions, {3} trajectories "
+                  "streamed".format(self.__name__, num_species,
+                                    compiled_model.num_reactions,
+                                    number_of_trajectories))
+
+        results = EnsembleStatistics(times, names, number_of_trajectories,
+                                     statistics, histogram, ranges,
+                                     format_trajectories(kept, names,
+                                                         show_labels))
+        if profile:
+            return results, total
+        return results
+
+    @classmethod
+    def checkpointed_statistics(self, compiled_model, times, names, indices,
+                                seed, number_of_trajectories,
+                                first_trajectory, keep_trajectories,
+                                histogram_bins, histogram_range, cores,
+                                show_labels, checkpoint, checkpoint_interval,
+                                profile, engine_options):
+        """
+        Runs run_statistics() in batches of checkpoint_interval
+        trajectories, resuming from and saving to checkpoint.
+        """
+        num_species = len(names)
+        ranges = histogram_shape = None
+        if histogram_bins:
+            ranges = histogram_ranges(histogram_range, names)
+            histogram_shape = (len(times), num_species, histogram_bins)
+        key = self.checkpoint_key(
+            compiled_model, times, indices, seed, first_trajectory,
+            number_of_trajectories, dict(
+                engine_options, keep_trajectories=keep_trajectories,
+                histogram_range=None if ranges is None else ranges.tolist(),
+                histogram_bins=histogram_bins))
+        if seed is None:
+            seed = random_seed()
+
+        kept = allocate_trajectories(keep_trajectories, times, num_species)
+        seed, done, saved, saved_histogram = checkpoints.resume_statistics(
+            checkpoint, key, seed, (4, len(times), num_species),
+            histogram_shape, kept)
+        total = profile_total = None
+        if done:
+            total = EnsembleStatistics(times, names, done, saved,
+                                       saved_histogram, ranges, [])
+        while done < number_of_trajectories:
+            count = min(checkpoint_interval, number_of_trajectories - done)
+            batch_kept = allocate_trajectories(
+                min(max(keep_trajectories - done, 0), count), times,
+                num_species)
+            statistics = np.empty((4, len(times), num_species))
+            histogram = None
+            if histogram_bins:
+                histogram = np.zeros(histogram_shape, dtype=np.int64)
+            try:
+                profile_total = self.merge_profiles(
+                    profile_total, self.call_engine(
+                        profile, compiled_model, times, seed, batch_kept,
+                        first_trajectory=first_trajectory + done,
+                        cores=cores or 0, statistics=statistics,
+                        num_trajectories=count, histogram=histogram,
+                        histogram_range=ranges, species=indices,
+                        **engine_options))
+            except ValueError as e:
+                raise SimulationError(str(e))
+            batch = EnsembleStatistics(times, names, count, statistics,
+                                       histogram, ranges, [])
+            if total is None:
+                total = batch
+            else:
+                total.merge(batch)
+            if len(batch_kept):
+                kept[done:done + len(batch_kept)] = batch_kept
+            done += count
+            checkpoints.save_statistics(
+                checkpoint, key, seed, done,
+                [total.mean, total.variance, total.minimum, total.maximum],
+                total.histogram, kept[:min(done, keep_trajectories)])
+        os.remove(checkpoint)
+        total.trajectories = format_trajectories(kept, names, show_labels)
+        if profile:
+            return total, profile_total
+        return total
+
+    @classmethod
+    def run_sweep(self, model, parameters, parameter_names=None, t=20,
+                  number_of_trajectories=1, increment=0.05, seed=None,
+                  debug=False, show_labels=False, cores=None,
+                  first_trajectory=0, statistics=False, keep_trajectories=0,
+                  histogram_bins=0, histogram_range=None, timepoints=None,
+                  species=None, profile=False, **engine_options):
+        """
+        Runs number_of_trajectories trajectories at each of K points of a
+        parameter sweep in one call of the engine, with the model compiled
+        a single time and the (point, trajectory) pairs spread over cores
+        threads together. Returns the list of the K points, each a dict of
+        the swept values by name, and the list of their results: what
+        run() returns for the point, or, if statistics is set, what
+        run_statistics() does, with keep_trajectories, histogram_bins and
+        histogram_range as there. Trajectory i draws from the same random
+        stream at every point, so the points differ only by their values,
+        and each result equals a run of the model with them. With profile
+        set, the SolverProfile of the whole sweep follows as a third
+        element. engine_options are the tuning parameters of the solver's
+        run().
+
+        Attributes
+        ----------
+        parameters : dict or array_like
+            A dict mapping parameter names to sequences of values, swept
+            over their cartesian product with the last name varying
+            fastest, or (K x P) values, one point per row.
+        parameter_names : list of str
+            Names of the P parameters in the columns of an array of
+            parameters. Optional, defaults to all parameters in model
+            order. 'vol' sweeps the volume. The other parameters keep their
+            values; parameter expressions are not re-evaluated.
+        """
+        self.check_engine()
+        if cores is not None and cores < 1:
+            raise SimulationError("cores must be at least 1.")
+        if not 0 <= keep_trajectories <= number_of_trajectories:
+            raise SimulationError("keep_trajectories must be between 0 and "
+                                  "number_of_trajectories.")
+        if histogram_bins < 0 or (histogram_bins and histogram_range is None):
+            raise SimulationError("histogram_bins must not be negative, and"
+                                  " needs a histogram_range.")
+
+        compiled_model = self.compile_model(model)
+        if isinstance(parameters, dict):
+            parameter_names = list(parameters)
+            sets = np.array(list(itertools.product(
+                *[parameters[name] for name in parameter_names])),
+                dtype=np.float64)
+        else:
+            if parameter_names is None:
+                parameter_names = compiled_model.parameters
+            sets = np.asarray(parameters, dtype=np.float64)
+        for name in parameter_names:
+            if name != 'vol' and name not in compiled_model.parameter_index:
+                raise ParameterError("Unknown parameter '{0}'.".format(name))
+        if sets.ndim != 2 or sets.shape[1] != len(parameter_names) or \
+                not len(sets):
+            raise ParameterError("parameters must be a (K x {0}) array with "
+                                 "K > 0.".format(len(parameter_names)))
+
+        num_points = len(sets)
+        values = np.empty((num_points, len(compiled_model.parameters)))
+        values[:] = compiled_model.parameter_values
+        volumes = np.empty(num_points)
+        volumes[:] = compiled_model.volume
+        for column, name in enumerate(parameter_names):
+            if name == 'vol':
+                volumes[:] = sets[:, column]
+            else:
+                values[:, compiled_model.parameter_index[name]] = \
+                    sets[:, column]
+        if not np.all(volumes > 0):
+            raise ParameterError("The volume must be positive.")
+        coefficients = compiled_model.rate_coefficient_matrix(values, volumes)
+        points = [dict(zip(parameter_names, (float(v) for v in row)))
+                  for row in sets]
+
+        times = timeline(t, increment, timepoints)
+        names, indices = output_species(compiled_model.species, species)
+        num_species = len(names)
+        if seed is None:
+            seed = random_seed()
+        kept = keep_trajectories if statistics else number_of_trajectories
+        trajectories = allocate_trajectories(
+            num_points * kept, times, num_species).reshape(
+                num_points, kept, len(times), 1 + num_species)
+        streamed = histogram = ranges = None
+        if statistics:
+            streamed = np.empty((num_points, 4, len(times), num_species))
+            engine_options['statistics'] = streamed
+            engine_options['num_trajectories'] = number_of_trajectories
+            if histogram_bins:
+                ranges = histogram_ranges(histogram_range, names)
+                histogram = np.zeros((num_points, len(times), num_species,
+                                      histogram_bins), dtype=np.int64)
+                engine_options['histogram'] = histogram
+                engine_options['histogram_range'] = ranges
+        try:
+            total = self.call_engine(
+                profile, compiled_model, times, seed, trajectories,
+                first_trajectory=first_trajectory, cores=cores or 0,
+                species=indices, parameters=values,
+                rate_coefficients=coefficients, volumes=volumes,
+                **engine_options)
+        except ValueError as e:
+            raise SimulationError(str(e))
+
+        if debug:
+            print("{0}: {1} species, {2} reactions, {3} points of {4} "
+                  "trajectories".format(self.__name__, num_species,
+                                        compiled_model.num_reactions,
+                                        num_points, number_of_trajectories))
+
+        if not statistics:
+            results = [format_trajectories(trajectories[k], names,
+                                           show_labels)
+                       for k in range(num_points)]
+        else:
+            results = [EnsembleStatistics(
+                times, names, number_of_trajectories, streamed[k],
+                histogram[k] if histogram_bins else None, ranges,
+                format_trajectories(trajectories[k], names, show_labels))
+                for k in range(num_points)]
+        if profile:
+            return points, results, total
+        return points, results
+
+
+    @classmethod
+    def run_until_converged(self, model, tolerance, species=None,
+                            relative=False, all_timepoints=False, t=20,
+                            increment=0.05, seed=None, batch_size=1000,
+                            min_trajectories=None, max_trajectories=1000000,
+                            **statistics_args):
+        """
+        Runs the ensemble in batches of batch_size trajectories, keeping
+        only their statistics as run_statistics() does, until the standard
+        error of the mean of every species in species (all by default) at
+        the final time, or at all times if all_timepoints is set, is at
+        most tolerance, or tolerance times the absolute mean if relative
+        is set. At least min_trajectories (one batch by default) and at
+        most max_trajectories are run; the returned EnsembleStatistics
+        tells in number_of_trajectories how many were. The trajectories
+        are those of a single run with the same seed, so the result is
+        reproducible. statistics_args are passed on to run_statistics(),
+        keep_trajectories counting over the whole ensemble; with profile,
+        the SolverProfile of all batches is returned as well.
+        """
+        if not tolerance > 0:
+            raise SimulationError("tolerance must be positive.")
+        if batch_size < 1:
+            raise SimulationError("batch_size must be at least 1.")
+        if min_trajectories is None:
+            min_trajectories = batch_size
+        if not 2 <= max(min_trajectories, 2) <= max_trajectories:
+            raise SimulationError("max_trajectories must be at least "
+                                  "min_trajectories and 2.")
+        if seed is None:
+            seed = random_seed()
+        keep = statistics_args.pop('keep_trajectories', 0)
+        first_trajectory = statistics_args.pop('first_trajectory', 0)
+        profile = statistics_args.pop('profile', False)
+
+        statistics = total = None
+        columns = None
+        while True:
+            done = statistics.number_of_trajectories if statistics else 0
+            size = min(batch_size, max_trajectories - done)
+            batch = self.run_statistics(
+                model, t=t, number_of_trajectories=size,
+                increment=increment, seed=seed,
+                first_trajectory=first_trajectory + done,
+                keep_trajectories=min(max(keep - done, 0), size),
+                profile=profile, **statistics_args)
+            if profile:
+                batch, batch_profile = batch
+                total = self.merge_profiles(total, batch_profile)
+            if statistics is None:
+                statistics = batch
+                names = species if species is not None else batch.species
+                columns = [batch.species.index(str(s)) for s in names]
+            else:
+                statistics.merge(batch)
+            done = statistics.number_of_trajectories
+            if done >= max_trajectories:
+                break
+            if done < min_trajectories or done < 2:
+                continue
+            rows = slice(None) if all_timepoints else slice(-1, None)
+            error = statistics.standard_error()[rows][:, columns]
+            bound = tolerance * (np.abs(statistics.mean[rows][:, columns])
+                                 if relative else 1.0)
+            if np.all(error <= bound):
+                break
+        if profile:
+            return statistics, total
+        return statistics
+
+
+class NativeNextReactionSolver(NativeSSASolver):
+    """
+    Gibson and Bruck's next reaction method, run in the compiled
+    gillespy2._native extension module. Each reaction's putative firing
+    time is kept in an indexed priority queue, and after an event only the
+    propensities marked by the CompiledModel dependency graph are updated,
+    so the cost per event grows with log(reactions) instead of linearly.
+    Best suited to large, sparsely coupled networks; results have the same
+    format as NativeSSASolver.
+    """
+
+    engine = 'ssa_next_reaction'
+
+
+class NativeTauLeapingSolver(NativeSSASolver):
+    """
+    Explicit tau-leaping with the step size selection of Cao, Gillespie
+    and Petzold (2006), run in the compiled gillespy2._native extension
+    module. Each leap fires a Poisson number of every non-critical
+    reaction, with the leap chosen so that no propensity changes by more
+    than a fraction epsilon; critical reactions, those that can fire fewer
+    than critical_threshold times before exhausting a reactant, fire one
+    event at a time. Leaps that would make a population negative are
+    retried with half the step, and epsilon is lowered while many leaps
+    are rejected. Where the leap would be shorter than a few mean reaction
+    waiting times, a burst of exact SSA steps is taken instead, so the
+    cost follows the stiffness of the system. Far faster than the exact
+    solvers for models with large populations; results have the same
+    format as NativeSSASolver.
+
+    Attributes
+    ----------
+    epsilon : float (0.03)
+        Bound on the relative change of the propensities in one leap.
+    critical_threshold : int (10)
+        Reactions that can fire fewer times than this are critical.
+    ssa_threshold : float (10)
+        Exact steps are taken when the leap is shorter than ssa_threshold
+        divided by the total propensity; 0 disables them.
+    ssa_steps : int (100)
+        Number of exact steps in a burst.
+    lockstep : bool (True)
+        Simulate small mass-action models in blocks of trajectories that
+        evaluate their propensities and leap sizes together as SIMD
+        vectors; the trajectories are the same either way.
+    """
+
+    engine = 'tau_leaping'
+
+    @classmethod
+    def run(self, model, t=20, number_of_trajectories=1,
+            increment=0.05, seed=None, debug=False, show_labels=False,
+            stochkit_home=None, cores=None, first_trajectory=0,
+            timepoints=None, species=None, epsilon=0.03,
+            critical_threshold=10, ssa_threshold=10, ssa_steps=100,
+            lockstep=True, checkpoint=None,
+            checkpoint_interval=1024, store=None, store_chunks=None,
+            profile=False):
+        if not 0 < epsilon <= 1:
+            raise SimulationError("epsilon must be in (0, 1].")
+        if critical_threshold < 0 or ssa_threshold < 0:
+            raise SimulationError("critical_threshold and ssa_threshold must"
+                                  " not be negative.")
+        if ssa_steps < 1:
+            raise SimulationError("ssa_steps must be at least 1.")
+        return self.simulate(model, t, number_of_trajectories, increment,
+                             seed, debug, show_labels, cores,
+                             first_trajectory, timepoints=timepoints,
+                             species=species, epsilon=epsilon,
+                             critical_threshold=critical_threshold,
+                             ssa_threshold=ssa_threshold,
+                             ssa_steps=ssa_steps, lockstep=bool(lockstep),
+                             checkpoint=checkpoint,
+                             checkpoint_interval=checkpoint_interval,
+                             store=store, store_chunks=store_chunks,
+                             profile=profile)
+
+
+class NativeHybridSolver(NativeSSASolver):
+    """
+    Hybrid ODE/SSA simulation after Salis and Kaznessis (2005), run in the
+    compiled gillespy2._native extension module, for multiscale models in
+    which a few reactions on abundant species dominate the event count.
+    The reactions are partitioned anew before every step: those that only
+    change species with at least continuous_population molecules and that
+    fire at least fast_events times per step follow their rate equations,
+    integrated by the fourth-order Runge-Kutta method, while all others
+    fire one event at a time at exactly sampled times. The partition
+    follows the populations, so a species is rounded to whole molecules
+    and simulated one molecule at a time once it becomes scarce. A step
+    that would drive a population below zero is halved, and taken as an
+    exact step if that does not help. Setting the mode of a Species to
+    'discrete' or 'continuous' overrides the partition for the reactions
+    that change it. Results have the same format as NativeSSASolver, with
+    real-valued populations for the continuously simulated species.
+
+    Attributes
+    ----------
+    epsilon : float (0.03)
+        Bound on the flux through a species in one integration step,
+        relative to its population.
+    fast_events : float (10)
+        Fewest expected firings per step of a continuous reaction.
+    continuous_population : float (100)
+        Smallest population of a dynamic species changed by a continuous
+        reaction.
+    """
+
+    engine = 'hybrid'
+
+    @classmethod
+    def run(self, model, t=20, number_of_trajectories=1,
+            increment=0.05, seed=None, debug=False, show_labels=False,
+            stochkit_home=None, cores=None, first_trajectory=0,
+            timepoints=None, species=None, epsilon=0.03, fast_events=10,
+            continuous_population=100, checkpoint=None,
+            checkpoint_interval=1024, store=None, store_chunks=None,
+            profile=False):
+        if not 0 < epsilon <= 1:
+            raise SimulationError("epsilon must be in (0, 1].")
+        if fast_events < 0 or continuous_population < 0:
+            raise SimulationError("fast_events and continuous_population"
+                                  " must not be negative.")
+        return self.simulate(model, t, number_of_trajectories, increment,
+                             seed, debug, show_labels, cores,
+                             first_trajectory, timepoints=timepoints,
+                             species=species, epsilon=epsilon,
+                             fast_events=fast_events,
+                             continuous_population=continuous_population,
+                             checkpoint=checkpoint,
+                             checkpoint_interval=checkpoint_interval,
+                             store=store, store_chunks=store_chunks,
+                             profile=profile)
+
+
+class NativeCLESolver(NativeSSASolver):
+    """
+    The chemical Langevin equation (Gillespie, 2000), integrated by the
+    Euler-Maruyama method in the compiled gillespy2._native extension
+    module. Each step draws a Gaussian number of firings of every reaction,
+    a t + sqrt(a t) N(0, 1), as a vector, and applies them all in one
+    product with the dense stoichiometry matrix. Sits between tau-leaping
+    and the rate equations: suited to systems whose populations are too
+    large for Poisson sampling to pay off, but whose fluctuations the ODE
+    solver would miss. Results have the same format as NativeSSASolver,
+    with real-valued populations, which are reflected at 0.
+
+    Attributes
+    ----------
+    epsilon : float (0.03)
+        With adaptive steps, bound on the expected change and on the
+        standard deviation of every population in one step, relative to
+        the population.
+    step_size : float (None)
+        Fixed step size; steps are chosen from epsilon if None.
+    lockstep : bool (True)
+        Simulate small mass-action models in blocks of trajectories that
+        step together, evaluating their propensities and increments as
+        SIMD vectors; the trajectories are the same either way.
+    """
+
+    engine = 'chemical_langevin'
+
+    @classmethod
+    def run(self, model, t=20, number_of_trajectories=1,
+            increment=0.05, seed=None, debug=False, show_labels=False,
+            stochkit_home=None, cores=None, first_trajectory=0,
+            timepoints=None, species=None, epsilon=0.03, step_size=None,
+            lockstep=True, checkpoint=None, checkpoint_interval=1024,
+            store=None, store_chunks=None, profile=False):
+        if not 0 < epsilon <= 1:
+            raise SimulationError("epsilon must be in (0, 1].")
+        if step_size is not None and not step_size > 0:
+            raise SimulationError("step_size must be positive.")
+        return self.simulate(model, t, number_of_trajectories, increment,
+                             seed, debug, show_labels, cores,
+                             first_trajectory, timepoints=timepoints,
+                             species=species, epsilon=epsilon,
+                             step_size=step_size or 0.0,
+                             lockstep=bool(lockstep), checkpoint=checkpoint,
+                             checkpoint_interval=checkpoint_interval,
+                             store=store, store_chunks=store_chunks,
+                             profile=profile)
+
+
+class NativeGPUSSASolver(NativeSSASolver):
+    """
+    Gillespie's direct method on a CUDA device, one trajectory per device
+    thread. Available if gillespy2 was built with the CUDA toolkit (nvcc
+    found on the PATH or under CUDA_HOME). The compiled model is copied to
+    the device once per run, each thread draws from the Philox stream of
+    its trajectory index as on the CPU, and run_statistics() reduces the
+    statistics on the device, so only they cross the bus. Takes the same
+    Model objects and returns results of the same format as
+    NativeSSASolver. The trajectories follow the same distribution as
+    those of NativeSSASolver but, with the device math library, need not
+    be bitwise identical to them. Histograms and parameter sweeps are not
+    supported, and runs are not profiled.
+
+    Attributes
+    ----------
+    device : int (0)
+        Number of the CUDA device to run on.
+    """
+
+    engine = 'gpu_ssa_direct'
+    requirement = 'the CUDA toolkit'
+
+    @classmethod
+    def run(self, model, t=20, number_of_trajectories=1,
+            increment=0.05, seed=None, debug=False, show_labels=False,
+            stochkit_home=None, cores=None, first_trajectory=0,
+            timepoints=None, species=None, device=0, checkpoint=None,
+            checkpoint_interval=1024, store=None, store_chunks=None,
+            profile=False):
+        self.check_profile(profile)
+        try:
+            return self.simulate(model, t, number_of_trajectories, increment,
+                                 seed, debug, show_labels, cores,
+                                 first_trajectory, timepoints=timepoints,
+                                 species=species, checkpoint=checkpoint,
+                                 checkpoint_interval=checkpoint_interval,
+                                 store=store, store_chunks=store_chunks,
+                                 device=device)
+        except RuntimeError as e:
+            raise SimulationError(str(e))
+
+    @classmethod
+    def run_statistics(self, model, t=20, number_of_trajectories=1,
+                       increment=0.05, seed=None, debug=False,
+                       show_labels=False, cores=None, first_trajectory=0,
+                       keep_trajectories=0, histogram_bins=0,
+                       histogram_range=None, timepoints=None, species=None,
+                       checkpoint=None, checkpoint_interval=1024, device=0,
+                       profile=False):
+        self.check_profile(profile)
+        if histogram_bins:
+            raise SimulationError("{0} does not support histograms.".format(
+                self.__name__))
+        try:
+            return super(NativeGPUSSASolver, self).run_statistics(
+                model, t, number_of_trajectories, increment, seed, debug,
+                show_labels, cores, first_trajectory, keep_trajectories,
+                timepoints=timepoints, species=species, checkpoint=checkpoint,
+                checkpoint_interval=checkpoint_interval, device=device)
+        except RuntimeError as e:
+            raise SimulationError(str(e))
+
+    @classmethod
+    def check_profile(self, profile):
+        if profile:
+            raise SimulationError("{0} does not support profiling.".format(
+                self.__name__))
+
+    @classmethod
+    def run_sweep(self, model, parameters, *args, **kwargs):
+        raise SimulationError("{0} does not support parameter sweeps, use "
+                              "NativeSSASolver.".format(self.__name__))
@@ -0,0 +1,64 @@
+"""
+Ensemble execution for the pure Python solvers.
+
+run_trajectories() spreads the trajectories of an ensemble over a pool of
+worker processes, one single trajectory run of the solver per task.
+Trajectory i always draws from the stream TrajectoryRandom(seed, i), so
+the ensemble does not depend on the number of processes or on the order
+in which they pick up work.
+"""
+import numpy as np
+from .random_streams import random_seed
+
+
+def _run_trajectory(task):
+    solver, model, seed, trajectory, solver_args = task
+    return solver.run(model, number_of_trajectories=1, seed=seed,
+                      first_trajectory=trajectory, cores=1,
+                      show_labels=False, **solver_args)[0]
+
+
+def run_trajectories(solver, model, number_of_trajectories, cores=None,
+                     seed=None, first_trajectory=0, **solver_args):
+    """
+    Runs number_of_trajectories single trajectory simulations
+    solver.run(model, number_of_trajectories=1, seed=seed,
+    first_trajectory=first_trajectory + i, **solver_args) in a pool of
+    worker processes and returns them in one (trajectories, timepoints,
+    1 + species) array.
+
+    Attributes
+    ----------
+    cores : int
+        Number of worker processes. Optional, defaults to one per
+        processor.
+    seed : int
+        The ensemble seed. Optional, defaults to a random seed.
+    first_trajectory : int
+        Index of the first trajectory within the ensemble.
+    """
+    # Imported here, the solvers do not need it for serial runs.
+    import multiprocessing
+    if seed is None:
+        seed = random_seed()
+    if cores is None:
+        cores = multiprocessing.cpu_count()
+    cores = max(1, min(cores, number_of_trajectories))
+    tasks = [(solver, model, seed, first_trajectory + i, solver_args)
+             for i in range(number_of_trajectories)]
+
+    # Trajectories are handed out one at a time, so workers that draw
+    # short trajectories take more of them. Each is copied into the output
+    # buffer as it arrives.
+    trajectories = None
+    pool = multiprocessing.Pool(cores)
+    try:
+        for i, trajectory in enumerate(pool.imap(_run_trajectory, tasks)):
+            if trajectories is None:
+                trajectories = np.empty((number_of_trajectories,)
+                                        + trajectory.shape)
+            trajectories[i] = trajectory
+    finally:
+        pool.close()
+        pool.join()
+    return trajectories
@@ -0,0 +1,414 @@
+"""
+Compilation of reaction propensity functions.
+
+Propensity functions are parsed once per model instead of once per
+evaluation. Every propensity is compiled to
+
+  - a Python code object, used by the pure Python solvers in place of
+    eval() on the propensity string,
+  - a mass-action kernel (a constant, one rate parameter, a power of the
+    volume and the reactant orders), if the expression has the shape built
+    by Reaction.create_mass_action, or
+  - otherwise a small stack machine program interpreted by the native
+    engines (see native/propensity.h).
+
+Compiled propensities depend only on the names and structure of a model,
+not on parameter values, so they are cached by a fingerprint of the model
+topology. Parameter values and the volume are bound at run time.
+"""
+from collections import OrderedDict
+import ast
+import hashlib
+import numpy as np
+from .gillespyError import *
+
+# Opcodes and function numbers of the native interpreter. These must match
+# the enums in native/propensity.h.
+OP_CONSTANT = 0
+OP_SPECIES = 1
+OP_PARAMETER = 2
+OP_VOLUME = 3
+OP_ADD = 4
+OP_SUBTRACT = 5
+OP_MULTIPLY = 6
+OP_DIVIDE = 7
+OP_POWER = 8
+OP_MODULO = 9
+OP_NEGATE = 10
+OP_LESS = 11
+OP_LESS_EQUAL = 12
+OP_GREATER = 13
+OP_GREATER_EQUAL = 14
+OP_EQUAL = 15
+OP_NOT_EQUAL = 16
+OP_SELECT = 17
+OP_CALL1 = 18
+OP_CALL2 = 19
+
+UNARY_FUNCTIONS = {'abs': 0, 'exp': 1, 'log': 2, 'log10': 3, 'sqrt': 4,
+                   'sin': 5, 'cos': 6, 'tan': 7, 'floor': 8, 'ceil': 9}
+BINARY_FUNCTIONS = {'pow': 0, 'min': 1, 'max': 2}
+FN_FLOOR = UNARY_FUNCTIONS['floor']
+
+BINARY_OPERATORS = {ast.Add: OP_ADD, ast.Sub: OP_SUBTRACT,
+                    ast.Mult: OP_MULTIPLY, ast.Div: OP_DIVIDE,
+                    ast.Pow: OP_POWER, ast.Mod: OP_MODULO}
+COMPARE_OPERATORS = {ast.Lt: OP_LESS, ast.LtE: OP_LESS_EQUAL,
+                     ast.Gt: OP_GREATER, ast.GtE: OP_GREATER_EQUAL,
+                     ast.Eq: OP_EQUAL, ast.NotEq: OP_NOT_EQUAL}
+
+# Number of compiled models kept in the cache.
+CACHE_SIZE = 64
+_cache = OrderedDict()
+
+
+def model_fingerprint(model):
+    """
+    Returns a hash of the topology of a model: the names of its species and
+    parameters, and the stoichiometry and propensity function of every
+    reaction. Parameter values, initial populations and the volume are not
+    part of the fingerprint.
+    """
+    topology = [list(model.listOfSpecies.keys()),
+                list(model.listOfParameters.keys())]
+    for rname, reaction in model.listOfReactions.items():
+        topology.append((rname, reaction.propensity_function,
+                         sorted((str(s), n) for s, n in reaction.reactants.items()),
+                         sorted((str(s), n) for s, n in reaction.products.items())))
+    return hashlib.sha1(repr(topology).encode('utf-8')).hexdigest()
+
+
+def compile_propensities(model):
+    """
+    Returns the CompiledPropensities of a model, compiling them only if no
+    model with the same fingerprint has been compiled before.
+    """
+    fingerprint = model_fingerprint(model)
+    compiled = _cache.pop(fingerprint, None)
+    if compiled is None:
+        compiled = CompiledPropensities(model, fingerprint)
+    _cache[fingerprint] = compiled
+    while len(_cache) > CACHE_SIZE:
+        _cache.popitem(last=False)
+    return compiled
+
+
+def _number(node):
+    """ Returns the value of a numeric literal node, or None. """
+    if hasattr(ast, 'Constant') and isinstance(node, ast.Constant):
+        value = node.value
+    elif isinstance(node, getattr(ast, 'Num', ())):
+        value = node.n
+    else:
+        return None
+    if isinstance(value, (int, float)):
+        return float(value)
+    return None
+
+
+class _Monomial(object):
+    """
+    A product const * prod(parameters) * vol**volume * prod(species terms),
+    where each species term x - offset is stored as an offset per species.
+    """
+
+    def __init__(self, const=1.0):
+        self.const = const
+        self.parameters = {}
+        self.volume = 0
+        self.species = {}
+
+    def multiply(self, other):
+        self.const *= other.const
+        for p, power in other.parameters.items():
+            self.parameters[p] = self.parameters.get(p, 0) + power
+        self.volume += other.volume
+        for s, offsets in other.species.items():
+            self.species.setdefault(s, []).extend(offsets)
+        return self
+
+    def divide(self, other):
+        if other.species or other.const == 0:
+            return None
+        self.const /= other.const
+        for p, power in other.parameters.items():
+            self.parameters[p] = self.parameters.get(p, 0) - power
+        self.volume -= other.volume
+        return self
+
+
+class _PropensityCompiler(object):
+    """ Compiles propensity expressions in the namespace of one model. """
+
+    def __init__(self, species, parameters):
+        self.species_index = dict((s, i) for i, s in enumerate(species))
+        self.parameter_index = dict((p, i) for i, p in enumerate(parameters))
+        self.constants = []
+        self.constant_index = {}
+
+    def resolve(self, name):
+        """
+        Resolves a name like the solvers' eval() namespace does: parameters
+        shadow 'vol', which shadows species.
+        """
+        if name in self.parameter_index:
+            return ('parameter', self.parameter_index[name])
+        if name == 'vol':
+            return ('volume', 0)
+        if name in self.species_index:
+            return ('species', self.species_index[name])
+        raise ReactionError("Unknown name '{0}'".format(name))
+
+    def monomial(self, node):
+        """ Returns the _Monomial an expression node reduces to, or None. """
+        value = _number(node)
+        if value is not None:
+            return _Monomial(value)
+        if isinstance(node, ast.Name):
+            kind, index = self.resolve(node.id)
+            m = _Monomial()
+            if kind == 'parameter':
+                m.parameters[index] = 1
+            elif kind == 'volume':
+                m.volume = 1
+            else:
+                m.species[index] = [0]
+            return m
+        if isinstance(node, ast.BinOp):
+            if isinstance(node.op, ast.Sub) and isinstance(node.left, ast.Name):
+                offset = _number(node.right)
+                kind, index = self.resolve(node.left.id)
+                if (kind == 'species' and offset is not None and offset > 0
+                        and offset == int(offset)):
+                    m = _Monomial()
+                    m.species[index] = [int(offset)]
+                    return m
+                return None
+            if isinstance(node.op, (ast.Mult, ast.Div)):
+                left = self.monomial(node.left)
+                right = self.monomial(node.right)
+                if left is None or right is None:
+                    return None
+                if isinstance(node.op, ast.Mult):
+                    return left.multiply(right)
+                return left.divide(right)
+        return None
+
+    def kernel(self, expression):
+        """
+        Returns (const, parameter, volume_power, [(species, order)]) if the
+        expression is a mass-action propensity, otherwise None.
+        """
+        m = self.monomial(expression)
+        if m is None:
+            return None
+        parameters = [p for p, power in m.parameters.items() if power != 0]
+        if len(parameters) > 1:
+            return None
+        parameter = -1
+        if parameters:
+            parameter = parameters[0]
+            if m.parameters[parameter] != 1:
+                return None
+        orders = []
+        for s in sorted(m.species):
+            offsets = sorted(m.species[s])
+            if offsets != list(range(len(offsets))):
+                return None
+            orders.append((s, len(offsets)))
+        return (m.const, parameter, m.volume, orders)
+
+    def constant(self, value):
+        key = repr(value)
+        if key not in self.constant_index:
+            self.constant_index[key] = len(self.constants)
+            self.constants.append(value)
+        return self.constant_index[key]
+
+    def program(self, expression):
+        """ Returns (code, max_depth) of the stack machine program. """
+        code = []
+        state = {'depth': 0, 'max_depth': 0}
+
+        def emit(opcode, operand=0, inputs=2):
+            code.append((opcode, operand))
+            state['depth'] += 1 - inputs
+            state['max_depth'] = max(state['max_depth'], state['depth'])
+
+        def visit(node):
+            value = _number(node)
+            if value is not None:
+                emit(OP_CONSTANT, self.constant(value), 0)
+            elif isinstance(node, ast.Name):
+                kind, index = self.resolve(node.id)
+                opcode = {'parameter': OP_PARAMETER, 'volume': OP_VOLUME,
+                          'species': OP_SPECIES}[kind]
+                emit(opcode, index, 0)
+            elif isinstance(node, ast.BinOp):
+                visit(node.left)
+                visit(node.right)
+                if isinstance(node.op, ast.FloorDiv):
+                    emit(OP_DIVIDE)
+                    emit(OP_CALL1, FN_FLOOR, 1)
+                elif type(node.op) in BINARY_OPERATORS:
+                    emit(BINARY_OPERATORS[type(node.op)])
+                else:
+                    raise ReactionError("Unsupported operator "
+                                        + type(node.op).__name__)
+            elif isinstance(node, ast.UnaryOp):
+                visit(node.operand)
+                if isinstance(node.op, ast.USub):
+                    emit(OP_NEGATE, 0, 1)
+                elif not isinstance(node.op, ast.UAdd):
+                    raise ReactionError("Unsupported operator "
+                                        + type(node.op).__name__)
+            elif isinstance(node, ast.Compare):
+                if len(node.ops) != 1 or type(node.ops[0]) not in COMPARE_OPERATORS:
+                    raise ReactionError("Unsupported comparison")
+                visit(node.left)
+                visit(node.comparators[0])
+                emit(COMPARE_OPERATORS[type(node.ops[0])])
+            elif isinstance(node, ast.IfExp):
+                visit(node.test)
+                visit(node.body)
+                visit(node.orelse)
+                emit(OP_SELECT, 0, 3)
+            elif isinstance(node, ast.Call) and isinstance(node.func, ast.Name):
+                name = node.func.id
+                args = node.args
+                if getattr(node, 'keywords', None):
+                    raise ReactionError("Unsupported call of " + name)
+                if name in UNARY_FUNCTIONS and len(args) == 1:
+                    visit(args[0])
+                    emit(OP_CALL1, UNARY_FUNCTIONS[name], 1)
+                elif name in ('min', 'max') and len(args) >= 2:
+                    visit(args[0])
+                    for arg in args[1:]:
+                        visit(arg)
+                        emit(OP_CALL2, BINARY_FUNCTIONS[name])
+                elif name == 'pow' and len(args) == 2:
+                    visit(args[0])
+                    visit(args[1])
+                    emit(OP_CALL2, BINARY_FUNCTIONS[name])
+                else:
+                    raise ReactionError("Unsupported call of " + name)
+            else:
+                raise ReactionError("Unsupported expression "
+                                    + type(node).__name__)
+
+        visit(expression)
+        return code, state['max_depth']
+
+
+def _compile_python(rname, expression):
+    return compile(expression, '<propensity of {0}>'.format(rname), 'eval')
+
+
+class CompiledPropensities(object):
+    """
+    Propensity functions of all reactions of a model, compiled for both the
+    Python and the native solvers. Reactions, species and parameters are
+    indexed in the order of the model's OrderedDicts.
+
+    Attributes
+    ----------
+    fingerprint : str
+        model_fingerprint() of the compiled model.
+    python_code : OrderedDict
+        Python code object of each propensity, by reaction name.
+    expressions : OrderedDict
+        Source of each propensity, by reaction name.
+    kernel_indptr, kernel_species, kernel_orders : numpy ndarray
+        CSR form of the reactant orders of each mass-action kernel.
+    program_indptr, program_code, program_constants : numpy ndarray
+        Stack machine programs of the reactions without a kernel.
+    max_stack_depth : int
+        Largest stack depth needed by any program.
+    unsupported : dict
+        Reactions that could not be compiled for the native solvers, with
+        the reason.
+    """
+
+    def __init__(self, model, fingerprint=None):
+        self.fingerprint = fingerprint or model_fingerprint(model)
+        self.reactions = list(model.listOfReactions.keys())
+        compiler = _PropensityCompiler(model.listOfSpecies.keys(),
+                                       model.listOfParameters.keys())
+
+        self.python_code = OrderedDict()
+        self.expressions = OrderedDict()
+        self.unsupported = {}
+        kernel_indptr = [0]
+        kernel_species = []
+        kernel_orders = []
+        kernel_constants = []
+        kernel_parameters = []
+        kernel_volume_powers = []
+        program_indptr = [0]
+        program_code = []
+        max_stack_depth = 0
+
+        for rname in self.reactions:
+            expression = model.listOfReactions[rname].propensity_function
+            self.expressions[rname] = expression
+            self.python_code[rname] = _compile_python(rname, expression)
+            kernel = None
+            try:
+                tree = ast.parse(expression, mode='eval').body
+                kernel = compiler.kernel(tree)
+                if kernel is None:
+                    code, depth = compiler.program(tree)
+                    program_code.extend(code)
+                    max_stack_depth = max(max_stack_depth, depth)
+            except (ReactionError, SyntaxError) as e:
+                self.unsupported[rname] = str(e)
+
+            if kernel is None:
+                const, parameter, volume_power, orders = 0.0, -1, 0, []
+            else:
+                const, parameter, volume_power, orders = kernel
+            for s, order in orders:
+                kernel_species.append(s)
+                kernel_orders.append(order)
+            kernel_indptr.append(len(kernel_species))
+            kernel_constants.append(const)
+            kernel_parameters.append(parameter)
+            kernel_volume_powers.append(volume_power)
+            program_indptr.append(len(program_code))
+
+        self.kernel_indptr = np.array(kernel_indptr, dtype=np.int64)
+        self.kernel_species = np.array(kernel_species, dtype=np.int64)
+        self.kernel_orders = np.array(kernel_orders, dtype=np.int64)
+        self.kernel_constants = np.array(kernel_constants, dtype=np.float64)
+        self.kernel_parameters = np.array(kernel_parameters, dtype=np.int64)
+        self.kernel_volume_powers = np.array(kernel_volume_powers,
+                                             dtype=np.float64)
+        self.program_indptr = np.array(program_indptr, dtype=np.int64)
+        self.program_code = np.array(program_code,
+                                     dtype=np.int64).reshape(-1)
+        self.program_constants = np.array(compiler.constants,
+                                          dtype=np.float64)
+        self.max_stack_depth = max_stack_depth
+
+    def __getstate__(self):
+        # Code objects do not pickle; they are compiled again on loading.
+        state = dict(self.__dict__)
+        del state['python_code']
+        return state
+
+    def __setstate__(self, state):
+        self.__dict__.update(state)
+        self.python_code = OrderedDict(
+            (rname, _compile_python(rname, expression))
+            for rname, expression in self.expressions.items())
+
+    def rate_coefficients(self, parameter_values, volume):
+        """
+        Binds parameter values and the volume to the mass-action kernels.
+        Returns the coefficient of every reaction (0 for reactions that are
+        evaluated by a program).
+        """
+        # Index -1 (no rate parameter) selects the trailing 1.0.
+        values = np.append(np.asarray(parameter_values, dtype=np.float64), 1.0)
+        return (self.kernel_constants * values[self.kernel_parameters]
+                * float(volume) ** self.kernel_volume_powers)
@@ -0,0 +1,87 @@
+"""
+Per-trajectory random number streams for the Python solvers.
+
+Each trajectory of an ensemble draws from its own generator keyed by
+(seed, trajectory index), never from the global random or numpy.random
+state. A trajectory therefore comes out the same whichever process runs
+it, and in whatever order, like the Philox streams of the native engines
+(see native/random.h).
+"""
+import math
+import random
+
+_MASK64 = (1 << 64) - 1
+
+
+def random_seed():
+    """ Returns a fresh seed for an ensemble. """
+    return random.randint(0, 2147483647)
+
+
+class TrajectoryRandom(random.Random):
+    """
+    The random stream of trajectory number trajectory of the ensemble with
+    the given seed. Provides all methods of random.Random plus poisson().
+
+    Attributes
+    ----------
+    seed : int
+        The ensemble seed, reduced to 64 bits. Optional, defaults to a
+        random seed.
+    trajectory : int
+        Index of the trajectory within the ensemble.
+    """
+
+    def __new__(cls, seed=None, trajectory=0):
+        # random.Random.__new__ takes a single seed in Python 2.
+        return random.Random.__new__(cls)
+
+    def __init__(self, seed=None, trajectory=0):
+        if seed is None:
+            seed = random_seed()
+        # Distinct (seed, trajectory) pairs give distinct generator states.
+        random.Random.__init__(self, ((seed & _MASK64) << 64)
+                               | (trajectory & _MASK64))
+
+    def poisson(self, mean):
+        """
+        Poisson variate with the given mean, 0 if the mean is not positive.
+        Uses the same algorithms as the native engines.
+        """
+        if not mean > 0:
+            return 0
+        mean = float(mean)
+        if mean < 10:
+            # Sequential search of the cumulative distribution.
+            p = math.exp(-mean)
+            cumulative = p
+            u = self.random()
+            k = 0
+            while u > cumulative and k < 1000:
+                k += 1
+                p *= mean / k
+                cumulative += p
+            return k
+
+        # Hormann's transformed rejection with squeeze (PTRS).
+        log_mean = math.log(mean)
+        b = 0.931 + 2.53 * math.sqrt(mean)
+        a = -0.059 + 0.02483 * b
+        inv_alpha = 1.1239 + 1.1328 / (b - 3.4)
+        v_r = 0.9277 - 3.6224 / (b - 2.0)
+        while True:
+            u = self.random() - 0.5
+            v = self.random()
+            us = 0.5 - abs(u)
+            if us == 0:
+                continue
+            k = math.floor((2.0 * a / us + b) * u + mean + 0.43)
+            if us >= 0.07 and v <= v_r:
+                return int(k)
+            if k < 0 or (us < 0.013 and v > us):
+                continue
+            # log(0) is -inf in the native engines.
+            if v == 0 or (math.log(v) + math.log(inv_alpha)
+                          - math.log(a / (us * us) + b)
+                          <= -mean + k * log_mean - math.lgamma(k + 1.0)):
+                return int(k)
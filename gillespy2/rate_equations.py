@@ -0,0 +1,133 @@
+"""
+The reaction rate equations of a CompiledModel for Python integrators.
+
+RateEquations evaluates dx/dt = V^T a(x), V being the stoichiometry matrix
+and a the propensities, in a few vectorized numpy operations over the
+mass-action kernels instead of one eval() per reaction. Its Jacobian
+V^T da/dx is assembled in sparse form from the analytic derivatives of the
+kernels; only propensity functions that are not mass-action go through
+their compiled Python code, and are differentiated numerically. This is
+the fallback of the native ode engine (see native/ode.h).
+"""
+import numpy as np
+
+
+class RateEquations(object):
+    """
+    Right-hand side and Jacobian of the rate equations of a CompiledModel,
+    with the call signatures of scipy.integrate.solve_ivp. Requires scipy.
+    """
+
+    def __init__(self, compiled_model):
+        from scipy import sparse
+        self._sparse = sparse
+        m = compiled_model
+        self.num_species = m.num_species
+        self.num_reactions = m.num_reactions
+
+        # The kernel entries, with the reaction each belongs to.
+        self.kernel_reaction = np.repeat(np.arange(m.num_reactions),
+                                         np.diff(m.kernel_indptr))
+        self.kernel_species = m.kernel_species
+        self.kernel_orders = m.kernel_orders
+        self.max_order = int(m.kernel_orders.max()) if len(m.kernel_orders) else 0
+        self.coefficients = m.rate_coefficients
+
+        # For kernels of two entries, the other one; longer kernels are
+        # handled one by one.
+        self.partner = np.arange(len(self.kernel_species))
+        self.long_kernels = []
+        for r in range(m.num_reactions):
+            begin, end = m.kernel_indptr[r], m.kernel_indptr[r + 1]
+            if end - begin == 2:
+                self.partner[begin] = begin + 1
+                self.partner[begin + 1] = begin
+            elif end - begin > 2:
+                self.long_kernels.append(list(range(begin, end)))
+        self.paired = np.array([m.kernel_indptr[r + 1] - m.kernel_indptr[r] == 2
+                                for r in self.kernel_reaction], dtype=bool)
+
+        # Reactions without a kernel are evaluated by their Python code.
+        self.species = m.species
+        self.coded = [(r, m.propensities.python_code[rname])
+                      for r, rname in enumerate(m.reactions)
+                      if m.program_indptr[r] != m.program_indptr[r + 1]
+                      or rname in m.propensities.unsupported]
+        self.parameters = m.parameters
+        self.namespace = dict(zip(m.parameters, m.parameter_values))
+        self.namespace['vol'] = m.volume
+
+        self.stoichiometry = sparse.csr_matrix(
+            (m.stoich_values, m.stoich_indices, m.stoich_indptr),
+            shape=(m.num_reactions, m.num_species)).T.tocsr()
+
+    def bind(self, parameter_values, rate_coefficients):
+        """
+        Sets the parameter values and the matching mass-action rate
+        coefficients (see CompiledModel.rate_coefficient_matrix) in place,
+        so one RateEquations serves a whole batch of parameter sets.
+        """
+        self.coefficients = np.asarray(rate_coefficients, dtype=np.float64)
+        self.namespace.update(zip(self.parameters, parameter_values))
+
+    def _factors(self, x):
+        """
+        Falling factorials x_i (x_i - 1) ... (x_i - n_k + 1) of the kernel
+        entries and their derivatives.
+        """
+        populations = x[self.kernel_species]
+        value = np.ones(len(populations))
+        derivative = np.zeros(len(populations))
+        for m in range(self.max_order):
+            active = self.kernel_orders > m
+            term = np.where(active, populations - m, 1.0)
+            derivative = derivative * term + np.where(active, value, 0.0)
+            value = value * term
+        return value, derivative
+
+    def _coded_propensity(self, code, x):
+        namespace = dict(self.namespace)
+        namespace.update(zip(self.species, x))
+        return eval(code, namespace)
+
+    def propensities(self, x):
+        """ Returns the propensity of every reaction in state x. """
+        a = np.array(self.coefficients, dtype=np.float64)
+        value, _ = self._factors(x)
+        np.multiply.at(a, self.kernel_reaction, value)
+        for r, code in self.coded:
+            a[r] = self._coded_propensity(code, x)
+        return np.maximum(a, 0.0)
+
+    def rhs(self, t, x):
+        """ dx/dt at state x. """
+        return self.stoichiometry.dot(self.propensities(x))
+
+    def jacobian(self, t, x):
+        """ Sparse (species x species) Jacobian of rhs() at state x. """
+        value, derivative = self._factors(x)
+        others = np.where(self.paired, value[self.partner], 1.0)
+        for entries in self.long_kernels:
+            for k in entries:
+                others[k] = np.prod([value[j] for j in entries if j != k])
+        rows = [self.kernel_reaction]
+        columns = [self.kernel_species]
+        data = [self.coefficients[self.kernel_reaction] * derivative * others]
+
+        for r, code in self.coded:
+            a = self._coded_propensity(code, x)
+            for i in range(self.num_species):
+                delta = 1.5e-8 * max(abs(x[i]), 1.0)
+                shifted = np.array(x, dtype=np.float64)
+                shifted[i] += delta
+                slope = (self._coded_propensity(code, shifted) - a) / delta
+                if slope != 0:
+                    rows.append([r])
+                    columns.append([i])
+                    data.append([slope])
+
+        derivatives = self._sparse.csr_matrix(
+            (np.concatenate(data), (np.concatenate(rows),
+                                    np.concatenate(columns))),
+            shape=(self.num_reactions, self.num_species))
+        return self.stoichiometry.dot(derivatives).tocsc()
@@ -0,0 +1,246 @@
+"""
+Trajectory output buffers shared by the solvers.
+
+Every solver writes an ensemble into one preallocated, C-contiguous
+float64 array of shape (trajectories, timepoints, 1 + species): column 0
+holds the output time and column 1 + i the population of the i-th output
+species, all species in model order unless a subset was requested.
+format_trajectories() hands that buffer out without copying it, either as
+a list of per-trajectory arrays or as a list of labelled dicts whose
+values are column views.
+"""
+import numpy as np
+from .gillespyError import SimulationError, SpeciesError
+
+
+def timeline(t, increment, timepoints=None):
+    """
+    Returns the output times 0, increment, ..., t, or timepoints, any
+    non-empty, non-negative and non-decreasing sequence of times, if given.
+    """
+    if timepoints is None:
+        return np.linspace(0, t, int(round(t / increment)) + 1)
+    times = np.array(timepoints, dtype=np.float64)
+    if len(times) == 0 or times[0] < 0 or np.any(np.diff(times) < 0):
+        raise SimulationError("timepoints must be non-empty, non-negative "
+                              "and non-decreasing.")
+    return times
+
+
+def output_species(model_species, species=None):
+    """
+    Returns the names and the indices in model_species, the names of all
+    species in model order, as an int64 array, of the species to record:
+    species, a list of Species or names, or all of them.
+    """
+    index = dict((name, i) for i, name in enumerate(model_species))
+    if species is None:
+        names = tuple(model_species)
+    else:
+        names = tuple(str(s) for s in species)
+    for name in names:
+        if name not in index:
+            raise SpeciesError("Unknown species '{0}'.".format(name))
+    indices = np.array([index[name] for name in names], dtype=np.int64)
+    return names, indices
+
+
+def allocate_trajectories(number_of_trajectories, times, num_species):
+    """
+    Returns an uninitialized output buffer for number_of_trajectories
+    trajectories of num_species species, with the time column filled in.
+    """
+    trajectories = np.empty((number_of_trajectories, len(times),
+                             1 + num_species))
+    trajectories[:, :, 0] = times
+    return trajectories
+
+
+def format_trajectories(trajectories, species, show_labels):
+    """
+    Returns the output buffer as a list of arrays of shape
+    (timepoints, 1 + species), or, if show_labels is set, as a list of
+    dicts keyed by 'time' and the species names. Both share memory with
+    trajectories.
+    """
+    if show_labels:
+        results = []
+        for trajectory in trajectories:
+            labelled = {'time': trajectory[:, 0]}
+            for i, s in enumerate(species):
+                labelled[s] = trajectory[:, i + 1]
+            results.append(labelled)
+        return results
+    return list(trajectories)
+
+
+class EnsembleStatistics(object):
+    """
+    Statistics of an ensemble whose trajectories were not kept, as
+    returned by NativeSSASolver.run_statistics(). They are accumulated one
+    trajectory at a time, so their size does not depend on the number of
+    trajectories.
+
+    Attributes
+    ----------
+    times : numpy ndarray
+        The output times.
+    species : tuple of str
+        The species, in column order.
+    number_of_trajectories : int
+        Size of the ensemble.
+    mean, variance, minimum, maximum : numpy ndarray
+        (timepoints, species) arrays; variance is the sample variance.
+    histogram : numpy ndarray or None
+        (timepoints, species, bins) counts, if requested.
+    histogram_range : numpy ndarray or None
+        (species, 2) bounds of the histograms; values outside fall in the
+        first or last bin.
+    trajectories : list
+        The kept trajectories, formatted like the results of the solvers.
+    """
+
+    def __init__(self, times, species, number_of_trajectories, statistics,
+                 histogram, histogram_range, trajectories):
+        self.times = times
+        self.species = tuple(species)
+        self.number_of_trajectories = number_of_trajectories
+        self.mean, self.variance, self.minimum, self.maximum = statistics
+        self.histogram = histogram
+        self.histogram_range = histogram_range
+        self.trajectories = trajectories
+
+    def std(self):
+        """ Returns the (timepoints, species) standard deviations. """
+        return np.sqrt(self.variance)
+
+    def standard_error(self):
+        """
+        Returns the (timepoints, species) standard errors of the means.
+        """
+        return np.sqrt(self.variance / self.number_of_trajectories)
+
+    def merge(self, other):
+        """
+        Adds the trajectories of other, EnsembleStatistics of the same
+        model, output times and histogram bins, to these statistics, by the
+        pairwise update of Chan, Golub and LeVeque (1979).
+        """
+        n = self.number_of_trajectories
+        m = other.number_of_trajectories
+        total = n + m
+        delta = other.mean - self.mean
+        m2 = (self.variance * max(n - 1, 0) + other.variance * max(m - 1, 0)
+              + delta * delta * (n * m / float(total)))
+        self.mean = self.mean + delta * (m / float(total))
+        self.variance = m2 / max(total - 1, 1)
+        self.minimum = np.minimum(self.minimum, other.minimum)
+        self.maximum = np.maximum(self.maximum, other.maximum)
+        if self.histogram is not None:
+            self.histogram = self.histogram + other.histogram
+        self.trajectories = list(self.trajectories) + list(other.trajectories)
+        self.number_of_trajectories = total
+
+    def quantile(self, q):
+        """
+        Returns the (timepoints, species) q-quantiles, 0 <= q <= 1,
+        interpolated linearly within the histogram bins and clamped to the
+        observed range. Requires a histogram.
+        """
+        if self.histogram is None:
+            raise ValueError("quantiles need a histogram, request "
+                             "histogram_bins")
+        bins = self.histogram.shape[2]
+        low = self.histogram_range[:, 0]
+        width = (self.histogram_range[:, 1] - low) / bins
+        cumulative = np.cumsum(self.histogram, axis=2)
+        target = q * self.number_of_trajectories
+        # First bin whose cumulative count reaches the target.
+        index = np.minimum((cumulative < target).sum(axis=2), bins - 1)
+        after = np.take_along_axis(cumulative, index[:, :, None],
+                                   axis=2)[:, :, 0]
+        count = np.take_along_axis(self.histogram, index[:, :, None],
+                                   axis=2)[:, :, 0]
+        before = after - count
+        fraction = np.where(count > 0,
+                            (target - before) / np.maximum(count, 1), 0.0)
+        value = low + (index + np.clip(fraction, 0.0, 1.0)) * width
+        return np.clip(value, self.minimum, self.maximum)
+
+
+class SolverProfile(object):
+    """
+    What the engine of a native solver did during a run, returned next to
+    its results when the solver is given profile=True. Every trajectory, or
+    lockstep block, counts into memory of its own and the counts are
+    merged as each finishes, so profiling barely slows the engines down.
+
+    Attributes
+    ----------
+    reactions : tuple of str
+        The reactions of the model.
+    firings : dict
+        Number of firings of every reaction, by name: real-valued for
+        NativeCLESolver, and only the exact firings for
+        NativeHybridSolver.
+    events : int
+        Reactions fired one at a time.
+    leaps, rejected_leaps : int
+        Accepted and rejected tau-leaps, Langevin steps or integration
+        steps of the hybrid solver.
+    ssa_bursts : int
+        Bursts of exact steps taken instead of leaps too short to pay off.
+    propensity_evaluations : int
+        Propensities evaluated, counting one per reaction and trajectory
+        in lockstep blocks.
+    selection_time, update_time, recording_time : float
+        Seconds spent choosing the next event or leap, carrying it out
+        and recording the output, summed over the threads. The first two
+        are estimated from one step in 64.
+    trajectory_times : numpy ndarray
+        Wall seconds of every trajectory, in ensemble order and point by
+        point for sweeps. The trajectories of a lockstep block share its
+        time evenly.
+    """
+
+    _COUNTERS = ('events', 'leaps', 'rejected_leaps', 'ssa_bursts',
+                 'propensity_evaluations')
+    _TIMES = ('selection_time', 'update_time', 'recording_time')
+
+    def __init__(self, reactions, counters, trajectory_times):
+        self.reactions = tuple(reactions)
+        self.firings = dict(zip(self.reactions, counters['firings']))
+        for name in self._COUNTERS + self._TIMES:
+            setattr(self, name, counters[name])
+        self.trajectory_times = trajectory_times
+
+    @property
+    def number_of_trajectories(self):
+        return len(self.trajectory_times)
+
+    def merge(self, other):
+        """
+        Adds the counts and times of other, the SolverProfile of another
+        run of the same model, to this one.
+        """
+        for name in self.reactions:
+            self.firings[name] += other.firings[name]
+        for name in self._COUNTERS + self._TIMES:
+            setattr(self, name, getattr(self, name) + getattr(other, name))
+        self.trajectory_times = np.concatenate([self.trajectory_times,
+                                                other.trajectory_times])
+
+    def __str__(self):
+        n = self.number_of_trajectories
+        wall = float(sum(self.trajectory_times))
+        lines = ["{0} trajectories, {1:.6g} s ({2:.6g} s each, {3:.6g} s "
+                 "at most)".format(n, wall, wall / n if n else 0.0,
+                                   max(self.trajectory_times) if n else 0.0)]
+        lines.extend("{0}: {1}".format(name, getattr(self, name))
+                     for name in self._COUNTERS)
+        lines.extend("{0}: {1:.6g} s".format(name, getattr(self, name))
+                     for name in self._TIMES)
+        busiest = sorted(self.reactions, key=lambda r: -self.firings[r])
+        lines.append("firings: " + ", ".join(
+            "{0} {1:.6g}".format(r, self.firings[r]) for r in busiest[:10]))
+        return "\n".join(lines)
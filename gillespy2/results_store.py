@@ -0,0 +1,277 @@
+"""
+Chunked on-disk storage of trajectory ensembles larger than memory.
+
+A ResultsStore is a directory in the Zarr format, version 2, written
+without compression so that every chunk is a plain file of little-endian
+float64 values which is memory mapped for reading. zarr, dask or xarray
+open it as it is. It holds
+
+  - trajectories: the (trajectories x timepoints x columns) ensemble,
+    column 0 being the time and the others the species, in chunks of a
+    few trajectories, a window of timepoints and a few columns, so that
+    reading one species or one time window touches only its chunks;
+  - times: the output times;
+  - .zattrs: the metadata of the run, the column labels, the solver, the
+    seed, the first trajectory, the solver options and, for Models, the
+    StochML of the model.
+
+The native solvers write it batch by batch as trajectories finish, given
+a store path (see NativeSSASolver).
+"""
+import json
+import os
+import numpy as np
+from .gillespyError import *
+
+_ARRAY = 'trajectories'
+_TIMES = 'times'
+
+# Chunks are sized to about this many bytes by default.
+CHUNK_BYTES = 1 << 20
+# Default chunk extent along the time axis.
+TIME_CHUNK = 1024
+# Trajectories are simulated in batches of about this many bytes before
+# they are written.
+BATCH_BYTES = 64 << 20
+
+
+def default_chunks(number_of_trajectories, num_times, num_columns):
+    """
+    Returns the default (trajectories, timepoints, columns) chunk shape:
+    one column, up to TIME_CHUNK timepoints and enough trajectories for
+    CHUNK_BYTES.
+    """
+    times = max(1, min(num_times, TIME_CHUNK))
+    trajectories = max(1, min(number_of_trajectories,
+                              CHUNK_BYTES // (8 * times)))
+    return (trajectories, times, 1)
+
+
+def _write_json(path, values):
+    with open(path, 'w') as f:
+        json.dump(values, f, indent=2, sort_keys=True)
+
+
+def _read_json(path):
+    with open(path) as f:
+        return json.load(f)
+
+
+def _zarray(shape, chunks):
+    return {'zarr_format': 2, 'shape': list(shape), 'chunks': list(chunks),
+            'dtype': '<f8', 'compressor': None, 'fill_value': 'NaN',
+            'order': 'C', 'filters': None}
+
+
+def _chunk_ranges(begin, end, size):
+    """
+    Returns (chunk index, first, last) of the chunks of extent size
+    overlapping [begin, end), the bounds relative to the chunk.
+    """
+    ranges = []
+    if end <= begin:
+        return ranges
+    for chunk in range(begin // size, (end - 1) // size + 1):
+        first = max(begin, chunk * size) - chunk * size
+        last = min(end, (chunk + 1) * size) - chunk * size
+        ranges.append((chunk, first, last))
+    return ranges
+
+
+class ResultsStore(object):
+    """
+    Ensemble of trajectories stored in chunks in the directory path, read
+    lazily. Indexing and iteration give (timepoints x columns) arrays, or
+    dicts of column arrays keyed by label if show_labels is set, as for
+    TrajectoryFiles; select() reads any block of trajectories, times and
+    columns.
+
+    Attributes
+    ----------
+    path : str
+        The store directory.
+    labels : tuple of str
+        The column labels, 'time' and the species names.
+    times : numpy ndarray
+        The output times.
+    shape : tuple of int
+        (trajectories, timepoints, columns).
+    chunks : tuple of int
+        The chunk shape.
+    metadata : dict
+        The attributes of the run.
+    show_labels : bool (False)
+        Return labelled dicts instead of arrays.
+    """
+
+    def __init__(self, path, show_labels=False):
+        self.path = path
+        self.show_labels = show_labels
+        array_path = os.path.join(path, _ARRAY)
+        try:
+            zarray = _read_json(os.path.join(array_path, '.zarray'))
+            self.metadata = _read_json(os.path.join(path, '.zattrs'))
+        except (IOError, OSError, ValueError):
+            raise SimulationError("'{0}' is not a results store.".format(
+                path))
+        if zarray.get('dtype') != '<f8' or zarray.get('compressor') \
+                is not None or zarray.get('order') != 'C':
+            raise SimulationError("'{0}' holds an array other than "
+                                  "uncompressed float64 values.".format(path))
+        self.shape = tuple(zarray['shape'])
+        self.chunks = tuple(zarray['chunks'])
+        self.labels = tuple(self.metadata['labels'])
+        self.times = self._read_chunk(_TIMES, (0,), (self.shape[1],)).copy()
+
+    @classmethod
+    def create(self, path, times, labels, number_of_trajectories,
+               chunks=None, metadata=None):
+        """
+        Creates an empty store for number_of_trajectories trajectories at
+        times with the columns labels, in chunks of the given
+        (trajectories, timepoints, columns) shape, default_chunks() by
+        default. metadata, a dict of JSON values, is stored with the
+        labels. path must not exist yet.
+        """
+        if os.path.exists(path):
+            raise SimulationError("'{0}' already exists.".format(path))
+        shape = (number_of_trajectories, len(times), len(labels))
+        if chunks is None:
+            chunks = default_chunks(*shape)
+        chunks = tuple(int(c) for c in chunks)
+        if len(chunks) != 3 or min(chunks) < 1:
+            raise SimulationError("chunks must be three positive sizes.")
+
+        os.makedirs(os.path.join(path, _ARRAY))
+        os.makedirs(os.path.join(path, _TIMES))
+        _write_json(os.path.join(path, '.zgroup'), {'zarr_format': 2})
+        _write_json(os.path.join(path, '.zattrs'),
+                    dict(metadata or {}, labels=list(labels)))
+        _write_json(os.path.join(path, _ARRAY, '.zarray'),
+                    _zarray(shape, chunks))
+        _write_json(os.path.join(path, _TIMES, '.zarray'),
+                    _zarray((len(times),), (len(times),)))
+        np.ascontiguousarray(times, dtype='<f8').tofile(
+            os.path.join(path, _TIMES, '0'))
+        return self(path)
+
+    def write(self, first_trajectory, trajectories):
+        """
+        Writes trajectories, a (trajectories x timepoints x columns) array,
+        as trajectories first_trajectory, first_trajectory + 1, ... of the
+        store. first_trajectory must start a chunk, and the block must
+        fill its chunks, except at the end of the store.
+        """
+        count = len(trajectories)
+        size = self.chunks[0]
+        if first_trajectory % size or (count % size and
+                                       first_trajectory + count !=
+                                       self.shape[0]):
+            raise SimulationError("Trajectories must be written in whole "
+                                  "chunks.")
+        for chunk, _, last in _chunk_ranges(first_trajectory,
+                                            first_trajectory + count, size):
+            rows = chunk * size - first_trajectory
+            for j, t0, t1 in _chunk_ranges(0, self.shape[1], self.chunks[1]):
+                for k, c0, c1 in _chunk_ranges(0, self.shape[2],
+                                               self.chunks[2]):
+                    block = np.empty(self.chunks)
+                    block[:] = np.nan
+                    time = j * self.chunks[1]
+                    column = k * self.chunks[2]
+                    block[:last, :t1, :c1] = trajectories[
+                        rows:rows + last, time:time + t1,
+                        column:column + c1]
+                    block.tofile(self._chunk_path(_ARRAY, (chunk, j, k)))
+
+    def batch_trajectories(self):
+        """
+        Returns how many trajectories to simulate between writes: whole
+        chunks of them, of about BATCH_BYTES.
+        """
+        size = self.chunks[0]
+        trajectory_bytes = 8 * self.shape[1] * self.shape[2]
+        return size * max(1, BATCH_BYTES // (trajectory_bytes * size))
+
+    def select(self, trajectories=None, times=None, species=None):
+        """
+        Returns a (trajectories x timepoints x columns) array of the
+        trajectories in the slice trajectories, the output times in the
+        window times, a (start, stop) pair of times, inclusive, and the
+        columns of species, a list of labels, all of them by default.
+        Only the chunks holding them are read.
+        """
+        r0, r1, step = (trajectories or slice(None)).indices(self.shape[0])
+        if step != 1:
+            raise SimulationError("trajectories must be a contiguous slice.")
+        r1 = max(r0, r1)
+        t0, t1 = 0, self.shape[1]
+        if times is not None:
+            t0 = int(np.searchsorted(self.times, times[0], 'left'))
+            t1 = max(t0, int(np.searchsorted(self.times, times[1], 'right')))
+        if species is None:
+            columns = list(range(self.shape[2]))
+        else:
+            index = dict((label, n) for n, label in enumerate(self.labels))
+            missing = [str(s) for s in species if str(s) not in index]
+            if missing:
+                raise SpeciesError("Unknown species '{0}'.".format(
+                    missing[0]))
+            columns = [index[str(s)] for s in species]
+
+        out = np.empty((r1 - r0, t1 - t0, len(columns)))
+        for i, a0, a1 in _chunk_ranges(r0, r1, self.chunks[0]):
+            row = i * self.chunks[0] + a0 - r0
+            for j, b0, b1 in _chunk_ranges(t0, t1, self.chunks[1]):
+                time = j * self.chunks[1] + b0 - t0
+                mapped = {}
+                for n, column in enumerate(columns):
+                    k = column // self.chunks[2]
+                    if k not in mapped:
+                        mapped[k] = self._read_chunk(_ARRAY, (i, j, k),
+                                                     self.chunks)
+                    out[row:row + a1 - a0, time:time + b1 - b0, n] = \
+                        mapped[k][a0:a1, b0:b1, column - k * self.chunks[2]]
+        return out
+
+    def array(self):
+        """
+        Returns the whole ensemble in one (trajectories x timepoints x
+        columns) array.
+        """
+        return self.select()
+
+    def __len__(self):
+        return self.shape[0]
+
+    def __getitem__(self, index):
+        if isinstance(index, slice):
+            return [self[i] for i in range(*index.indices(len(self)))]
+        if index < 0:
+            index += len(self)
+        if not 0 <= index < len(self):
+            raise IndexError("trajectory index out of range")
+        trajectory = self.select(slice(index, index + 1))[0]
+        if not self.show_labels:
+            return trajectory
+        return dict((label, trajectory[:, n])
+                    for n, label in enumerate(self.labels))
+
+    def __iter__(self):
+        for i in range(len(self)):
+            yield self[i]
+
+    def _chunk_path(self, name, index):
+        return os.path.join(self.path, name, '.'.join(str(k) for k in index))
+
+    def _read_chunk(self, name, index, shape):
+        """
+        Memory maps a chunk, or returns it filled with NaN if it was never
+        written.
+        """
+        path = self._chunk_path(name, index)
+        if not os.path.exists(path):
+            missing = np.empty(shape)
+            missing[:] = np.nan
+            return missing
+        return np.memmap(path, dtype='<f8', mode='r', shape=shape)
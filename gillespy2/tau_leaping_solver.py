@@ -1,25 +1,35 @@
 import gillespy2
 from .gillespySolver import GillesPySolver
+from .parallel import run_trajectories
+from .random_streams import TrajectoryRandom, random_seed
+from .results import (timeline, output_species, allocate_trajectories,
+                      format_trajectories)
 from .basic_ssa_solver import BasicSSASolver
-import random
+from .propensity_compiler import compile_propensities
 import math
-import numpy as np
 import sys
 
 class TauLeapingSolver(GillesPySolver):
-    """ TODO
+    """
+    Tau-leaping with the step size selection of Cao et al. (2006), in pure
+    Python. When the leap would be shorter than SSAThreshold mean reaction
+    waiting times, a burst of SSASteps exact SSA steps is taken on the
+    same state instead, and epsilon is lowered while many leaps fail.
     """
     # initializes the various variables needed for tau leaping algorithm
     @classmethod
     def initialize(self):
         self.curr_state['vol'] = self.model.volume
-        self.results['time'] = []
         self.currentTime = 0
         self.outputTime = 0      
+        self.entryCount = 0
         self.nextTime = 0
         self.listOfCriticalSpecies = []
         self.listOfNonCriticalSpecies = []
         self.failedLeaps = 0
+        self.epsilon = self.maxEpsilon
+        self.leapCount = 0
+        self.rejectedLeaps = 0
 
         for parameter in self.model.listOfParameters:
             self.curr_state[parameter] = self.model.listOfParameters[parameter].value        
@@ -27,7 +37,6 @@ class TauLeapingSolver(GillesPySolver):
         for species in self.model.listOfSpecies:
             # Initialize species populations
             self.curr_state[species] = self.model.listOfSpecies[species].initial_value    
-            self.results[species]=[]
             self.listOfAffectedReactions[species] = [] 
             self.listOfNonCriticalSpecies.append(species) # default all species to non-critical
         
@@ -39,6 +48,20 @@ class TauLeapingSolver(GillesPySolver):
             self.previousReactionCounts[reaction] = []
 
 
+    # record the current state at the next output time
+    @classmethod
+    def recordState(self):
+        self.trajectory[self.entryCount, 1:] = [
+            self.curr_state[species] for species in self.outputSpecies]
+        self.entryCount += 1
+
+    # record the current state at every output time it has reached
+    @classmethod
+    def recordOutput(self):
+        while (self.entryCount < len(self.times)
+               and self.currentTime >= self.times[self.entryCount]):
+            self.recordState()
+
     # update which reactions are critical
     @classmethod
     def updateCriticalLists(self):
@@ -86,7 +109,7 @@ class TauLeapingSolver(GillesPySolver):
             if self.isCritical[reaction]:
                 self.criticalPropensitySum += self.propensities[reaction]
         if self.criticalPropensitySum != 0.0:
-            self.criticalStepsize = -1*math.log(random.random())/self.criticalPropensitySum
+            self.criticalStepsize = -1*math.log(self.random.random())/self.criticalPropensitySum
         else:
             self.criticalStepsize = -1
        
@@ -99,14 +122,15 @@ class TauLeapingSolver(GillesPySolver):
             sigmaSquared[species] = 0
         for reaction in self.model.listOfReactions:
             if not self.isCritical[reaction]:
+                # net change of each species when the reaction fires
+                change = {}
                 for product in self.model.listOfReactions[reaction].products:
-                    mu[str(product)] += self.model.listOfReactions[reaction].products.get(product, 0) * self.propensities[reaction]
-                    sigmaSquared[str(product)] += self.model.listOfReactions[reaction].products.get(product, 0)
+                    change[str(product)] = change.get(str(product), 0) + self.model.listOfReactions[reaction].products[product]
                 for reactant in self.model.listOfReactions[reaction].reactants:
-                    mu[str(reactant)] -= self.model.listOfReactions[reaction].reactants.get(reactant, 0) * self.propensities[reaction]
-                    sigmaSquared[str(reactant)] -= self.model.listOfReactions[reaction].reactants.get(reactant, 0)
-                for species in sigmaSquared:
-                    sigmaSquared[species] = sigmaSquared[species] * sigmaSquared[species] * self.propensities[reaction]
+                    change[str(reactant)] = change.get(str(reactant), 0) - self.model.listOfReactions[reaction].reactants[reactant]
+                for species in change:
+                    mu[species] += change[species] * self.propensities[reaction]
+                    sigmaSquared[species] += change[species] * change[species] * self.propensities[reaction]
         self.noncriticalStepsize = sys.maxsize
         g = 3.0 # should improve
         for species in self.model.listOfSpecies:
@@ -132,7 +156,7 @@ class TauLeapingSolver(GillesPySolver):
             # for critical reactions
             self.criticalReaction = None
             # generate uniform random number between 0 and criticalPropensitySum
-            reactionNum = random.uniform(0, self.criticalPropensitySum)
+            reactionNum = self.random.uniform(0, self.criticalPropensitySum)
             jsum = 0
             for reaction in self.model.listOfReactions:
                 # for critical reactions
@@ -143,14 +167,14 @@ class TauLeapingSolver(GillesPySolver):
                        jsum += self.propensities[reaction]
                 # for noncritical reactions
                 else:
-                    self.previousReactionCounts[reaction] = np.random.poisson(self.propensities[reaction]*self.tau)
+                    self.previousReactionCounts[reaction] = self.random.poisson(self.propensities[reaction]*self.tau)
         else:
             # handle only noncritical reactions
             for reaction in self.model.listOfReactions:
                 if self.isCritical[reaction]:
                     self.previousReactionCounts[reaction] = 0
                 else:
-                    self.previousReactionCounts[reaction] = np.random.poisson(self.propensities[reaction]*self.tau)
+                    self.previousReactionCounts[reaction] = self.random.poisson(self.propensities[reaction]*self.tau)
         #reactionsLastLeap = norm of self.previousReactionCounts -- for after selectTau is working
 
     # simmulates the reaction firings
@@ -196,46 +220,126 @@ class TauLeapingSolver(GillesPySolver):
         else:
             self.leapFailed = False
 
+    # runs a burst of exact SSA steps on the current state, recording the
+    # outputs passed on the way
+    @classmethod
+    def runSSA(self):
+        for step in range(self.SSASteps):
+            propensitySum = 0
+            for reaction in self.model.listOfReactions:
+                self.propensities[reaction] = eval(self.propensity_code[reaction], self.curr_state)
+                propensitySum += self.propensities[reaction]
+            if propensitySum <= 0:
+                return
+            nextTime = self.currentTime - math.log(1 - self.random.random())/propensitySum
+            # the current state holds until the next firing time
+            while self.entryCount < len(self.times) and self.times[self.entryCount] < nextTime:
+                self.recordState()
+            if self.entryCount == len(self.times):
+                return
+            # select and fire one reaction
+            reactionNum = self.random.random()*propensitySum
+            jsum = 0
+            for reaction in self.model.listOfReactions:
+                if self.propensities[reaction] > 0:
+                    firing = reaction
+                    jsum += self.propensities[reaction]
+                    if jsum > reactionNum:
+                        break
+            for reactant in self.model.listOfReactions[firing].reactants:
+                self.curr_state[str(reactant)] -= self.model.listOfReactions[firing].reactants[reactant]
+            for product in self.model.listOfReactions[firing].products:
+                self.curr_state[str(product)] += self.model.listOfReactions[firing].products[product]
+            self.currentTime = nextTime
+
+    # adapts epsilon to the rate of rejected leaps: after every epsilonWindow
+    # leaps it is halved if more than a tenth of them failed, and doubled back
+    # towards maxEpsilon if none did
+    @classmethod
+    def tuneEpsilon(self):
+        self.leapCount += 1
+        if self.leapFailed:
+            self.rejectedLeaps += 1
+        if self.leapCount == self.epsilonWindow:
+            if 10*self.rejectedLeaps > self.leapCount:
+                self.epsilon = max(self.epsilon/2, self.maxEpsilon/64)
+            elif self.rejectedLeaps == 0:
+                self.epsilon = min(self.epsilon*2, self.maxEpsilon)
+            self.leapCount = 0
+            self.rejectedLeaps = 0
+
     @classmethod
     def run(self, model, t=20, number_of_trajectories=1,
-            increment=0.05, seed=None, debug=False, show_labels=False,stochkit_home=None):
+            increment=0.05, seed=None, debug=False, show_labels=False,stochkit_home=None,
+            cores=1, first_trajectory=0, timepoints=None, species=None):
+        output_names, _ = output_species(list(model.listOfSpecies.keys()),
+                                         species)
+        if seed is None:
+            seed = random_seed()
+        if cores != 1 and number_of_trajectories > 1:
+            trajectories = run_trajectories(self, model, number_of_trajectories,
+                                            cores=cores, seed=seed,
+                                            first_trajectory=first_trajectory,
+                                            t=t, increment=increment,
+                                            debug=debug, timepoints=timepoints,
+                                            species=output_names)
+            return format_trajectories(trajectories, output_names, show_labels)
+
         self.model = model
         self.simulation_data = []
         self.tau = 0
         self.curr_state = {}
         self.propensities = {}
-        self.results = {}
+        self.propensity_code = compile_propensities(model).python_code
+        self.times = timeline(t, increment, timepoints)
+        self.outputSpecies = output_names
+        self.trajectories = allocate_trajectories(number_of_trajectories,
+                                                  self.times,
+                                                  len(output_names))
         self.listOfAffectedReactions = {}
         self.isCritical = {}    # keyed by reaction
         self.criticalThreshold = 5  # threshold for when a species becomes critical
-        self.epsilon = 0.03 # bound on relative change per time step
+        self.maxEpsilon = 0.03 # bound on relative change per time step
+        self.epsilonWindow = 20 # number of leaps between adjustments of epsilon
         self.previousReactionCounts = {}
         self.populationChange = {}
         self.criticalStepsize = 0
         self.nonCriticalStepsize = 0
-        self.SSAThreshold = .005
+        self.SSAThreshold = 10 # do SSA when tau is below this many mean waiting times
+        self.SSASteps = 100 # number of SSA steps taken before leaping again
 
         for traj_num in range(number_of_trajectories):
             # initialize everything
+            self.random = TrajectoryRandom(seed, first_trajectory + traj_num)
+            self.trajectory = self.trajectories[traj_num]
             self.initialize()
 
             # run the algorithm
-            while(self.currentTime < t):
-                while self.currentTime >= self.outputTime and self.outputTime < t:
-                    self.results['time'].append(self.outputTime)
-                    for species in self.model.listOfSpecies:
-                        self.results[species].append(self.curr_state[species])
-                    self.outputTime += increment
+            while True:
+                self.recordOutput()
+                if self.entryCount == len(self.times):
+                    break
+                self.outputTime = self.times[self.entryCount]
 
                 # update the lsits of critical species
                 self.updateCriticalLists()
                 
                 # update propensities
+                propensitySum = 0
                 for reaction in self.model.listOfReactions: 
-                    self.propensities[reaction] = eval(self.model.listOfReactions[reaction].propensity_function, self.curr_state)
+                    self.propensities[reaction] = eval(self.propensity_code[reaction], self.curr_state)
+                    propensitySum += self.propensities[reaction]
                 
-                # select the tau
+                # select the tau, halved for every leap that just failed
                 self.selectTau()
+                self.noncriticalStepsize *= 0.5**self.failedLeaps
+
+                # if leaping would not beat exact steps, do SSA
+                if (propensitySum > 0 and self.SSAThreshold > 0
+                        and self.noncriticalStepsize < self.SSAThreshold/propensitySum):
+                    self.runSSA()
+                    self.failedLeaps = 0
+                    continue
       
                 # if we don't need to worry about critical reactions
                 if self.noncriticalStepsize < self.criticalStepsize or self.criticalStepsize == -1:
@@ -253,35 +357,19 @@ class TauLeapingSolver(GillesPySolver):
                 else:
                     self.nextTime = self.currentTime + self.tau
 
-                # if we need to do SSA
-                doSSA = False
-                if doSSA:
-                    # do SSA
-                    1+1
-                    #for species in model.listOfSpecies:
-                        #model.listOfSpecies[species].initial_value = self.curr_state[str(species)]
-                else:
-                    # do tau leaping
+                # do tau leaping
+                self.selectReactions()
+                self.fireReactions()
+                self.tuneEpsilon()
 
-                    self.selectReactions()
-                    self.fireReactions()
-
-                    if self.leapFailed:
-                        self.failedLeaps += 1
-                    else:
-                        self.currentTime = self.nextTime
-                        self.failedLeaps = 0
-
-                    # record output
-                    while self.currentTime >= self.outputTime:
-                        self.results['time'].append(self.outputTime)
-                        for species in self.model.listOfSpecies:
-                            self.results[species].append(self.curr_state[species])
-                        self.outputTime += increment
-                        if self.outputTime >= t:
-                            break
+                if self.leapFailed:
+                    self.failedLeaps += 1
+                else:
+                    self.currentTime = self.nextTime
+                    self.failedLeaps = 0
 
-            return self.results
+        return format_trajectories(self.trajectories, output_names,
+                                   show_labels)
 
     def get_trajectories(self, outdir, debug=False, show_labels=False):
         if show_labels:
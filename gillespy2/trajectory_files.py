@@ -0,0 +1,154 @@
+"""
+Reading and writing directories of trajectory files.
+
+A trajectory directory holds one file per trajectory, trajectory0,
+trajectory1, ..., each a (timepoints x columns) table, in one of two
+formats:
+
+  - text (trajectoryN.txt): whitespace separated values, the first line
+    holding the column labels, as written by StochKit2 with --label;
+  - binary (trajectoryN.bin): raw little-endian float64 values in row
+    major order, with the column labels on the single line of labels.txt
+    in the same directory.
+
+TrajectoryFiles reads either format lazily: a file is read when its
+trajectory is first accessed, binary files are memory mapped, and text is
+parsed by numpy in one call per file rather than line by line in Python.
+"""
+import os
+import re
+import shutil
+import numpy as np
+from .gillespyError import *
+
+_FILE_NAME = re.compile(r'^trajectory(\d+)\.(txt|bin)$')
+LABELS_FILE = 'labels.txt'
+
+
+def save_trajectories(directory, trajectories, labels):
+    """
+    Writes trajectories, a sequence of (timepoints x columns) arrays, to
+    directory in the binary format. labels names the columns.
+    """
+    if not os.path.isdir(directory):
+        os.makedirs(directory)
+    with open(os.path.join(directory, LABELS_FILE), 'w') as f:
+        f.write(' '.join(labels) + '\n')
+    for i, trajectory in enumerate(trajectories):
+        np.ascontiguousarray(trajectory, dtype='<f8').tofile(
+            os.path.join(directory, 'trajectory{0}.bin'.format(i)))
+
+
+def load_trajectory(path, columns):
+    """
+    Reads one trajectory file, memory mapping binary files of columns
+    columns and parsing text files after their line of labels.
+    """
+    if path.endswith('.bin'):
+        size = os.path.getsize(path)
+        if columns == 0 or size % (8 * columns) != 0:
+            raise SimulationError("'{0}' does not hold {1} columns of "
+                                  "float64 values".format(path, columns))
+        return np.memmap(path, dtype='<f8', mode='r',
+                         shape=(size // (8 * columns), columns))
+    with open(path) as f:
+        header = f.readline().split()
+        values = np.fromstring(f.read(), sep=' ')
+    return values.reshape(-1, len(header) or 1)
+
+
+class TrajectoryFiles(object):
+    """
+    Lazily loaded ensemble of the trajectory files in a directory, in
+    trajectory order. Indexing and iteration give (timepoints x columns)
+    arrays, or dicts of column arrays keyed by label if show_labels is
+    set; array() stitches the whole ensemble into one array.
+
+    Attributes
+    ----------
+    directory : str
+        The directory holding the trajectory files.
+    labels : list of str
+        The column labels.
+    show_labels : bool (False)
+        Return labelled dicts instead of arrays.
+    cleanup_directory : str
+        Optional directory removed by close(), or when the ensemble is
+        garbage collected.
+    """
+
+    def __init__(self, directory, show_labels=False, cleanup_directory=None):
+        self.directory = directory
+        self.show_labels = show_labels
+        self.cleanup_directory = cleanup_directory
+        self._cache = {}
+
+        files = {}
+        for filename in os.listdir(directory):
+            match = _FILE_NAME.match(filename)
+            if match:
+                files[int(match.group(1))] = filename
+            elif filename != LABELS_FILE:
+                raise SimulationError("Couldn't identify file '{0}' found in "
+                                      "output folder".format(filename))
+        self._files = [os.path.join(directory, files[i])
+                       for i in sorted(files)]
+
+        labels_path = os.path.join(directory, LABELS_FILE)
+        if os.path.isfile(labels_path):
+            with open(labels_path) as f:
+                self.labels = f.readline().split()
+        elif self._files and self._files[0].endswith('.txt'):
+            with open(self._files[0]) as f:
+                self.labels = f.readline().split()
+        else:
+            self.labels = []
+
+    def __len__(self):
+        return len(self._files)
+
+    def __getitem__(self, index):
+        if isinstance(index, slice):
+            return [self[i] for i in range(*index.indices(len(self)))]
+        if index < 0:
+            index += len(self)
+        return self._format(self._load(index))
+
+    def __iter__(self):
+        for i in range(len(self)):
+            yield self[i]
+
+    def array(self):
+        """
+        Returns all trajectories in one (trajectories x timepoints x
+        columns) array.
+        """
+        if not self._files:
+            return np.empty((0, 0, len(self.labels)))
+        first = self._load(0)
+        ensemble = np.empty((len(self),) + first.shape)
+        for i in range(len(self)):
+            ensemble[i] = self._load(i)
+        return ensemble
+
+    def close(self):
+        """ Removes cleanup_directory, if set. """
+        if self.cleanup_directory is not None:
+            shutil.rmtree(self.cleanup_directory, ignore_errors=True)
+            self.cleanup_directory = None
+
+    def __del__(self):
+        self.close()
+
+    def _load(self, index):
+        trajectory = self._cache.get(index)
+        if trajectory is None:
+            trajectory = load_trajectory(self._files[index], len(self.labels))
+            self._cache[index] = trajectory
+        return trajectory
+
+    def _format(self, trajectory):
+        if not self.show_labels:
+            return trajectory
+        return dict((label, trajectory[:, n])
+                    for n, label in enumerate(self.labels))
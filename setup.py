@@ -1,8 +1,9 @@
-from setuptools import setup
+from setuptools import setup, Extension
 from setuptools.command.develop import develop
 from setuptools.command.install import install
 from setuptools.command.bdist_egg import bdist_egg
 from setuptools.command.easy_install import easy_install
+from setuptools.command.build_ext import build_ext
 import subprocess
 import os
 
@@ -43,10 +44,94 @@ class easy_install_new(easy_install):
 
 
 
+def find_nvcc():
+    """
+    Returns the path of the CUDA compiler, from CUDA_HOME or the PATH, or
+    None if there is none.
+    """
+    directories = os.environ.get('PATH', '').split(os.pathsep)
+    if os.environ.get('CUDA_HOME'):
+        directories.insert(0, os.path.join(os.environ['CUDA_HOME'], 'bin'))
+    for directory in directories:
+        nvcc = os.path.join(directory, 'nvcc')
+        if os.path.isfile(nvcc) and os.access(nvcc, os.X_OK):
+            return nvcc
+    return None
+
+
+class build_ext_cuda(build_ext):
+    """
+    Builds the extension with the CUDA backend (gillespy2/native/gpu.cu)
+    if nvcc is available, and without it otherwise or if nvcc fails.
+    """
+    def build_extension(self, ext):
+        nvcc = find_nvcc()
+        if ext.name == 'gillespy2._native' and nvcc is not None:
+            self.mkpath(self.build_temp)
+            gpu_object = os.path.join(self.build_temp, 'gpu.o')
+            try:
+                subprocess.check_call([nvcc, '-c', '-O3', '-std=c++11',
+                                       '-fmad=false', '-Xcompiler', '-fPIC',
+                                       '-Igillespy2/native',
+                                       'gillespy2/native/gpu.cu',
+                                       '-o', gpu_object])
+            except (OSError, subprocess.CalledProcessError):
+                print("warning: nvcc failed, building gillespy2._native "
+                      "without the CUDA backend")
+            else:
+                cuda_lib = os.path.join(os.path.dirname(os.path.dirname(nvcc)),
+                                        'lib64')
+                ext.extra_objects.append(gpu_object)
+                ext.define_macros.append(('GILLESPY2_CUDA', None))
+                ext.libraries.append('cudart')
+                ext.library_dirs.append(cuda_lib)
+                ext.runtime_library_dirs.append(cuda_lib)
+        build_ext.build_extension(self, ext)
+
+
+# The native solvers are optional: if the extension fails to build, the
+# pure Python solvers remain available.
+native_extension = Extension('gillespy2._native',
+                             sources = ['gillespy2/native/module.cpp',
+                                        'gillespy2/native/ssa.cpp',
+                                        'gillespy2/native/next_reaction.cpp',
+                                        'gillespy2/native/ode.cpp',
+                                        'gillespy2/native/tau_leaping.cpp',
+                                        'gillespy2/native/hybrid.cpp',
+                                        'gillespy2/native/langevin.cpp',
+                                        'gillespy2/native/lockstep.cpp'],
+                             depends = ['gillespy2/native/device.h',
+                                        'gillespy2/native/ensemble.h',
+                                        'gillespy2/native/gpu.cu',
+                                        'gillespy2/native/gpu.h',
+                                        'gillespy2/native/gpu_ssa.h',
+                                        'gillespy2/native/indexed_heap.h',
+                                        'gillespy2/native/leaping.h',
+                                        'gillespy2/native/lockstep.h',
+                                        'gillespy2/native/model.h',
+                                        'gillespy2/native/ode.h',
+                                        'gillespy2/native/profile.h',
+                                        'gillespy2/native/propensity.h',
+                                        'gillespy2/native/random.h',
+                                        'gillespy2/native/reaction_mask.h',
+                                        'gillespy2/native/selection.h',
+                                        'gillespy2/native/ssa.h',
+                                        'gillespy2/native/statistics.h',
+                                        'gillespy2/native/stoichiometry.h'],
+                             # No FMA contraction anywhere, so that the
+                             # lockstep engines stay bitwise equal to the
+                             # one trajectory engines whatever CFLAGS add.
+                             extra_compile_args = ['-O3', '-std=c++11', '-pthread',
+                                                   '-ffp-contract=off'],
+                             extra_link_args = ['-pthread'],
+                             language = 'c++',
+                             optional = True)
+
 
 setup(name = "gillespy2",
       version = "1.1",
       packages = ['gillespy2'],
+      ext_modules = [native_extension],
       description = 'Python interface for Gillespie style biochemical simulations',
       
       install_requires = ["numpy",
@@ -62,7 +147,8 @@ setup(name = "gillespy2",
 
       download_url = "https://github.com/briandrawert/GillesPy2/tarball/master/",
       
-      cmdclass = {'bdist_egg':bdist_egg_new,
+      cmdclass = {'build_ext':build_ext_cuda,
+                  'bdist_egg':bdist_egg_new,
                   'install':install_new,
                   'develop':develop_new,
                   'easy_install':easy_install_new}
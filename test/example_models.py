@@ -0,0 +1,95 @@
+"""
+Small models shared by the tests.
+"""
+import numpy as np
+import gillespy2
+
+
+def dimerization(initial_a=300):
+    """
+    Returns the reversible dimerization 2A <-> B with decay of A, observed
+    at t = 0, 1, ..., 10.
+    """
+    model = gillespy2.Model(name="dimerization")
+    k1 = gillespy2.Parameter(name='k1', expression=0.001)
+    k2 = gillespy2.Parameter(name='k2', expression=0.5)
+    k3 = gillespy2.Parameter(name='k3', expression=0.05)
+    model.add_parameter([k1, k2, k3])
+    A = gillespy2.Species(name='A', initial_value=initial_a)
+    B = gillespy2.Species(name='B', initial_value=0)
+    model.add_species([A, B])
+    model.add_reaction([
+        gillespy2.Reaction(name='forward', reactants={A: 2},
+                           products={B: 1}, rate=k1),
+        gillespy2.Reaction(name='backward', reactants={B: 1},
+                           products={A: 2}, rate=k2),
+        gillespy2.Reaction(name='decay', reactants={A: 1}, products={},
+                           rate=k3)])
+    model.timespan(np.linspace(0, 10, 11))
+    return model
+
+
+def birth_death(num_species, production=10.0, degradation=1.0):
+    """
+    Returns num_species independent birth-death processes, 2 num_species
+    reactions, from empty populations. The population of every species at
+    time t is Poisson distributed with mean
+    production / degradation (1 - exp(-degradation t)).
+    """
+    model = gillespy2.Model(name="birth_death")
+    produce = gillespy2.Parameter(name='produce', expression=production)
+    degrade = gillespy2.Parameter(name='degrade', expression=degradation)
+    model.add_parameter([produce, degrade])
+    species = [gillespy2.Species(name='S{0}'.format(i), initial_value=0)
+               for i in range(num_species)]
+    model.add_species(species)
+    for i, s in enumerate(species):
+        model.add_reaction([
+            gillespy2.Reaction(name='produce{0}'.format(i), reactants={},
+                               products={s: 1}, rate=produce),
+            gillespy2.Reaction(name='degrade{0}'.format(i),
+                               reactants={s: 1}, products={}, rate=degrade)])
+    model.timespan(np.linspace(0, 3, 4))
+    return model
+
+
+def as_lists(trajectories):
+    """ Returns trajectories, arrays, as nested lists for comparison. """
+    return [trajectory.tolist() for trajectory in trajectories]
+
+
+def moments(ensemble):
+    """
+    Returns the (timepoints x species) means and standard errors of the
+    means of ensemble, EnsembleStatistics or a list of trajectories, as
+    nested lists.
+    """
+    if hasattr(ensemble, 'standard_error'):
+        return ensemble.mean.tolist(), ensemble.standard_error().tolist()
+    trajectories = [trajectory.tolist() for trajectory in ensemble]
+    n = float(len(trajectories))
+    means, errors = [], []
+    for rows in zip(*trajectories):
+        columns = list(zip(*rows))[1:]
+        mean = [sum(c) / n for c in columns]
+        variance = [sum((x - m) ** 2 for x in c) / (n - 1)
+                    for c, m in zip(columns, mean)]
+        means.append(mean)
+        errors.append([(v / n) ** 0.5 for v in variance])
+    return means, errors
+
+
+def mean_difference(a, b):
+    """
+    Returns the largest difference between the means of two ensembles, as
+    taken by moments(), in standard errors of the difference.
+    """
+    worst = 0.0
+    (means_a, errors_a), (means_b, errors_b) = moments(a), moments(b)
+    for row in zip(means_a, means_b, errors_a, errors_b):
+        for x, y, e, f in zip(*row):
+            if e > 0 or f > 0:
+                worst = max(worst, abs(x - y) / (e * e + f * f) ** 0.5)
+            elif x != y:
+                return float('inf')
+    return worst
@@ -0,0 +1,101 @@
+import os
+import shutil
+import tempfile
+import unittest
+from gillespy2 import checkpoints
+from gillespy2.gillespyError import SimulationError
+from gillespy2.native_ssa_solver import (isNATIVE, NativeSSASolver,
+                                         NativeTauLeapingSolver)
+from example_models import dimerization, as_lists
+
+
+class Interrupt(Exception):
+    pass
+
+
+@unittest.skipIf(not isNATIVE, "needs the gillespy2._native extension")
+class TestCheckpoints(unittest.TestCase):
+
+    def setUp(self):
+        self.directory = tempfile.mkdtemp()
+        self.path = os.path.join(self.directory, 'checkpoint')
+        self.saved = dict((name, getattr(checkpoints, name)) for name in
+                          ('append_trajectories', 'save_statistics'))
+
+    def tearDown(self):
+        self.restore()
+        shutil.rmtree(self.directory)
+
+    def restore(self):
+        for name, function in self.saved.items():
+            setattr(checkpoints, name, function)
+
+    def interrupt_after(self, batches, name='append_trajectories'):
+        """ Makes the batch-th checkpoint write raise Interrupt. """
+        written = [0]
+        save = self.saved[name]
+
+        def interrupted(*arguments):
+            save(*arguments)
+            written[0] += 1
+            if written[0] == batches:
+                raise Interrupt()
+        setattr(checkpoints, name, interrupted)
+
+    def test_resume_matches_uninterrupted(self):
+        model = dimerization()
+        for solver in (NativeSSASolver, NativeTauLeapingSolver):
+            options = dict(t=3, number_of_trajectories=50, seed=5)
+            self.interrupt_after(3)
+            self.assertRaises(Interrupt, solver.run, model,
+                              checkpoint=self.path, checkpoint_interval=7,
+                              **options)
+            self.restore()
+            self.assertTrue(os.path.exists(self.path))
+            resumed = solver.run(model, checkpoint=self.path,
+                                 checkpoint_interval=7, **options)
+            self.assertEqual(as_lists(resumed),
+                             as_lists(solver.run(model, **options)))
+            self.assertFalse(os.path.exists(self.path))
+
+
+    def test_resume_statistics(self):
+        model = dimerization()
+        options = dict(t=3, number_of_trajectories=50, seed=5,
+                       keep_trajectories=20, histogram_bins=4,
+                       histogram_range=(0, 300), checkpoint_interval=7)
+        self.interrupt_after(2, 'save_statistics')
+        self.assertRaises(Interrupt, NativeSSASolver.run_statistics, model,
+                          checkpoint=self.path, **options)
+        self.restore()
+        resumed = NativeSSASolver.run_statistics(model, checkpoint=self.path,
+                                                 **options)
+        self.assertFalse(os.path.exists(self.path))
+        whole = NativeSSASolver.run_statistics(
+            model, checkpoint=os.path.join(self.directory, 'whole'),
+            **options)
+        self.assertEqual(resumed.number_of_trajectories, 50)
+        for name in ('mean', 'variance', 'minimum', 'maximum', 'histogram'):
+            self.assertEqual(getattr(resumed, name).tolist(),
+                             getattr(whole, name).tolist())
+        self.assertEqual(as_lists(resumed.trajectories),
+                         as_lists(whole.trajectories))
+
+    def test_checkpoint_of_another_run(self):
+        model = dimerization()
+        options = dict(t=3, number_of_trajectories=20, checkpoint=self.path,
+                       checkpoint_interval=5)
+        self.interrupt_after(1)
+        self.assertRaises(Interrupt, NativeSSASolver.run, model, seed=5,
+                          **options)
+        self.restore()
+        with self.assertRaises(SimulationError):
+            NativeSSASolver.run(model, seed=6, **options)
+        with self.assertRaises(SimulationError):
+            NativeSSASolver.run_statistics(model, seed=5, **options)
+        self.assertEqual(len(NativeSSASolver.run(model, seed=5, **options)),
+                         20)
+
+
+if __name__ == '__main__':
+    unittest.main()
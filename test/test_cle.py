@@ -0,0 +1,46 @@
+import unittest
+from gillespy2.gillespyError import SimulationError
+from gillespy2.native_ssa_solver import (isNATIVE, NativeSSASolver,
+                                         NativeCLESolver)
+from example_models import dimerization, as_lists, mean_difference
+
+
+@unittest.skipIf(not isNATIVE, "needs the gillespy2._native extension")
+class TestCLE(unittest.TestCase):
+
+    def test_matches_direct_method(self):
+        model = dimerization(3000)
+        options = dict(t=10, increment=1, number_of_trajectories=200)
+        exact = NativeSSASolver.run(model, seed=1, **options)
+        # Euler-Maruyama is first order; the steps are kept small enough
+        # for its bias in the fast initial transient to be negligible.
+        for steps in (dict(epsilon=0.005), dict(step_size=0.002)):
+            cle = NativeCLESolver.run(model, seed=2, **dict(options, **steps))
+            self.assertLess(mean_difference(exact, cle), 5)
+
+    def test_populations_stay_non_negative(self):
+        # A decays to a handful of molecules, where the noise is large.
+        ensemble = NativeCLESolver.run(dimerization(300), t=100, increment=5,
+                                       number_of_trajectories=20, seed=3)
+        for trajectory in as_lists(ensemble):
+            self.assertEqual(trajectory[-1][0], 100.0)
+            for row in trajectory:
+                self.assertTrue(min(row[1:]) >= 0)
+
+    def test_seed_reproduces(self):
+        model = dimerization(3000)
+        first = NativeCLESolver.run(model, t=5, number_of_trajectories=5,
+                                    seed=4, step_size=0.05)
+        again = NativeCLESolver.run(model, t=5, number_of_trajectories=5,
+                                    seed=4, step_size=0.05)
+        self.assertEqual(as_lists(first), as_lists(again))
+
+    def test_invalid_options(self):
+        for options in (dict(epsilon=0), dict(step_size=0),
+                        dict(step_size=-0.1)):
+            with self.assertRaises(SimulationError):
+                NativeCLESolver.run(dimerization(), t=1, **options)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,58 @@
+import unittest
+from gillespy2 import CompiledModel
+from example_models import dimerization
+
+
+def csr_rows(indptr, indices):
+    indptr, indices = indptr.tolist(), indices.tolist()
+    return [sorted(indices[indptr[r]:indptr[r + 1]])
+            for r in range(len(indptr) - 1)]
+
+
+class TestCompiledModel(unittest.TestCase):
+
+    def test_indices(self):
+        compiled = CompiledModel(dimerization(300))
+        self.assertEqual(compiled.species, ('A', 'B'))
+        self.assertEqual(compiled.parameters, ('k1', 'k2', 'k3'))
+        self.assertEqual(compiled.reactions, ('forward', 'backward', 'decay'))
+        self.assertEqual(compiled.species_index['B'], 1)
+        self.assertEqual(compiled.reaction_index['decay'], 2)
+        self.assertEqual((compiled.num_species, compiled.num_reactions),
+                         (2, 3))
+        self.assertEqual(compiled.initial_state.tolist(), [300.0, 0.0])
+        self.assertEqual(compiled.parameter_values.tolist(),
+                         [0.001, 0.5, 0.05])
+
+    def test_stoichiometry(self):
+        compiled = CompiledModel(dimerization())
+        self.assertEqual(compiled.stoichiometry_matrix().tolist(),
+                         [[-2.0, 1.0], [2.0, -1.0], [-1.0, 0.0]])
+        self.assertEqual(csr_rows(compiled.reactant_indptr,
+                                  compiled.reactant_indices),
+                         [[0], [1], [0]])
+        self.assertEqual(compiled.reactant_values.tolist(), [2, 1, 1])
+        self.assertEqual(compiled.net_changes()['forward'],
+                         [('A', -2), ('B', 1)])
+
+    def test_dependency_graph(self):
+        compiled = CompiledModel(dimerization())
+        # forward and backward change A and B, read by every propensity;
+        # decay only changes A, which backward does not read.
+        self.assertEqual(csr_rows(compiled.dependency_indptr,
+                                  compiled.dependency_indices),
+                         [[0, 1, 2], [0, 1, 2], [0, 2]])
+
+    def test_shared_topology(self):
+        first = CompiledModel(dimerization(300))
+        second = CompiledModel(dimerization(20))
+        self.assertTrue(first.stoich_indptr is second.stoich_indptr)
+        self.assertEqual(second.initial_state.tolist(), [20.0, 0.0])
+
+    def test_read_only(self):
+        compiled = CompiledModel(dimerization())
+        self.assertRaises(AttributeError, setattr, compiled, 'volume', 2.0)
+
+
+if __name__ == '__main__':
+    unittest.main()
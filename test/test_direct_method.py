@@ -0,0 +1,51 @@
+import unittest
+from gillespy2 import BasicSSASolver
+from gillespy2.native_ssa_solver import isNATIVE, NativeSSASolver
+from example_models import dimerization, as_lists, mean_difference
+
+
+@unittest.skipIf(not isNATIVE, "needs the gillespy2._native extension")
+class TestDirectMethod(unittest.TestCase):
+
+    def test_format(self):
+        model = dimerization()
+        ensemble = NativeSSASolver.run(model, t=2, increment=0.5,
+                                       number_of_trajectories=3, seed=1)
+        self.assertEqual(len(ensemble), 3)
+        for trajectory in ensemble:
+            self.assertEqual(trajectory.shape, (5, 3))
+            self.assertEqual(trajectory[:, 0].tolist(),
+                             [0.0, 0.5, 1.0, 1.5, 2.0])
+            self.assertEqual(trajectory[0, 1:].tolist(), [300.0, 0.0])
+            for row in trajectory.tolist():
+                for population in row[1:]:
+                    self.assertTrue(population >= 0)
+                    self.assertEqual(population, int(population))
+        labelled = NativeSSASolver.run(model, t=2, increment=0.5,
+                                       number_of_trajectories=3, seed=1,
+                                       show_labels=True)
+        self.assertEqual(sorted(labelled[0]), ['A', 'B', 'time'])
+        self.assertEqual(labelled[2]['B'].tolist(),
+                         ensemble[2][:, 2].tolist())
+
+    def test_seed_reproduces(self):
+        model = dimerization()
+        first = NativeSSASolver.run(model, t=5, number_of_trajectories=5,
+                                    seed=3)
+        again = NativeSSASolver.run(model, t=5, number_of_trajectories=5,
+                                    seed=3)
+        other = NativeSSASolver.run(model, t=5, number_of_trajectories=5,
+                                    seed=4)
+        self.assertEqual(as_lists(first), as_lists(again))
+        self.assertNotEqual(as_lists(first), as_lists(other))
+
+    def test_matches_python_solver(self):
+        model = dimerization()
+        options = dict(t=5, increment=1, number_of_trajectories=100)
+        native = NativeSSASolver.run(model, seed=2, **options)
+        python = BasicSSASolver.run(model, seed=2, **options)
+        self.assertLess(mean_difference(native, python), 5)
+
+
+if __name__ == '__main__':
+    unittest.main()
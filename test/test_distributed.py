@@ -0,0 +1,138 @@
+import unittest
+from gillespy2 import distributed
+from gillespy2.basic_ssa_solver import BasicSSASolver
+from gillespy2.gillespyError import SimulationError
+from gillespy2.native_ssa_solver import isNATIVE, NativeSSASolver
+from example_models import dimerization, as_lists
+
+
+def flatten(array):
+    return [value for row in array.tolist() for value in row]
+
+
+class Future(object):
+
+    def __init__(self, value):
+        self.value = value
+
+    def result(self):
+        return self.value
+
+
+class SerialExecutor(object):
+    """ Runs the submitted shards at once, recording their arguments. """
+
+    def __init__(self):
+        self.shards = []
+
+    def submit(self, function, *args):
+        self.shards.append(args[-1])
+        return Future(function(*args))
+
+
+class TestShardRanges(unittest.TestCase):
+
+    def test_aligned_and_even(self):
+        self.assertEqual(distributed.shard_ranges(300, 4),
+                         [(0, 64), (64, 64), (128, 64), (192, 108)])
+        self.assertEqual(distributed.shard_ranges(10, 4), [(0, 10)])
+        self.assertEqual(distributed.shard_ranges(0, 3), [(0, 0)])
+
+    def test_covers_ensemble(self):
+        for number_of_trajectories in (1, 63, 64, 65, 1000):
+            for shards in (1, 2, 3, 7):
+                ranges = distributed.shard_ranges(number_of_trajectories,
+                                                  shards)
+                self.assertTrue(len(ranges) <= shards)
+                begin = 0
+                for first, count in ranges:
+                    self.assertEqual(first, begin)
+                    self.assertEqual(first % distributed.SHARD_ALIGNMENT, 0)
+                    begin += count
+                self.assertEqual(begin, number_of_trajectories)
+
+    def test_shards_at_least_one(self):
+        self.assertRaises(SimulationError, distributed.shard_ranges, 10, 0)
+
+
+@unittest.skipIf(not isNATIVE, "needs the gillespy2._native extension")
+class TestStatisticsMerge(unittest.TestCase):
+
+    def test_merge_matches_whole_ensemble(self):
+        model = dimerization()
+        options = dict(t=3, seed=5, keep_trajectories=10, histogram_bins=4,
+                       histogram_range=(0, 400))
+        whole = NativeSSASolver.run_statistics(
+            model, number_of_trajectories=200, **options)
+        merged = None
+        for first, count in distributed.shard_ranges(200, 3):
+            shard = NativeSSASolver.run_statistics(
+                model, number_of_trajectories=count, first_trajectory=first,
+                **options)
+            if merged is None:
+                merged = shard
+            else:
+                merged.merge(shard)
+        self.assertEqual(merged.number_of_trajectories, 200)
+        for name in ('mean', 'variance'):
+            for a, b in zip(flatten(getattr(merged, name)),
+                            flatten(getattr(whole, name))):
+                self.assertAlmostEqual(a, b, places=9)
+        for name in ('minimum', 'maximum', 'histogram'):
+            self.assertEqual(getattr(merged, name).tolist(),
+                             getattr(whole, name).tolist())
+        self.assertEqual(as_lists(merged.trajectories[:10]),
+                         as_lists(whole.trajectories))
+
+
+@unittest.skipIf(not isNATIVE, "needs the gillespy2._native extension")
+class TestDistributed(unittest.TestCase):
+
+    options = dict(t=3, increment=0.5, seed=4)
+
+    def test_run(self):
+        model = dimerization()
+        executor = SerialExecutor()
+        shards = distributed.run(NativeSSASolver, model, executor, 3,
+                                 number_of_trajectories=150, cores=2,
+                                 **self.options)
+        whole = NativeSSASolver.run(model, number_of_trajectories=150,
+                                    **self.options)
+        self.assertEqual(as_lists(shards), as_lists(whole))
+        self.assertEqual([shard['first_trajectory']
+                          for shard in executor.shards], [0, 64, 128])
+
+    def test_run_statistics(self):
+        model = dimerization()
+        shards = distributed.run_statistics(
+            NativeSSASolver, model, SerialExecutor(), 2,
+            number_of_trajectories=130, keep_trajectories=70, **self.options)
+        whole = NativeSSASolver.run_statistics(
+            model, number_of_trajectories=130, keep_trajectories=70,
+            **self.options)
+        for a, b in zip(flatten(shards.mean), flatten(whole.mean)):
+            self.assertAlmostEqual(a, b, places=9)
+        self.assertEqual(as_lists(shards.trajectories),
+                         as_lists(whole.trajectories))
+
+    def test_run_sweep(self):
+        model = dimerization()
+        for parameters in ({'k2': [0.1, 0.5, 1.0]}, {'k2': [0.1]}):
+            points, results = distributed.run_sweep(
+                NativeSSASolver, model, parameters, SerialExecutor(), 2,
+                number_of_trajectories=70, **self.options)
+            expected_points, expected = NativeSSASolver.run_sweep(
+                model, parameters, number_of_trajectories=70,
+                **self.options)
+            self.assertEqual(points, expected_points)
+            self.assertEqual([as_lists(r) for r in results],
+                             [as_lists(r) for r in expected])
+
+    def test_native_solvers_only(self):
+        with self.assertRaises(SimulationError):
+            distributed.run(BasicSSASolver, dimerization(), SerialExecutor(),
+                            2)
+
+
+if __name__ == '__main__':
+    unittest.main()
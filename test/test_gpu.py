@@ -0,0 +1,49 @@
+import unittest
+from gillespy2.gillespyError import SimulationError
+from gillespy2.native_ssa_solver import (isNATIVE, NativeSSASolver,
+                                         NativeGPUSSASolver)
+from example_models import dimerization, as_lists, mean_difference
+
+if isNATIVE:
+    from gillespy2 import _native
+isGPU = isNATIVE and hasattr(_native, NativeGPUSSASolver.engine)
+
+
+class TestGPU(unittest.TestCase):
+
+    @unittest.skipIf(isGPU, "gillespy2 was built with CUDA")
+    def test_unavailable(self):
+        with self.assertRaises(SimulationError):
+            NativeGPUSSASolver.run(dimerization(), t=1)
+        with self.assertRaises(SimulationError):
+            NativeGPUSSASolver.run_statistics(dimerization(), t=1)
+
+    def test_unsupported_options(self):
+        model = dimerization()
+        with self.assertRaises(SimulationError):
+            NativeGPUSSASolver.run_statistics(model, t=1, histogram_bins=4,
+                                              histogram_range=(0, 300))
+        with self.assertRaises(SimulationError):
+            NativeGPUSSASolver.run_sweep(model, {'k1': [0.001]}, t=1)
+
+    @unittest.skipIf(not isGPU, "needs gillespy2 built with CUDA")
+    def test_matches_direct_method(self):
+        model = dimerization()
+        options = dict(t=10, increment=1, number_of_trajectories=400)
+        direct = NativeSSASolver.run(model, seed=1, **options)
+        gpu = NativeGPUSSASolver.run(model, seed=2, **options)
+        self.assertLess(mean_difference(direct, gpu), 5)
+
+    @unittest.skipIf(not isGPU, "needs gillespy2 built with CUDA")
+    def test_statistics_match_trajectories(self):
+        model = dimerization()
+        options = dict(t=10, increment=1, number_of_trajectories=64, seed=3)
+        trajectories = NativeGPUSSASolver.run(model, **options)
+        again = NativeGPUSSASolver.run(model, **options)
+        self.assertEqual(as_lists(trajectories), as_lists(again))
+        ensemble = NativeGPUSSASolver.run_statistics(model, **options)
+        self.assertLess(mean_difference(ensemble, trajectories), 1e-6)
+
+
+if __name__ == '__main__':
+    unittest.main()
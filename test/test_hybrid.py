@@ -0,0 +1,80 @@
+import math
+import unittest
+import gillespy2
+from gillespy2.native_ssa_solver import (isNATIVE, NativeSSASolver,
+                                         NativeHybridSolver)
+from example_models import dimerization, mean_difference
+
+
+def exchange(model, rate):
+    """ Adds the fast continuous exchange C <-> D to model. """
+    C = gillespy2.Species(name='C', initial_value=5000, mode='continuous')
+    D = gillespy2.Species(name='D', initial_value=5000, mode='continuous')
+    model.add_species([C, D])
+    model.add_reaction([
+        gillespy2.Reaction(name='to_d', reactants={C: 1}, products={D: 1},
+                           rate=rate),
+        gillespy2.Reaction(name='to_c', reactants={D: 1}, products={C: 1},
+                           rate=rate)])
+
+
+@unittest.skipIf(not isNATIVE, "needs the gillespy2._native extension")
+class TestHybrid(unittest.TestCase):
+
+    def test_matches_direct_method(self):
+        model = dimerization(3000)
+        options = dict(t=10, increment=1, number_of_trajectories=200, seed=4)
+        exact = NativeSSASolver.run(model, **options)
+        hybrid = NativeHybridSolver.run(model, **options)
+        self.assertTrue(mean_difference(exact, hybrid) < 5)
+
+    def test_scarce_species_are_whole(self):
+        ensemble = NativeHybridSolver.run(dimerization(3000), t=40,
+                                          number_of_trajectories=4, seed=3)
+        for trajectory in ensemble:
+            for row in trajectory.tolist():
+                for population in row[1:]:
+                    if population < 100:
+                        self.assertEqual(population, math.floor(population))
+
+    def test_negative_continuous_species(self):
+        # Slow firings take the continuous species A below zero while the
+        # fast exchange keeps integrating.
+        model = gillespy2.Model(name="negative")
+        k = gillespy2.Parameter(name='k', expression=2.0)
+        d = gillespy2.Parameter(name='d', expression=1.0)
+        model.add_parameter([k, d])
+        A = gillespy2.Species(name='A', initial_value=1000, mode='continuous')
+        B = gillespy2.Species(name='B', initial_value=0, mode='discrete')
+        model.add_species([A, B])
+        model.add_reaction([
+            gillespy2.Reaction(name='convert', reactants={A: 1},
+                               products={B: 1}, rate=k),
+            gillespy2.Reaction(name='decay', reactants={A: 1}, products={},
+                               rate=d)])
+        exchange(model, d)
+        ensemble = NativeHybridSolver.run(model, t=20,
+                                          number_of_trajectories=5, seed=1)
+        for trajectory in ensemble:
+            self.assertEqual(trajectory[-1, 0], 20.0)
+            self.assertTrue(trajectory[-1, 1] > -1.0)
+
+    def test_propensity_not_vanishing_at_zero(self):
+        model = gillespy2.Model(name="nonvanishing")
+        model.add_parameter([gillespy2.Parameter(name='k', expression=0.1)])
+        A = gillespy2.Species(name='A', initial_value=1000, mode='continuous')
+        model.add_species([A])
+        model.add_reaction([gillespy2.Reaction(
+            name='decay', reactants={A: 1}, products={},
+            propensity_function='k*(A+1000)')])
+        ensemble = NativeHybridSolver.run(model, t=20,
+                                          number_of_trajectories=2, seed=1)
+        # Past zero A keeps following dA/dt = -k (A + 1000).
+        expected = 2000 * math.exp(-2.0) - 1000
+        for trajectory in ensemble:
+            self.assertEqual(trajectory[-1, 0], 20.0)
+            self.assertLess(abs(trajectory[-1, 1] - expected), 50)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,35 @@
+import subprocess
+import sys
+import unittest
+
+DEFERRED = ('matplotlib', 'scipy', 'lxml', 'xml', 'pdb', 'subprocess',
+            'multiprocessing')
+
+
+class TestImport(unittest.TestCase):
+
+    def loaded_after(self, statement):
+        """
+        Returns the top-level packages among DEFERRED that a fresh
+        interpreter has loaded after running statement.
+        """
+        script = ("import sys\n{0}\nprint(' '.join(sorted(set("
+                  "m.split('.')[0] for m in sys.modules) & set({1!r}))))"
+                  ).format(statement, DEFERRED)
+        output = subprocess.check_output([sys.executable, '-c', script])
+        return output.decode().split()
+
+    def test_optional_modules_are_deferred(self):
+        self.assertEqual(self.loaded_after('import gillespy2'), [])
+
+    def test_stochml_loads_etree_on_use(self):
+        statement = ("import gillespy2\n"
+                     "model = gillespy2.Model(name='m')\n"
+                     "model.serialize()")
+        loaded = self.loaded_after(statement)
+        self.assertTrue('lxml' in loaded or 'xml' in loaded)
+        self.assertFalse('matplotlib' in loaded or 'scipy' in loaded)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,39 @@
+import unittest
+from gillespy2.native_ssa_solver import (isNATIVE, NativeTauLeapingSolver,
+                                         NativeCLESolver)
+from example_models import dimerization, birth_death, as_lists
+
+SOLVERS = ((NativeTauLeapingSolver, {}), (NativeCLESolver, {}),
+           (NativeCLESolver, {'step_size': 0.02}))
+
+
+@unittest.skipIf(not isNATIVE, "needs the gillespy2._native extension")
+class TestLockstep(unittest.TestCase):
+
+    def check_models(self, models, **run_options):
+        for model in models:
+            for solver, options in SOLVERS:
+                options = dict(options, t=5, increment=0.5, **run_options)
+                scalar = solver.run(model, lockstep=False, **options)
+                lockstep = solver.run(model, lockstep=True, cores=3,
+                                      **options)
+                self.assertEqual(as_lists(scalar), as_lists(lockstep),
+                                 solver.__name__)
+
+    def test_matches_scalar(self):
+        # 21 trajectories leave a partial block at the end.
+        self.check_models([dimerization(400), birth_death(3)],
+                          number_of_trajectories=21, seed=8)
+
+    def test_first_trajectory(self):
+        model = dimerization(400)
+        for solver, options in SOLVERS:
+            ensemble = solver.run(model, t=5, number_of_trajectories=20,
+                                  seed=8, **options)
+            part = solver.run(model, t=5, number_of_trajectories=9, seed=8,
+                              first_trajectory=5, **options)
+            self.assertEqual(as_lists(ensemble[5:14]), as_lists(part))
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,43 @@
+import unittest
+from gillespy2.native_ssa_solver import (isNATIVE, NativeSSASolver,
+                                         NativeNextReactionSolver)
+from example_models import dimerization, as_lists, mean_difference
+
+
+def final_variances(trajectories):
+    """ Returns the sample variances of the species at the last time. """
+    rows = [trajectory.tolist()[-1][1:] for trajectory in trajectories]
+    n = float(len(rows))
+    means = [sum(c) / n for c in zip(*rows)]
+    return [sum((x - m) ** 2 for x in c) / (n - 1)
+            for c, m in zip(zip(*rows), means)]
+
+
+@unittest.skipIf(not isNATIVE, "needs the gillespy2._native extension")
+class TestNextReaction(unittest.TestCase):
+
+    def test_matches_direct_method(self):
+        model = dimerization()
+        options = dict(t=10, increment=1, number_of_trajectories=400)
+        direct = NativeSSASolver.run(model, seed=1, **options)
+        next_reaction = NativeNextReactionSolver.run(model, seed=2, **options)
+        self.assertLess(mean_difference(direct, next_reaction), 5)
+        # The variances agree within a few of their standard errors too,
+        # about sqrt(2 / n) of the variance for a near-normal population.
+        for a, b in zip(final_variances(direct),
+                        final_variances(next_reaction)):
+            self.assertLess(abs(a - b), 5 * (a + b) / 2 * (2 / 400.0) ** 0.5)
+
+    def test_seed_reproduces(self):
+        model = dimerization()
+        first = NativeNextReactionSolver.run(model, t=5,
+                                             number_of_trajectories=5, seed=3)
+        again = NativeNextReactionSolver.run(model, t=5,
+                                             number_of_trajectories=5, seed=3)
+        self.assertEqual(as_lists(first), as_lists(again))
+        for trajectory in first:
+            self.assertEqual(trajectory[0, 1:].tolist(), [300.0, 0.0])
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,150 @@
+import math
+import unittest
+import numpy as np
+import gillespy2
+from gillespy2.basic_ode_solver import BasicODESolver, isNATIVE
+from gillespy2.gillespyError import ParameterError
+from gillespy2.compiled_model import CompiledModel
+from gillespy2.results import allocate_trajectories, timeline
+from example_models import dimerization
+
+try:
+    from scipy.integrate import solve_ivp
+    isSCIPY = True
+except ImportError:
+    isSCIPY = False
+
+
+def decay(rate=0.5, initial_value=1000):
+    model = gillespy2.Model(name="decay")
+    k = gillespy2.Parameter(name='k', expression=rate)
+    model.add_parameter([k])
+    A = gillespy2.Species(name='A', initial_value=initial_value)
+    model.add_species([A])
+    model.add_reaction([gillespy2.Reaction(name='decay', reactants={A: 1},
+                                           products={}, rate=k)])
+    model.timespan(np.linspace(0, 10, 11))
+    return model
+
+
+def reference_solution(model, t, increment, steps=1000):
+    """
+    Integrates the rate equations of model with classical Runge-Kutta,
+    evaluating the Python propensity code as the pure-Python path does, and
+    returns the states at 0, increment, ..., t.
+    """
+    compiled_model = CompiledModel(model)
+    species = list(compiled_model.species)
+    namespace = dict(zip(compiled_model.parameters,
+                         compiled_model.parameter_values))
+    namespace['vol'] = compiled_model.volume
+    code = compiled_model.propensities.python_code
+    changes = compiled_model.net_changes()
+
+    def rhs(x):
+        namespace.update(zip(species, x))
+        dx = [0.0] * len(x)
+        for rname, change in changes.items():
+            a = eval(code[rname], namespace)
+            for name, n in change:
+                dx[species.index(name)] += n * a
+        return dx
+
+    x = [float(v) for v in compiled_model.initial_state]
+    h = increment / steps
+    states = [[0.0] + x]
+    for k in range(int(round(t / increment))):
+        for _ in range(steps):
+            k1 = rhs(x)
+            k2 = rhs([v + h / 2 * d for v, d in zip(x, k1)])
+            k3 = rhs([v + h / 2 * d for v, d in zip(x, k2)])
+            k4 = rhs([v + h * d for v, d in zip(x, k3)])
+            x = [v + h / 6 * (a + 2 * b + 2 * c + d)
+                 for v, a, b, c, d in zip(x, k1, k2, k3, k4)]
+        states.append([(k + 1) * increment] + x)
+    return states
+
+
+class TestODE(unittest.TestCase):
+
+    @unittest.skipIf(not isNATIVE, "needs the gillespy2._native extension")
+    def test_matches_analytic_solution(self):
+        trajectory = BasicODESolver.run(decay(), t=10, increment=1,
+                                        number_of_trajectories=3)
+        self.assertEqual(len(trajectory), 1)
+        for time, population in trajectory[0].tolist():
+            expected = 1000 * math.exp(-0.5 * time)
+            self.assertLess(abs(population - expected), 1e-4 * expected)
+
+    @unittest.skipIf(not isNATIVE, "needs the gillespy2._native extension")
+    def test_matches_reference_integration(self):
+        model = dimerization(3000)
+        native = BasicODESolver.run(model, t=10, increment=1)[0].tolist()
+        for row, reference in zip(native, reference_solution(model, 10, 1)):
+            for x, y in zip(row, reference):
+                self.assertLess(abs(x - y), 1e-4 * max(abs(y), 1))
+
+    @unittest.skipIf(not isNATIVE, "needs the gillespy2._native extension")
+    def test_stiff_system(self):
+        # The fast reversible dimerization makes the system stiff.
+        model = dimerization(3000)
+        model.listOfParameters['k2'].set_expression(5000.0)
+        model.resolve_parameters()
+        trajectory = BasicODESolver.run(model, t=10, increment=1)[0].tolist()
+        self.assertEqual(trajectory[-1][0], 10.0)
+        for row in trajectory:
+            self.assertTrue(min(row[1:]) >= -1e-6)
+
+    @unittest.skipIf(not (isNATIVE and isSCIPY), "needs scipy")
+    def test_matches_scipy(self):
+        model = dimerization(3000)
+        native = BasicODESolver.run(model, t=10, increment=1)[0].tolist()
+        compiled_model = CompiledModel(model)
+        times = timeline(10, 1, None)
+        trajectories = allocate_trajectories(1, times,
+                                             compiled_model.num_species)
+        BasicODESolver.integrate(
+            BasicODESolver.rate_equations(compiled_model),
+            compiled_model.initial_state, times, trajectories[0], 1e-8,
+            1e-10)
+        for row, reference in zip(native, trajectories[0].tolist()):
+            for x, y in zip(row, reference):
+                self.assertLess(abs(x - y), 1e-4 * max(abs(y), 1))
+
+
+    @unittest.skipIf(not isNATIVE, "needs the gillespy2._native extension")
+    def test_batch_matches_run(self):
+        sets = [[0.001, 0.5], [0.002, 0.1], [0.0005, 2.0]]
+        batch = BasicODESolver.run_batch(dimerization(3000), sets,
+                                         parameter_names=['k1', 'k2'], t=10,
+                                         increment=1, cores=2).tolist()
+        self.assertEqual(len(batch), 3)
+        for (k1, k2), populations in zip(sets, batch):
+            model = dimerization(3000)
+            model.listOfParameters['k1'].set_expression(k1)
+            model.listOfParameters['k2'].set_expression(k2)
+            model.resolve_parameters()
+            single = BasicODESolver.run(model, t=10, increment=1)[0].tolist()
+            self.assertEqual(len(populations), len(single))
+            for row, reference in zip(populations, single):
+                for x, y in zip(row, reference[1:]):
+                    self.assertLess(abs(x - y), 1e-6 * max(abs(y), 1))
+
+    @unittest.skipIf(not isNATIVE, "needs the gillespy2._native extension")
+    def test_batch_parameter_names(self):
+        model = dimerization(3000)
+        default = BasicODESolver.run_batch(model, [[0.001, 0.5, 0.05]], t=2,
+                                           increment=1).tolist()
+        named = BasicODESolver.run_batch(model, [[0.05, 0.5, 0.001]],
+                                         parameter_names=['k3', 'k2', 'k1'],
+                                         t=2, increment=1).tolist()
+        self.assertEqual(default, named)
+        with self.assertRaises(ParameterError):
+            BasicODESolver.run_batch(model, [[1.0]], parameter_names=['k4'])
+        with self.assertRaises(ParameterError):
+            BasicODESolver.run_batch(model, [[1.0, 2.0]],
+                                     parameter_names=['k1'])
+
+
+if __name__ == '__main__':
+    unittest.main()
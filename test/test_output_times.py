@@ -0,0 +1,73 @@
+import unittest
+import numpy as np
+from gillespy2.basic_ode_solver import BasicODESolver
+from gillespy2.basic_ssa_solver import BasicSSASolver
+from gillespy2.gillespyError import SimulationError, SpeciesError
+from gillespy2.gillespySolver import StochKitSolver
+from gillespy2.native_ssa_solver import isNATIVE, NativeSSASolver
+from example_models import dimerization, as_lists
+
+TIMEPOINTS = [0.0, 0.5, 0.5, 2.0, 7.5]
+
+
+class TestOutputTimes(unittest.TestCase):
+
+    def check_selection(self, solver, **options):
+        # The exact solvers draw the same events whatever is recorded, so
+        # the selected times and species are a subset of the full grid.
+        model = dimerization()
+        grid = as_lists(solver.run(model, t=7.5, increment=0.5,
+                                   number_of_trajectories=3, seed=6,
+                                   **options))
+        selected = as_lists(solver.run(model, number_of_trajectories=3,
+                                       seed=6, timepoints=TIMEPOINTS,
+                                       species=['B'], **options))
+        for full, rows in zip(grid, selected):
+            self.assertEqual(rows, [[full[int(time * 2)][0],
+                                     full[int(time * 2)][2]]
+                                    for time in TIMEPOINTS])
+
+    @unittest.skipIf(not isNATIVE, "needs the gillespy2._native extension")
+    def test_native(self):
+        self.check_selection(NativeSSASolver)
+        self.check_selection(NativeSSASolver, cores=2)
+
+    def test_python(self):
+        self.check_selection(BasicSSASolver)
+
+    @unittest.skipIf(not isNATIVE, "needs the gillespy2._native extension")
+    def test_ode(self):
+        model = dimerization()
+        grid = BasicODESolver.run(model, t=7.5, increment=0.5)[0].tolist()
+        selected = BasicODESolver.run(model, timepoints=TIMEPOINTS,
+                                      species=['B', 'A'])[0].tolist()
+        for time, row in zip(TIMEPOINTS, selected):
+            full = grid[int(time * 2)]
+            self.assertEqual(row[0], time)
+            for x, y in zip(row[1:], (full[2], full[1])):
+                self.assertLess(abs(x - y), 1e-4 * max(y, 1))
+
+    @unittest.skipIf(not isNATIVE, "needs the gillespy2._native extension")
+    def test_model_timespan(self):
+        # A timespan that is not evenly spaced is passed on as timepoints.
+        model = dimerization()
+        model.timespan(np.array(TIMEPOINTS))
+        ensemble = model.run(solver=NativeSSASolver, show_labels=False,
+                             seed=1)
+        self.assertEqual([row[0] for row in ensemble[0].tolist()],
+                         TIMEPOINTS)
+
+    @unittest.skipIf(not isNATIVE, "needs the gillespy2._native extension")
+    def test_invalid_selection(self):
+        model = dimerization()
+        for timepoints in ([], [-1.0, 2.0], [1.0, 0.5]):
+            with self.assertRaises(SimulationError):
+                NativeSSASolver.run(model, timepoints=timepoints)
+        with self.assertRaises(SpeciesError):
+            NativeSSASolver.run(model, t=1, species=['C'])
+        with self.assertRaises(SimulationError):
+            StochKitSolver.run(model, t=1, timepoints=TIMEPOINTS)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,37 @@
+import unittest
+from gillespy2 import BasicSSASolver
+from gillespy2.gillespyError import SimulationError
+from gillespy2.tau_leaping_solver import TauLeapingSolver
+from gillespy2.native_ssa_solver import isNATIVE, NativeSSASolver
+from example_models import dimerization, as_lists
+
+
+class TestPythonSolvers(unittest.TestCase):
+
+    def test_independent_of_processes(self):
+        model = dimerization(100)
+        for solver in (BasicSSASolver, TauLeapingSolver):
+            options = dict(t=3, increment=1, number_of_trajectories=4, seed=1)
+            self.assertEqual(as_lists(solver.run(model, cores=1, **options)),
+                             as_lists(solver.run(model, cores=2, **options)),
+                             solver.__name__)
+
+
+@unittest.skipIf(not isNATIVE, "needs the gillespy2._native extension")
+class TestNativeSolvers(unittest.TestCase):
+
+    def test_independent_of_threads(self):
+        model = dimerization()
+        ensembles = [NativeSSASolver.run(model, t=5, number_of_trajectories=30,
+                                         seed=11, cores=cores)
+                     for cores in (1, 2, 4)]
+        self.assertEqual(as_lists(ensembles[0]), as_lists(ensembles[1]))
+        self.assertEqual(as_lists(ensembles[0]), as_lists(ensembles[2]))
+
+    def test_cores_at_least_one(self):
+        self.assertRaises(SimulationError, NativeSSASolver.run,
+                          dimerization(), cores=0)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,93 @@
+import os
+import shutil
+import tempfile
+import unittest
+from gillespy2 import distributed
+from gillespy2.gillespyError import SimulationError
+from gillespy2.native_ssa_solver import (isNATIVE, NativeSSASolver,
+                                         NativeNextReactionSolver,
+                                         NativeTauLeapingSolver,
+                                         NativeGPUSSASolver)
+from example_models import dimerization, as_lists
+from test_distributed import SerialExecutor
+
+COUNTERS = ('events', 'leaps', 'rejected_leaps', 'ssa_bursts',
+            'propensity_evaluations')
+
+
+def counts(profile):
+    """ Returns the counters of profile, which do not depend on timing. """
+    return (dict(profile.firings),
+            [getattr(profile, name) for name in COUNTERS])
+
+
+@unittest.skipIf(not isNATIVE, "needs the gillespy2._native extension")
+class TestProfile(unittest.TestCase):
+
+    options = dict(t=5, increment=0.5, number_of_trajectories=40, seed=2)
+
+    def test_exact_counters(self):
+        model = dimerization()
+        for solver in (NativeSSASolver, NativeNextReactionSolver):
+            plain = solver.run(model, **self.options)
+            results, profile = solver.run(model, profile=True, cores=1,
+                                          **self.options)
+            self.assertEqual(as_lists(results), as_lists(plain))
+            self.assertEqual(sum(profile.firings.values()), profile.events)
+            self.assertTrue(profile.events > 0)
+            self.assertEqual(profile.leaps, 0)
+            self.assertEqual(profile.number_of_trajectories, 40)
+            for name in ('selection_time', 'update_time', 'recording_time'):
+                self.assertTrue(getattr(profile, name) >= 0)
+            _, threaded = solver.run(model, profile=True, cores=4,
+                                     **self.options)
+            self.assertEqual(counts(threaded), counts(profile))
+            self.assertTrue('40 trajectories' in str(profile))
+
+    def test_tau_leaping_counters(self):
+        model = dimerization(3000)
+        _, profile = NativeTauLeapingSolver.run(model, profile=True,
+                                                ssa_threshold=0,
+                                                **self.options)
+        self.assertTrue(profile.leaps > 0)
+        self.assertEqual(profile.ssa_bursts, 0)
+        _, bursts = NativeTauLeapingSolver.run(model, profile=True,
+                                               ssa_threshold=1e6,
+                                               **self.options)
+        self.assertTrue(bursts.ssa_bursts > 0)
+        self.assertTrue(bursts.events > 0)
+
+    def test_merged_profiles(self):
+        model = dimerization()
+        options = dict(self.options, number_of_trajectories=150)
+        _, whole = NativeSSASolver.run(model, profile=True, **options)
+        _, statistics = NativeSSASolver.run_statistics(
+            model, profile=True, keep_trajectories=5, **options)
+        directory = tempfile.mkdtemp()
+        try:
+            _, checkpointed = NativeSSASolver.run_statistics(
+                model, profile=True, keep_trajectories=5,
+                checkpoint_interval=40,
+                checkpoint=os.path.join(directory, 'checkpoint'), **options)
+        finally:
+            shutil.rmtree(directory)
+        _, shards = distributed.run(NativeSSASolver, model, SerialExecutor(),
+                                    3, profile=True, **options)
+        for profile in (statistics, checkpointed, shards):
+            self.assertEqual(counts(profile), counts(whole))
+            self.assertEqual(profile.number_of_trajectories, 150)
+        # Both points have the model's own k2, so each repeats run().
+        _, single = NativeSSASolver.run(model, profile=True, **self.options)
+        _, _, sweep = NativeSSASolver.run_sweep(
+            model, {'k2': [0.5, 0.5]}, profile=True, **self.options)
+        self.assertEqual(sweep.number_of_trajectories, 80)
+        for name in COUNTERS:
+            self.assertEqual(getattr(sweep, name), 2 * getattr(single, name))
+
+    def test_gpu_not_profiled(self):
+        with self.assertRaises(SimulationError):
+            NativeGPUSSASolver.run(dimerization(), t=1, profile=True)
+
+
+if __name__ == '__main__':
+    unittest.main()
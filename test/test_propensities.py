@@ -0,0 +1,87 @@
+import unittest
+import gillespy2
+from gillespy2 import BasicSSASolver
+from gillespy2.native_ssa_solver import isNATIVE, NativeSSASolver
+from gillespy2.propensity_compiler import (compile_propensities,
+                                           CompiledPropensities)
+from example_models import dimerization, as_lists, mean_difference
+
+
+def custom_exchange(propensity_a, propensity_b):
+    """ Returns A <-> B with the given propensity strings. """
+    model = gillespy2.Model(name="exchange")
+    k1 = gillespy2.Parameter(name='k1', expression=0.5)
+    k2 = gillespy2.Parameter(name='k2', expression=0.2)
+    model.add_parameter([k1, k2])
+    A = gillespy2.Species(name='A', initial_value=200)
+    B = gillespy2.Species(name='B', initial_value=0)
+    model.add_species([A, B])
+    model.add_reaction([
+        gillespy2.Reaction(name='to_b', reactants={A: 1}, products={B: 1},
+                           propensity_function=propensity_a),
+        gillespy2.Reaction(name='to_a', reactants={B: 1}, products={A: 1},
+                           propensity_function=propensity_b)])
+    model.timespan([0, 1, 2, 3, 4, 5])
+    return model
+
+
+class TestCompiledPropensities(unittest.TestCase):
+
+    def test_kernels_and_programs(self):
+        compiled = CompiledPropensities(
+            custom_exchange('k1*A', 'k2*max(B - 10, 0)/(1 + A/100.0)'))
+        indptr = compiled.program_indptr.tolist()
+        # A mass-action shaped expression needs no program.
+        self.assertEqual(indptr[1] - indptr[0], 0)
+        self.assertTrue(indptr[2] - indptr[1] > 0)
+        self.assertEqual(compiled.unsupported, {})
+        self.assertEqual(eval(compiled.python_code['to_a'],
+                              dict(A=100, B=30, k2=0.2)),
+                         0.2 * 20 / 2.0)
+
+    def test_unsupported(self):
+        compiled = CompiledPropensities(custom_exchange('k1*A',
+                                                        'k2*gamma(B)'))
+        self.assertEqual(list(compiled.unsupported), ['to_a'])
+
+    def test_cached_by_topology(self):
+        model = dimerization(300)
+        compiled = compile_propensities(model)
+        self.assertTrue(compile_propensities(dimerization(50)) is compiled)
+        changed = dimerization(300)
+        changed.listOfReactions['decay'].propensity_function = 'k3*A*A'
+        self.assertFalse(compile_propensities(changed) is compiled)
+
+
+@unittest.skipIf(not isNATIVE, "needs the gillespy2._native extension")
+class TestNativePropensities(unittest.TestCase):
+
+    def test_mass_action_shape(self):
+        mass_action = custom_exchange('k1*A', 'k2*B')
+        A, B = mass_action.listOfSpecies['A'], mass_action.listOfSpecies['B']
+        reference = gillespy2.Model(name="exchange")
+        reference.add_parameter(list(mass_action.listOfParameters.values()))
+        reference.add_species([A, B])
+        reference.add_reaction([
+            gillespy2.Reaction(name='to_b', reactants={A: 1},
+                               products={B: 1},
+                               rate=mass_action.listOfParameters['k1']),
+            gillespy2.Reaction(name='to_a', reactants={B: 1},
+                               products={A: 1},
+                               rate=mass_action.listOfParameters['k2'])])
+        reference.timespan([0, 1, 2, 3, 4, 5])
+        options = dict(t=5, increment=1, number_of_trajectories=10, seed=6)
+        self.assertEqual(as_lists(NativeSSASolver.run(mass_action,
+                                                      **options)),
+                         as_lists(NativeSSASolver.run(reference, **options)))
+
+    def test_program_matches_python(self):
+        model = custom_exchange('k1*A', 'k2*max(B - 10, 0)/(1 + A/100.0)')
+        options = dict(t=5, increment=1, number_of_trajectories=100, seed=2)
+        native = NativeSSASolver.run(model, **options)
+        python = BasicSSASolver.run(model, **options)
+        self.assertLess(mean_difference(native, python), 5)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,51 @@
+import unittest
+from gillespy2 import BasicSSASolver
+from gillespy2.random_streams import TrajectoryRandom
+from gillespy2.native_ssa_solver import (isNATIVE, NativeSSASolver,
+                                         NativeNextReactionSolver)
+from example_models import dimerization, as_lists
+
+
+class TestTrajectoryRandom(unittest.TestCase):
+
+    def test_keyed_streams(self):
+        draws = [TrajectoryRandom(7, i).random() for i in range(3)]
+        self.assertEqual(draws, [TrajectoryRandom(7, i).random()
+                                 for i in range(3)])
+        self.assertEqual(len(set(draws)), 3)
+        self.assertNotEqual(TrajectoryRandom(8, 0).random(), draws[0])
+
+    def test_poisson(self):
+        stream = TrajectoryRandom(1, 0)
+        for mean in (0.5, 4.0, 50.0):
+            values = [stream.poisson(mean) for _ in range(4000)]
+            average = sum(values) / 4000.0
+            self.assertLess(abs(average - mean), 5 * (mean / 4000.0) ** 0.5)
+        self.assertEqual(stream.poisson(0), 0)
+
+    def test_python_first_trajectory(self):
+        model = dimerization(100)
+        options = dict(t=3, increment=1, seed=5)
+        ensemble = BasicSSASolver.run(model, number_of_trajectories=6,
+                                      **options)
+        part = BasicSSASolver.run(model, number_of_trajectories=2,
+                                  first_trajectory=3, **options)
+        self.assertEqual(as_lists(ensemble[3:5]), as_lists(part))
+
+
+@unittest.skipIf(not isNATIVE, "needs the gillespy2._native extension")
+class TestNativeStreams(unittest.TestCase):
+
+    def test_first_trajectory(self):
+        model = dimerization()
+        for solver in (NativeSSASolver, NativeNextReactionSolver):
+            ensemble = solver.run(model, t=5, number_of_trajectories=30,
+                                  seed=11)
+            part = solver.run(model, t=5, number_of_trajectories=10,
+                              seed=11, first_trajectory=12, cores=3)
+            self.assertEqual(as_lists(ensemble[12:22]), as_lists(part),
+                             solver.__name__)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,41 @@
+import math
+import unittest
+from gillespy2.native_ssa_solver import (isNATIVE, NativeSSASolver,
+                                         NativeNextReactionSolver)
+from example_models import birth_death
+
+
+@unittest.skipIf(not isNATIVE, "needs the gillespy2._native extension")
+class TestReactionSelection(unittest.TestCase):
+
+    def check_poisson(self, ensemble, t):
+        """ The populations at time t pool to Poisson statistics. """
+        mean = 10.0 * (1 - math.exp(-t))
+        values = [v for trajectory in ensemble
+                  for v in trajectory.tolist()[-1][1:]]
+        n = float(len(values))
+        sample_mean = sum(values) / n
+        sample_variance = sum((v - sample_mean) ** 2 for v in values) / (n - 1)
+        self.assertLess(abs(sample_mean - mean), 5 * (mean / n) ** 0.5)
+        self.assertLess(abs(sample_variance - mean),
+                        5 * ((2 * mean * mean + mean) / n) ** 0.5)
+
+    def test_selection_by_size(self):
+        # A linear scan, a sum tree and composition-rejection, by the
+        # number of reactions (see native/ssa.h).
+        for num_species in (5, 50, 600):
+            model = birth_death(num_species)
+            ensemble = NativeSSASolver.run(model, t=3, increment=1,
+                                           number_of_trajectories=20, seed=9)
+            self.check_poisson(ensemble, 3)
+
+    def test_large_network_statistics(self):
+        model = birth_death(600)
+        for solver in (NativeSSASolver, NativeNextReactionSolver):
+            ensemble = solver.run(model, t=1, increment=1,
+                                  number_of_trajectories=20, seed=4)
+            self.check_poisson(ensemble, 1)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,46 @@
+import unittest
+from gillespy2 import BasicSSASolver
+from gillespy2.basic_tau_leaping_solver import BasicTauSolver
+from gillespy2.tau_leaping_solver import TauLeapingSolver
+from gillespy2.results import allocate_trajectories, format_trajectories
+from example_models import dimerization
+
+
+class TestOutputBuffers(unittest.TestCase):
+
+    def test_allocate(self):
+        trajectories = allocate_trajectories(3, [0.0, 0.5, 1.0], 2)
+        self.assertEqual(trajectories.shape, (3, 3, 3))
+        for trajectory in trajectories:
+            self.assertEqual(trajectory[:, 0].tolist(), [0.0, 0.5, 1.0])
+
+    def test_format(self):
+        trajectories = allocate_trajectories(2, [0.0, 1.0], 2)
+        trajectories[:, :, 1:] = 4.0
+        arrays = format_trajectories(trajectories, ('A', 'B'), False)
+        self.assertEqual([a.tolist() for a in arrays],
+                         [[[0.0, 4.0, 4.0], [1.0, 4.0, 4.0]]] * 2)
+        labelled = format_trajectories(trajectories, ('A', 'B'), True)
+        self.assertEqual(sorted(labelled[1]), ['A', 'B', 'time'])
+        self.assertEqual(labelled[1]['time'].tolist(), [0.0, 1.0])
+
+    def test_python_solvers(self):
+        model = dimerization(100)
+        for solver in (BasicSSASolver, BasicTauSolver, TauLeapingSolver):
+            ensemble = solver.run(model, t=2, increment=0.5,
+                                  number_of_trajectories=2, seed=1)
+            self.assertEqual(len(ensemble), 2)
+            for trajectory in ensemble:
+                self.assertEqual(trajectory.shape, (5, 3), solver.__name__)
+                self.assertEqual(trajectory[:, 0].tolist(),
+                                 [0.0, 0.5, 1.0, 1.5, 2.0])
+                self.assertEqual(trajectory[0, 1:].tolist(), [100.0, 0.0])
+            labelled = solver.run(model, t=2, increment=0.5,
+                                  number_of_trajectories=2, seed=1,
+                                  show_labels=True)
+            self.assertEqual(labelled[1]['A'].tolist(),
+                             ensemble[1][:, 1].tolist())
+
+
+if __name__ == '__main__':
+    unittest.main()
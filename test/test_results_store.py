@@ -0,0 +1,73 @@
+import os
+import shutil
+import tempfile
+import unittest
+from gillespy2.gillespyError import SimulationError, SpeciesError
+from gillespy2.results_store import ResultsStore
+from gillespy2.native_ssa_solver import isNATIVE, NativeSSASolver
+from example_models import dimerization, as_lists
+
+
+@unittest.skipIf(not isNATIVE, "needs the gillespy2._native extension")
+class TestResultsStore(unittest.TestCase):
+
+    def setUp(self):
+        self.directory = tempfile.mkdtemp()
+
+    def tearDown(self):
+        shutil.rmtree(self.directory)
+
+    def test_write_and_select(self):
+        model = dimerization()
+        expected = NativeSSASolver.run(model, t=3, number_of_trajectories=20,
+                                       seed=5)
+        for chunks in (None, (7, 5, 2), (3, 100, 1)):
+            path = os.path.join(self.directory, 'store{0}'.format(chunks))
+            store = NativeSSASolver.run(model, t=3, number_of_trajectories=20,
+                                        seed=5, store=path,
+                                        store_chunks=chunks)
+            self.assertEqual(store.shape, (20, 61, 3))
+            self.assertEqual(as_lists(store), as_lists(expected))
+            self.assertEqual(as_lists(ResultsStore(path)[19:]),
+                             as_lists(expected[19:]))
+            selection = store.select(slice(4, 13), times=(0.5, 1.5),
+                                     species=['B'])
+            self.assertEqual(selection.tolist(),
+                             [[[row[2]] for row in trajectory.tolist()
+                               if 0.5 <= row[0] <= 1.5]
+                              for trajectory in expected[4:13]])
+
+    def test_labels(self):
+        model = dimerization()
+        path = os.path.join(self.directory, 'store')
+        NativeSSASolver.run(model, t=3, number_of_trajectories=2, seed=5,
+                            store=path)
+        store = ResultsStore(path, show_labels=True)
+        self.assertEqual(sorted(store[0]), ['A', 'B', 'time'])
+        self.assertEqual(store[1]['B'].tolist(),
+                         ResultsStore(path)[1][:, 2].tolist())
+
+
+    def test_invalid_uses(self):
+        model = dimerization()
+        path = os.path.join(self.directory, 'store')
+        NativeSSASolver.run(model, t=1, number_of_trajectories=3, seed=5,
+                            store=path)
+        with self.assertRaises(SimulationError):
+            NativeSSASolver.run(model, t=1, store=path)
+        with self.assertRaises(SimulationError):
+            NativeSSASolver.run(model, t=1, store_chunks=(0, 1, 1),
+                                store=os.path.join(self.directory, 'other'))
+        with self.assertRaises(SimulationError):
+            ResultsStore(self.directory)
+        store = ResultsStore(path)
+        with self.assertRaises(SimulationError):
+            store.select(trajectories=slice(0, 3, 2))
+        with self.assertRaises(SpeciesError):
+            store.select(species=['C'])
+        with self.assertRaises(IndexError):
+            store[3]
+
+
+if __name__ == '__main__':
+    unittest.main()
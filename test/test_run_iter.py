@@ -0,0 +1,70 @@
+import unittest
+from gillespy2.basic_ssa_solver import BasicSSASolver
+from gillespy2.gillespyError import SimulationError
+from gillespy2.native_ssa_solver import isNATIVE, NativeSSASolver
+from example_models import dimerization, as_lists
+
+
+class CountingSolver(NativeSSASolver):
+    """ NativeSSASolver counting the run() calls of run_iter(). """
+
+    calls = 0
+
+    @classmethod
+    def run(cls, *args, **kwargs):
+        CountingSolver.calls += 1
+        return super(CountingSolver, cls).run(*args, **kwargs)
+
+
+class TestRunIter(unittest.TestCase):
+
+    options = dict(t=5, increment=1, number_of_trajectories=7, seed=5)
+
+    def check_solver(self, solver):
+        model = dimerization()
+        expected = as_lists(solver.run(model, **self.options))
+        for batch_size in (1, 3, 7, 10):
+            trajectories = list(solver.run_iter(model, batch_size=batch_size,
+                                                **self.options))
+            self.assertEqual(as_lists(trajectories), expected)
+
+    @unittest.skipIf(not isNATIVE, "needs the gillespy2._native extension")
+    def test_native_matches_run(self):
+        self.check_solver(NativeSSASolver)
+
+    def test_python_matches_run(self):
+        self.check_solver(BasicSSASolver)
+
+    @unittest.skipIf(not isNATIVE, "needs the gillespy2._native extension")
+    def test_model_run_iter(self):
+        model = dimerization()
+        expected = model.run(solver=NativeSSASolver, show_labels=False,
+                             number_of_trajectories=4, seed=2)
+        trajectories = model.run_iter(solver=NativeSSASolver,
+                                      show_labels=False,
+                                      number_of_trajectories=4, seed=2,
+                                      batch_size=2)
+        self.assertEqual(as_lists(trajectories), as_lists(expected))
+        labelled = next(model.run_iter(solver=NativeSSASolver, seed=2))
+        self.assertEqual(sorted(labelled.keys()), ['A', 'B', 'time'])
+        self.assertEqual(labelled['A'].tolist(),
+                         [row[1] for row in expected[0].tolist()])
+
+    @unittest.skipIf(not isNATIVE, "needs the gillespy2._native extension")
+    def test_stopping_early(self):
+        CountingSolver.calls = 0
+        trajectories = CountingSolver.run_iter(
+            dimerization(), t=5, number_of_trajectories=100, seed=5,
+            batch_size=2)
+        for _ in range(4):
+            next(trajectories)
+        trajectories.close()
+        self.assertEqual(CountingSolver.calls, 2)
+
+    def test_invalid_batch_size(self):
+        with self.assertRaises(SimulationError):
+            list(BasicSSASolver.run_iter(dimerization(), t=1, batch_size=0))
+
+
+if __name__ == '__main__':
+    unittest.main()
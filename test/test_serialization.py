@@ -0,0 +1,39 @@
+import pickle
+import unittest
+import gillespy2
+from gillespy2.gillespy2 import StochMLDocument
+from example_models import dimerization
+
+
+class TestSerialization(unittest.TestCase):
+
+    def assertFresh(self, model):
+        """ Asserts that serialize() matches a newly built document. """
+        cached = model.serialize()
+        self.assertEqual(cached, StochMLDocument.from_model(model).to_string())
+
+    def test_cache_follows_changes(self):
+        model = dimerization()
+        self.assertFresh(model)
+        model.listOfParameters['k2'].set_expression(0.25)
+        self.assertFresh(model)
+        self.assertTrue('0.25' in model.serialize())
+        model.listOfSpecies['A'].initial_value = 123
+        self.assertFresh(model)
+        C = gillespy2.Species(name='C', initial_value=4)
+        model.add_species([C])
+        model.add_reaction([gillespy2.Reaction(
+            name='make_c', reactants={model.listOfSpecies['B']: 1},
+            products={C: 1}, rate=model.listOfParameters['k3'])])
+        self.assertFresh(model)
+        self.assertTrue('make_c' in model.serialize())
+
+    def test_pickled_model(self):
+        model = dimerization()
+        model.serialize()
+        copy = pickle.loads(pickle.dumps(model))
+        self.assertEqual(copy.serialize(), model.serialize())
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,105 @@
+import unittest
+from gillespy2.gillespyError import SimulationError
+from gillespy2.native_ssa_solver import isNATIVE, NativeSSASolver
+from example_models import dimerization, as_lists, moments
+
+
+@unittest.skipIf(not isNATIVE, "needs the gillespy2._native extension")
+class TestStatistics(unittest.TestCase):
+
+    options = dict(t=10, increment=1, number_of_trajectories=50, seed=7)
+
+    def test_matches_trajectories(self):
+        model = dimerization(3000)
+        ensemble = NativeSSASolver.run_statistics(
+            model, keep_trajectories=50, cores=2, **self.options)
+        ensemble_run = NativeSSASolver.run(model, **self.options)
+        trajectories = as_lists(ensemble_run)
+        self.assertEqual(ensemble.number_of_trajectories, 50)
+        self.assertEqual(as_lists(ensemble.trajectories), trajectories)
+        means, errors = moments(ensemble_run)
+        for streamed, batch in ((ensemble.mean.tolist(), means),
+                                (ensemble.standard_error().tolist(), errors)):
+            for row, expected in zip(streamed, batch):
+                for x, y in zip(row, expected):
+                    self.assertAlmostEqual(x, y, delta=1e-9 * max(y, 1))
+        minimum, maximum = ensemble.minimum.tolist(), ensemble.maximum.tolist()
+        for t, rows in enumerate(zip(*trajectories)):
+            for s, column in enumerate(list(zip(*rows))[1:]):
+                self.assertEqual(minimum[t][s], min(column))
+                self.assertEqual(maximum[t][s], max(column))
+
+    def test_histogram(self):
+        ensemble = NativeSSASolver.run_statistics(
+            dimerization(3000), keep_trajectories=50, histogram_bins=30,
+            histogram_range=(0, 3000), **self.options)
+        for counts in ensemble.histogram.tolist():
+            for bins in counts:
+                self.assertEqual(sum(bins), 50)
+        # The median lies within a bin or two of the sample median.
+        width = 3000 / 30.0
+        median = ensemble.quantile(0.5).tolist()
+        for t, rows in enumerate(zip(*as_lists(ensemble.trajectories))):
+            for s, column in enumerate(list(zip(*rows))[1:]):
+                column = sorted(column)
+                sample = (column[24] + column[25]) / 2.0
+                self.assertLess(abs(median[t][s] - sample), 2 * width)
+        self.assertEqual(ensemble.quantile(0).tolist(),
+                         ensemble.minimum.tolist())
+        self.assertEqual(ensemble.quantile(1).tolist(),
+                         ensemble.maximum.tolist())
+
+    def test_run_until_converged(self):
+        model = dimerization(3000)
+        options = dict(t=10, increment=1, seed=3, batch_size=40)
+        for tolerance, relative in ((5.0, False), (0.01, True)):
+            ensemble = NativeSSASolver.run_until_converged(
+                model, tolerance, relative=relative, **options)
+            n = ensemble.number_of_trajectories
+            self.assertEqual(n % 40, 0)
+            error = ensemble.standard_error().tolist()[-1]
+            mean = ensemble.mean.tolist()[-1]
+            bound = [tolerance * (abs(m) if relative else 1) for m in mean]
+            for e, b in zip(error, bound):
+                self.assertLessEqual(e, b)
+            # One batch fewer would not have converged, or the ensemble
+            # could not have been smaller.
+            if n > 40:
+                smaller = NativeSSASolver.run_statistics(
+                    model, number_of_trajectories=n - 40, t=10, increment=1,
+                    seed=3)
+                self.assertTrue(any(
+                    e > tolerance * (abs(m) if relative else 1)
+                    for e, m in zip(smaller.standard_error().tolist()[-1],
+                                    smaller.mean.tolist()[-1])))
+            again = NativeSSASolver.run_until_converged(
+                model, tolerance, relative=relative, **options)
+            self.assertEqual(again.number_of_trajectories, n)
+            self.assertEqual(again.mean.tolist(), ensemble.mean.tolist())
+
+    def test_convergence_limits(self):
+        model = dimerization(3000)
+        ensemble = NativeSSASolver.run_until_converged(
+            model, 1e-9, t=2, increment=1, seed=3, batch_size=30,
+            max_trajectories=100)
+        self.assertEqual(ensemble.number_of_trajectories, 100)
+        ensemble = NativeSSASolver.run_until_converged(
+            model, 1e9, species=['B'], t=2, increment=1, seed=3,
+            batch_size=30, min_trajectories=70)
+        self.assertEqual(ensemble.number_of_trajectories, 90)
+        for options in (dict(tolerance=0), dict(tolerance=1, batch_size=0),
+                        dict(tolerance=1, max_trajectories=1)):
+            with self.assertRaises(SimulationError):
+                NativeSSASolver.run_until_converged(model, t=1, **options)
+
+    def test_invalid_options(self):
+        model = dimerization()
+        for options in (dict(keep_trajectories=51), dict(histogram_bins=5),
+                        dict(histogram_bins=-1, histogram_range=(0, 1))):
+            with self.assertRaises(SimulationError):
+                NativeSSASolver.run_statistics(model, **dict(self.options,
+                                                             **options))
+
+
+if __name__ == '__main__':
+    unittest.main()
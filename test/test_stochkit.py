@@ -0,0 +1,33 @@
+import unittest
+from gillespy2 import StochKitSolver
+from gillespy2.gillespyError import SimulationError
+from gillespy2.native_ssa_solver import (isNATIVE, NativeSSASolver,
+                                         NativeNextReactionSolver)
+from example_models import dimerization, as_lists
+
+
+@unittest.skipIf(not isNATIVE, "needs the gillespy2._native extension")
+class TestInProcess(unittest.TestCase):
+
+    def test_native_engines(self):
+        model = dimerization()
+        options = dict(t=3, increment=0.5, number_of_trajectories=4, seed=2)
+        for method, solver in ((None, NativeSSASolver),
+                               ('NRM', NativeNextReactionSolver)):
+            self.assertEqual(
+                as_lists(StochKitSolver.run(model, in_process=True,
+                                            method=method, **options)),
+                as_lists(solver.run(model, **options)))
+
+    def test_labels(self):
+        ensemble = StochKitSolver.run(dimerization(), t=1, seed=1,
+                                      in_process=True, show_labels=True)
+        self.assertEqual(sorted(ensemble[0]), ['A', 'B', 'time'])
+
+    def test_unknown_algorithm(self):
+        self.assertRaises(SimulationError, StochKitSolver.run,
+                          dimerization(), in_process=True, algorithm='ode')
+
+
+if __name__ == '__main__':
+    unittest.main()
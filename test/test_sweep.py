@@ -0,0 +1,70 @@
+import unittest
+from gillespy2.gillespyError import ParameterError
+from gillespy2.native_ssa_solver import (isNATIVE, NativeSSASolver,
+                                         NativeTauLeapingSolver)
+from example_models import dimerization, as_lists
+
+
+def with_values(point):
+    """ Returns the dimerization model with the values of point set. """
+    model = dimerization()
+    for name, value in point.items():
+        if name == 'vol':
+            model.volume = value
+        else:
+            model.listOfParameters[name].set_expression(value)
+    model.resolve_parameters()
+    return model
+
+
+@unittest.skipIf(not isNATIVE, "needs the gillespy2._native extension")
+class TestSweep(unittest.TestCase):
+
+    options = dict(t=5, increment=1, number_of_trajectories=4, seed=9)
+
+    def check_points(self, solver, points, results):
+        for point, result in zip(points, results):
+            expected = solver.run(with_values(point), **self.options)
+            self.assertEqual(as_lists(result), as_lists(expected))
+
+    def test_grid(self):
+        points, results = NativeSSASolver.run_sweep(
+            dimerization(), {'k1': [0.001, 0.004], 'k3': [0.05, 0.5, 0.0]},
+            cores=3, **self.options)
+        self.assertEqual([(p['k1'], p['k3']) for p in points],
+                         [(0.001, 0.05), (0.001, 0.5), (0.001, 0.0),
+                          (0.004, 0.05), (0.004, 0.5), (0.004, 0.0)])
+        self.check_points(NativeSSASolver, points, results)
+
+    def test_rows(self):
+        points, results = NativeTauLeapingSolver.run_sweep(
+            dimerization(), [[0.2, 1.0], [1.0, 2.0]],
+            parameter_names=['k2', 'vol'], **self.options)
+        self.assertEqual(points, [{'k2': 0.2, 'vol': 1.0},
+                                  {'k2': 1.0, 'vol': 2.0}])
+        self.check_points(NativeTauLeapingSolver, points, results)
+
+    def test_statistics(self):
+        points, results = NativeSSASolver.run_sweep(
+            dimerization(), {'k2': [0.1, 1.0]}, statistics=True,
+            keep_trajectories=2, **self.options)
+        for point, result in zip(points, results):
+            expected = NativeSSASolver.run_statistics(
+                with_values(point), keep_trajectories=2, **self.options)
+            self.assertEqual(result.mean.tolist(), expected.mean.tolist())
+            self.assertEqual(result.variance.tolist(),
+                             expected.variance.tolist())
+            self.assertEqual(as_lists(result.trajectories),
+                             as_lists(expected.trajectories))
+
+    def test_invalid_parameters(self):
+        model = dimerization()
+        with self.assertRaises(ParameterError):
+            NativeSSASolver.run_sweep(model, {'k9': [1.0]}, t=1)
+        with self.assertRaises(ParameterError):
+            NativeSSASolver.run_sweep(model, [[1.0, 2.0]],
+                                      parameter_names=['k1'], t=1)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,52 @@
+import unittest
+from gillespy2.gillespyError import SimulationError
+from gillespy2.native_ssa_solver import (isNATIVE, NativeSSASolver,
+                                         NativeTauLeapingSolver)
+from example_models import dimerization, as_lists, mean_difference
+
+
+@unittest.skipIf(not isNATIVE, "needs the gillespy2._native extension")
+class TestTauLeaping(unittest.TestCase):
+
+    def test_matches_direct_method(self):
+        model = dimerization(3000)
+        options = dict(t=10, increment=1, number_of_trajectories=200)
+        exact = NativeSSASolver.run(model, seed=1, **options)
+        tau = NativeTauLeapingSolver.run(model, seed=2, **options)
+        self.assertLess(mean_difference(exact, tau), 5)
+
+    def test_ssa_bursts(self):
+        # A large threshold takes exact bursts almost everywhere, 0 never.
+        model = dimerization(3000)
+        options = dict(t=10, increment=1, number_of_trajectories=200)
+        exact = NativeSSASolver.run(model, seed=1, **options)
+        runs = []
+        for threshold, steps in ((1e6, 10), (1e6, 1000), (0, 100)):
+            tau = NativeTauLeapingSolver.run(model, seed=2,
+                                             ssa_threshold=threshold,
+                                             ssa_steps=steps, **options)
+            self.assertLess(mean_difference(exact, tau), 5)
+            runs.append(as_lists(tau))
+        self.assertNotEqual(runs[0], runs[2])
+
+    def test_seed_reproduces(self):
+        model = dimerization(3000)
+        first = NativeTauLeapingSolver.run(model, t=5,
+                                           number_of_trajectories=5, seed=3)
+        again = NativeTauLeapingSolver.run(model, t=5,
+                                           number_of_trajectories=5, seed=3)
+        self.assertEqual(as_lists(first), as_lists(again))
+        for trajectory in as_lists(first):
+            self.assertTrue(min(min(row[1:]) for row in trajectory) >= 0)
+
+    def test_invalid_options(self):
+        model = dimerization()
+        for options in (dict(epsilon=0), dict(epsilon=1.5),
+                        dict(critical_threshold=-1), dict(ssa_threshold=-1),
+                        dict(ssa_steps=0)):
+            with self.assertRaises(SimulationError):
+                NativeTauLeapingSolver.run(model, t=1, **options)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,80 @@
+import os
+import shutil
+import tempfile
+import unittest
+import numpy as np
+from gillespy2.gillespySolver import StochKitSolver, StochKitODESolver
+from gillespy2.trajectory_files import TrajectoryFiles, save_trajectories
+
+LABELS = ['time', 'A', 'B']
+TRAJECTORIES = [[[0.0, 10.0, 0.0], [1.0, 8.0, 1.0]],
+                [[0.0, 10.0, 0.0], [1.0, 6.0, 2.0]]]
+
+
+class TestTrajectoryFiles(unittest.TestCase):
+
+    def setUp(self):
+        self.directory = tempfile.mkdtemp()
+
+    def tearDown(self):
+        shutil.rmtree(self.directory, ignore_errors=True)
+
+    def write_text(self, directory):
+        os.makedirs(directory)
+        for i, trajectory in enumerate(TRAJECTORIES):
+            with open(os.path.join(directory,
+                                   'trajectory{0}.txt'.format(i)), 'w') as f:
+                f.write('\t'.join(LABELS) + '\n')
+                for row in trajectory:
+                    f.write(' '.join(str(v) for v in row) + '\n')
+
+    def test_text(self):
+        directory = os.path.join(self.directory, 'trajectories')
+        self.write_text(directory)
+        files = TrajectoryFiles(directory)
+        self.assertEqual(files.labels, LABELS)
+        self.assertEqual(len(files), 2)
+        self.assertEqual([t.tolist() for t in files], TRAJECTORIES)
+        self.assertEqual(files.array().tolist(), TRAJECTORIES)
+
+    def test_binary(self):
+        directory = os.path.join(self.directory, 'binary')
+        save_trajectories(directory, [np.array(t) for t in TRAJECTORIES],
+                          LABELS)
+        files = TrajectoryFiles(directory, show_labels=True)
+        self.assertEqual(files.labels, LABELS)
+        self.assertEqual(files[1]['A'].tolist(), [10.0, 6.0])
+        self.assertEqual(files[-1]['time'].tolist(), [0.0, 1.0])
+
+    def test_cleanup(self):
+        directory = os.path.join(self.directory, 'trajectories')
+        self.write_text(directory)
+        files = TrajectoryFiles(directory, cleanup_directory=self.directory)
+        files.close()
+        self.assertFalse(os.path.exists(self.directory))
+
+    def test_stochkit_output(self):
+        self.write_text(os.path.join(self.directory, 'trajectories'))
+        labels, trajectories = StochKitSolver().get_trajectories(
+            self.directory, show_labels=True)
+        self.assertEqual(labels, LABELS)
+        self.assertEqual([t.tolist() for t in trajectories], TRAJECTORIES)
+        lazy = StochKitSolver().get_trajectories(self.directory, lazy=True)
+        self.assertEqual(lazy[0].tolist(), TRAJECTORIES[0])
+
+    def test_stochkit_ode_output(self):
+        for rows in (TRAJECTORIES[0], TRAJECTORIES[0][:1]):
+            with open(os.path.join(self.directory, 'output.txt'), 'w') as f:
+                f.write('labels\n' + ' '.join(LABELS) + '\nvalues\n')
+                f.write(' '.join(str(v) for v in rows[0]) + '\n')
+                f.write('more values\n')
+                for row in rows[1:]:
+                    f.write(' '.join(str(v) for v in row) + '\n')
+            labels, trajectories = StochKitODESolver().get_trajectories(
+                self.directory, show_labels=True)
+            self.assertEqual(labels, LABELS)
+            self.assertEqual(trajectories[0].tolist(), rows)
+
+
+if __name__ == '__main__':
+    unittest.main()